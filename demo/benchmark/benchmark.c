@@ -0,0 +1,161 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Scheduler benchmark: dispatch latency and throughput of the scheduler
+ * backend selected at build time (cf. po_function_BACKEND). Build it once
+ * per backend and compare the reports on the target of interest.
+ *
+ * Scenarios:
+ *   post below: a priority function posts one call at a lower level, the
+ *               latency is from the post to the entry of the call.
+ *   fan out:    a priority function posts one call on each level below it.
+ *   same level: a call reposts itself at its own level (chained calls).
+ *   fiber wait: a fiber blocks and is resumed at its own level (hosted
+ *               targets), ie, a post and two context switches.
+ */
+
+#include <portos.h>
+#include "target.h"
+
+#if po_function_BACKEND == po_function_BACKEND_MAXNODE
+#define BACKEND_NAME "maxnode"
+#else
+#define BACKEND_NAME "bitmap"
+#endif
+
+enum {
+  eROUNDS = 100000,
+  eLEVEL_TOP = po_priority_MAX - 1,
+  eLEVEL_WORK = po_priority_MAX / 2
+};
+
+/* Latency statistics, in time stamp units
+ */
+typedef struct {
+  unsigned long min, max;
+  double sum;
+  long n;
+} Latency;
+
+static Latency PostLatency;
+static unsigned long PostTime;
+static long Remaining;
+
+static void latency_reset(Latency *lat)
+{
+  lat->min = (unsigned long)-1;
+  lat->max = 0;
+  lat->sum = 0;
+  lat->n = 0;
+}
+
+static void latency_add(Latency *lat, unsigned long t)
+{
+  if ( t < lat->min ) lat->min = t;
+  if ( t > lat->max ) lat->max = t;
+  lat->sum += t;
+  lat->n++;
+}
+
+/* Prints the throughput of a scenario, and its latency if any
+ */
+static void report(const char *name, long calls, unsigned long elapsed,
+		   Latency *lat)
+{
+  double us = elapsed / target_ticksperus();
+  myprintf("%-12s %8ld calls %10.0f calls/ms", name, calls,
+	   us > 0 ? calls * 1000.0 / us : 0.0);
+  if ( lat && lat->n )
+    myprintf("   latency us: min %.3f avg %.3f max %.3f",
+	     lat->min / target_ticksperus(),
+	     lat->sum / lat->n / target_ticksperus(),
+	     lat->max / target_ticksperus());
+  myprintf("\n");
+}
+
+/* Post below
+ */
+static void work(po_priority(eLEVEL_WORK))
+{
+  latency_add(&PostLatency, target_time() - PostTime);
+}
+
+static void post(po_priority(eLEVEL_TOP))
+{
+  PostTime = target_time();
+  work(po_priority);
+}
+
+/* Fan out
+ */
+static void leaf(po_priority(p), int p)
+{
+  Remaining--;
+}
+
+static void fanout(po_priority(eLEVEL_TOP))
+{
+  int p;
+  for ( p = eLEVEL_TOP - 1 ; p >= 0 ; p-- )
+    leaf(po_priority, p);
+}
+
+/* Same level
+ */
+static void repost(po_priority(eLEVEL_WORK))
+{
+  if ( --Remaining > 0 ) repost(po_priority);
+}
+
+#if po_target_HOSTED
+/* Fiber wait
+ */
+static void fiberloop(void *unused)
+{
+  while ( --Remaining > 0 )
+    po_fiber_wait(po_priority);
+}
+
+static void fiberstart(po_priority(eLEVEL_WORK))
+{
+  po_fiber_start(fiberloop, NULL, 8192, &po_memory_RegionDefault);
+}
+#endif
+
+int main()
+{
+  unsigned long start;
+  long i;
+
+  po_init();
+
+  myprintf("Portos scheduler benchmark, %s backend, %d levels\n",
+	   BACKEND_NAME, po_function_NUM_PRI_LEVELS);
+
+  latency_reset(&PostLatency);
+  start = target_time();
+  for ( i = 0 ; i < eROUNDS ; i++ )
+    post(po_priority);
+  report("post below", eROUNDS, target_time() - start, &PostLatency);
+
+  Remaining = (long)eROUNDS * eLEVEL_TOP;
+  start = target_time();
+  for ( i = 0 ; i < eROUNDS ; i++ )
+    fanout(po_priority);
+  report("fan out", (long)eROUNDS * eLEVEL_TOP, target_time() - start, NULL);
+
+  Remaining = eROUNDS;
+  start = target_time();
+  repost(po_priority);
+  report("same level", eROUNDS, target_time() - start, NULL);
+
+  #if po_target_HOSTED
+  Remaining = eROUNDS;
+  start = target_time();
+  fiberstart(po_priority);
+  report("fiber wait", eROUNDS, target_time() - start, NULL);
+  #endif
+
+  return 0;
+}
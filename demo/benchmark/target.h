@@ -0,0 +1,48 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Target specific timer and output for the benchmark.
+ */
+
+#if _TI_  // For TI BIOS
+
+#include <std.h>
+#include <clk.h>
+#include <log.h>
+
+extern far LOG_Obj trace;
+#define myprintf(...) LOG_printf(&trace, __VA_ARGS__)
+
+/* High resolution time stamp */
+static inline unsigned long target_time(void)
+{
+  return CLK_gethtime();
+}
+
+/* Time stamp units per micro-second */
+static inline double target_ticksperus(void)
+{
+  return CLK_countspms() / 1000.0;
+}
+
+#else // gcc for example
+
+#include <stdio.h>
+#include <time.h>
+
+#define myprintf printf
+
+static inline unsigned long target_time(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (unsigned long)t.tv_sec * 1000000000UL + t.tv_nsec;
+}
+
+static inline double target_ticksperus(void)
+{
+  return 1000.0;
+}
+
+#endif
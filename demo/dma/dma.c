@@ -0,0 +1,207 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Streaming through DMA: blocks of samples are moved by DMA from an input
+ * stream to a working buffer, processed in place, then moved with a header
+ * to an output stream by a scatter-gather transfer. The completions run at
+ * a high level and only schedule the work:
+ *
+ *      input DMA --> filled --> process --> output DMA --> drained --+
+ *          ^                                                          |
+ *          +----------------------- buffer free ----------------------+
+ *
+ * With one buffer the transfers and the processing follow each other.
+ * With two (double buffering), a block is processed while the next one is
+ * moved, and the time per block falls from their sum to the largest of
+ * the two. The engine is the emulated one of hosted targets (cf.
+ * po_dma.h), whose bandwidth and latency are set below. Each block crosses
+ * the engine twice, so the stream runs at most at half its bandwidth.
+ */
+
+#include <portos.h>
+#include "target.h"
+
+enum {
+  eSAMPLES = 16384,              // samples of a block
+  eBLOCKS = 256,                 // blocks of the stream
+  ePASSES = 64,                  // passes of the processing over a block
+  eLEVEL_DMA = po_priority_MAX - 1,
+  eLEVEL_PROCESS = 2
+};
+
+#define BANDWIDTH 200000000UL    // bytes per second
+#define LATENCY   2000UL         // nanoseconds per transfer
+
+#if po_target_HOSTED
+
+typedef struct {
+  long seq;
+  long checksum;
+} Header;
+
+typedef struct {
+  Header header;
+  short data[eSAMPLES];
+} Record;
+
+static short Input[eBLOCKS][eSAMPLES];
+static Record Output[eBLOCKS];
+
+static short Buffer[2][eSAMPLES];
+static Header Headers[2];
+static int Block[2];             // block held by each buffer
+
+static po_inbox_Inbox Inbox;
+static po_dma_Engine Engine;
+static po_dma_Channel InChannel, OutChannel;
+static int NextBlock, NDone;
+static unsigned long ProcessTime;
+
+static void filled(void *arg, size_t bytes);
+static void drained(void *arg, size_t bytes);
+
+/* One pass of the processing
+ */
+static inline short sample(short x)
+{
+  return (short)(x * 3 + 1);
+}
+
+/* Moves the next block of the input stream into a buffer
+ */
+static void fetch(int b)
+{
+  if ( NextBlock == eBLOCKS ) return;
+  Block[b] = NextBlock++;
+  po_dma_copy(&InChannel, Buffer[b], Input[Block[b]], sizeof(Buffer[b]),
+	      filled, (void*)(intptr_t)b, eLEVEL_DMA);
+}
+
+/* Processes a buffer, then moves it with its header to the output stream
+ */
+static void process(po_priority(eLEVEL_PROCESS), int b)
+{
+  unsigned long start = target_time();
+  short *data = Buffer[b];
+  long checksum = 0;
+  int i, k;
+
+  for ( k = 0 ; k < ePASSES ; k++ )
+    for ( i = 0 ; i < eSAMPLES ; i++ )
+      data[i] = sample(data[i]);
+  for ( i = 0 ; i < eSAMPLES ; i++ )
+    checksum += data[i];
+  Headers[b].seq = Block[b];
+  Headers[b].checksum = checksum;
+  ProcessTime += target_time() - start;
+
+  po_dma_add(&OutChannel, &Output[Block[b]].header, &Headers[b],
+	     sizeof(Headers[b]));
+  po_dma_add(&OutChannel, Output[Block[b]].data, data, sizeof(Buffer[b]));
+  po_dma_submit(&OutChannel, drained, (void*)(intptr_t)b, eLEVEL_DMA);
+}
+
+/* Input transfer done
+ */
+static void filled(void *arg, size_t bytes)
+{
+  process(po_priority, (int)(intptr_t)arg);
+}
+
+/* Output transfer done: the buffer is free again
+ */
+static void drained(void *arg, size_t bytes)
+{
+  NDone++;
+  fetch((int)(intptr_t)arg);
+}
+
+/* Checks the output stream. Returns the number of bad blocks.
+ */
+static int check(void)
+{
+  int errors = 0, i, k, n;
+
+  for ( n = 0 ; n < eBLOCKS ; n++ ) {
+    Record *record = &Output[n];
+    long checksum = 0;
+    for ( i = 0 ; i < eSAMPLES ; i++ ) {
+      short x = Input[n][i];
+      for ( k = 0 ; k < ePASSES ; k++ )
+	x = sample(x);
+      checksum += x;
+      if ( record->data[i] != x ) break;
+    }
+    if ( i < eSAMPLES || record->header.seq != n ||
+	 record->header.checksum != checksum )
+      errors++;
+  }
+  return errors;
+}
+
+/* Streams the input through nBuffers buffers
+ */
+static void run(int nBuffers)
+{
+  unsigned long long busy = Engine.busy;
+  unsigned long start, elapsed;
+  int b;
+
+  memset(Output, 0, sizeof(Output));
+  NextBlock = NDone = 0;
+  ProcessTime = 0;
+
+  start = target_time();
+  for ( b = 0 ; b < nBuffers ; b++ )
+    fetch(b);
+  while ( NDone < eBLOCKS )
+    po_inbox_wait(&Inbox, 1000);
+  elapsed = target_time() - start;
+
+  myprintf("%d buffer%s %8.0f us %8.0f MB/s   cpu %3.0f%%   dma %3.0f%%   %s\n",
+	   nBuffers, nBuffers > 1 ? "s" : " ",
+	   elapsed / target_ticksperus(),
+	   (double)eBLOCKS * sizeof(Buffer[0]) * target_ticksperus() / elapsed,
+	   100.0 * ProcessTime / elapsed,
+	   (Engine.busy - busy) / 10.0 / (elapsed / target_ticksperus()),
+	   check() ? "BAD OUTPUT" : "ok");
+}
+
+int main()
+{
+  int i, n;
+
+  po_init();
+
+  for ( n = 0 ; n < eBLOCKS ; n++ )
+    for ( i = 0 ; i < eSAMPLES ; i++ )
+      Input[n][i] = (short)(n * 31 + i);
+
+  po_inbox_init(&Inbox);
+  if ( po_dma_init(&Engine, &Inbox, BANDWIDTH, LATENCY) ) {
+    myprintf("Cannot start the DMA engine\n");
+    return 1;
+  }
+  po_dma_chinit(&InChannel, &Engine);
+  po_dma_chinit(&OutChannel, &Engine);
+
+  myprintf("Streaming %d blocks of %d bytes, DMA at %lu MB/s + %lu ns\n",
+	   eBLOCKS, (int)sizeof(Buffer[0]), BANDWIDTH / 1000000, LATENCY);
+  run(1);
+  run(2);
+
+  po_dma_stop(&Engine);
+  po_inbox_close(&Inbox);
+  return 0;
+}
+
+#else
+
+int main()
+{
+  myprintf("The DMA engine is only emulated on hosted targets\n");
+  return 0;
+}
+
+#endif // po_target_HOSTED
@@ -0,0 +1,41 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Initialization file of the DMA demo (cf. test/po_init.c).
+ */
+
+// This macro is defined in this file only.
+#define po_INIT_FILE
+
+#include <portos.h>
+
+#define heapSize 100000
+static char Heap[heapSize];
+
+// Handles of the priority functions
+po_memory_Region(po_memory_RegionDefault, Heap, heapSize, 1000);
+
+po_signal_Group(po_signal_GroupDefault, po_priority_MAX, 8, &po_memory_RegionDefault);
+
+po_time_Clock(po_time_ClockDefault, po_priority_MAX, 16, &po_memory_RegionDefault);
+
+static po_log_Word LogBuffer[256];
+po_log_Handle po_log_HandleDefault =
+  po_log_INIT(LogBuffer, sizeof(LogBuffer)/sizeof(po_log_Word), po_priority_MAX);
+
+void po_init(void)
+{
+  #if po_MULTI_INSTANCE
+  po_memory_RegionDefaultP = (po_memory_Region*)&po_memory_RegionDefault;
+  po_signal_GroupDefaultP = (po_signal_Group*)&po_signal_GroupDefault;
+  po_time_ClockDefaultP = (po_time_Clock*)&po_time_ClockDefault;
+  #endif
+
+  po_memory_regioninit((po_memory_Region*)&po_memory_RegionDefault);
+  po_signal_groupinit((po_signal_Group*)&po_signal_GroupDefault);
+  po_time_clockinit((po_time_Clock*)&po_time_ClockDefault);
+
+  // Call this function at the end
+  po_init_();
+}
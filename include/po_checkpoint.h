@@ -0,0 +1,103 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Checkpoint and restore of the Portos state on hosted targets. A long
+ * simulation can save its state once warmed up (regions filled, timers
+ * armed) and later runs of the same program restore it at start up
+ * instead of warming up again.
+ *
+ * The state is a list of memory ranges registered in the same order by
+ * the saving and the restoring processes: the scheduler environment
+ * (po_checkpoint_addsystem), memory regions with their heap buffers,
+ * signal groups, clocks and any user data they refer to. The ranges are
+ * written as is, with their addresses and the bounds of the executable
+ * image. When restored, every aligned word pointing into a saved range
+ * or into the old image is relocated to the new range or image, so the
+ * program may be loaded at another address (PIE, ASLR) and the ranges
+ * may move. The relocation is conservative: pointers to memory that was
+ * not saved (eg, the C library heap) are restored unchanged and are
+ * invalid, and an integer that happens to look like a saved address is
+ * relocated.
+ *
+ * The state must be saved and restored while no priority function runs,
+ * eg, from main() after po_init().
+ */
+
+#ifndef po_checkpoint__H
+#define po_checkpoint__H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <po_sys.h>
+#include <po_memory.h>
+#include <po_signal.h>
+#include <po_time.h>
+
+#if po_target_HOSTED
+
+/* Maximum number of ranges registered. It can be set on the command line.
+ */
+#ifndef po_checkpoint_MAX_RANGES
+#define po_checkpoint_MAX_RANGES 32
+#endif
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Clears the list of ranges.
+ */
+void po_checkpoint_reset(void)
+;
+
+/*-GLOBAL-
+ * Registers a range of memory. Returns 0, or -1 if the list is full.
+ */
+int po_checkpoint_add(void *addr, size_t size)
+;
+
+/*-GLOBAL-
+ * Registers the state of the scheduler and of the other system modules.
+ */
+int po_checkpoint_addsystem(void)
+;
+
+/*-GLOBAL-
+ * Registers a memory region and its heap buffer.
+ */
+int po_checkpoint_addregion(po_memory_Region *region, void *heap, size_t length)
+;
+
+/*-GLOBAL-
+ * Registers a signal group.
+ */
+int po_checkpoint_addgroup(po_signal_Group *group)
+;
+
+/*-GLOBAL-
+ * Registers a clock.
+ */
+int po_checkpoint_addclock(po_time_Clock *clock)
+;
+
+/*-GLOBAL-
+ * Writes the registered ranges to file. Returns 0, or -1 if a priority
+ * function is running or on a write error.
+ */
+int po_checkpoint_save(FILE *file)
+;
+
+/*-GLOBAL-
+ * Reads the registered ranges from file and relocates their pointers.
+ * Returns 0, or -1 if a priority function is running, if the file was not
+ * saved with the same list of range sizes or on a read error. The state
+ * is unchanged if the list does not match, undefined after a read error.
+ */
+int po_checkpoint_restore(FILE *file)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+#endif // po_target_HOSTED
+
+#endif // po_checkpoint__H
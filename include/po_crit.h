@@ -0,0 +1,92 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Lengths of the critical sections with interrupts masked. Each pair of
+ * po_interrupt_disable and po_interrupt_restore delays the interrupts by
+ * its length, and the longest one bounds the interrupt latency. With
+ * po_crit_STATS, the outermost window of nested pairs is timed with
+ * po_target_timestamp() and counted under the file and line of the
+ * po_interrupt_disable that opened it: number of windows, total and
+ * longest length, and a histogram of the lengths in powers of two. The
+ * sites are written longest first:
+ *
+ *      site                      windows       mean        max  lengths (2^k:windows)
+ *      po_memory.c:98              10240        190       2310  128:9812 256:380 ...
+ *
+ * On hosted targets the windows are those of the calling thread, that is
+ * of one Portos instance.
+ */
+
+#ifndef po_crit__H
+#define po_crit__H
+
+#include <stdio.h>
+#include <po_sys.h>
+
+#if po_crit_STATS
+
+/* Distinct call sites counted and bins of the histograms, the last one
+ * counting all longer windows. They can be set on the command line.
+ */
+#ifndef po_crit_MAX_SITES
+#define po_crit_MAX_SITES 64
+#endif
+#ifndef po_crit_NUM_BINS
+#define po_crit_NUM_BINS  24
+#endif
+
+/*-GLOBAL-
+ * Windows opened at a call site, lengths in po_target_timestamp() units
+ */
+typedef struct {
+  const char *file;         /* NULL if free */
+  int line;
+  unsigned long count;
+  unsigned long long total;
+  unsigned long max;
+  unsigned long bin[po_crit_NUM_BINS]; /* windows of [2^k, 2^(k+1)) */
+} po_crit_Site;
+
+/*-GLOBAL-
+ * Counters of all sites
+ */
+typedef struct {
+  unsigned long nWindows;   /* windows timed */
+  unsigned long nDropped;   /* windows not counted: site table full */
+  unsigned long max;        /* longest window */
+  int nSites;               /* distinct sites */
+} po_crit_Stats;
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Clears all counts.
+ */
+void po_crit_reset(void)
+;
+
+/*-GLOBAL-
+ * Copies the counters of all sites.
+ */
+void po_crit_getstats(po_crit_Stats *stats)
+;
+
+/*-GLOBAL-
+ * Copies at most n sites into sites, the longest window first. Returns
+ * the number copied.
+ */
+int po_crit_top(po_crit_Site *sites, int n)
+;
+
+/*-GLOBAL-
+ * Writes the n sites with the longest windows, longest first.
+ */
+void po_crit_write(FILE *file, int n)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+#endif // po_crit_STATS
+
+#endif // po_crit__H
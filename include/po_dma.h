@@ -0,0 +1,169 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * DMA transfers completing into priority functions. A channel holds a
+ * ring of descriptors, each copying a buffer; a transfer is a run of
+ * descriptors (scatter-gather) submitted at once, whose completion
+ * function runs at a chosen priority level once the last one is done:
+ *
+ *      static void filled(void *arg, size_t bytes)
+ *      {
+ *        process(po_priority, arg);               // level 5
+ *      }
+ *
+ *      po_dma_add(&Channel, header, &Header, sizeof(Header));
+ *      po_dma_add(&Channel, block, input, blockSize);
+ *      po_dma_submit(&Channel, filled, block, 5);
+ *
+ * The channels of an engine are served in turn, one transfer at a time
+ * and in order within a channel. The descriptors of a transfer are free
+ * again when its completion starts, so the completion can submit the next
+ * transfer into the same ring.
+ *
+ * On hosted targets the engine is emulated by a thread copying with
+ * memcpy, at a bandwidth and after a set up latency per transfer given to
+ * po_dma_init, so that pipelines can be developed and measured without
+ * the hardware. The completions are posts to an inbox (cf. po_inbox.h)
+ * drained by the Portos thread, so their levels must have no pending
+ * limit.
+ */
+
+#ifndef po_dma__H
+#define po_dma__H
+
+#include <stddef.h>
+#include <po_sys.h>
+#include <po_inbox.h>
+
+#if po_target_HOSTED
+
+#include <pthread.h>
+
+/* Descriptors in the ring of a channel. It can be set on the command
+ * line.
+ */
+#ifndef po_dma_RING_SIZE
+#define po_dma_RING_SIZE 64
+#endif
+
+/*-GLOBAL-
+ * Completion of a transfer, given the number of bytes copied
+ */
+typedef void (*po_dma_Done)(void *arg, size_t bytes);
+
+struct _po_dma_Channel;
+
+/*-GLOBAL-
+ * A descriptor. The completion fields are those of the last descriptor
+ * of a transfer.
+ */
+typedef struct {
+  void *dst;
+  const void *src;
+  size_t len;
+  int last;                     /* ends a transfer */
+  int busy;                     /* in a transfer not yet completed */
+
+  po_inbox_Post post;           /* completion */
+  struct _po_dma_Channel *channel;
+  unsigned first;               /* first descriptor of the transfer */
+  size_t bytes;                 /* bytes of the transfer */
+  po_dma_Done done;
+  void *arg;
+} po_dma_Desc;
+
+struct _po_dma_Engine;
+
+/*-GLOBAL-
+ * A channel. head, read by the engine, is written under its lock.
+ */
+typedef struct _po_dma_Channel {
+  struct _po_dma_Channel *next; /* channels of the engine */
+  struct _po_dma_Engine *engine;
+  unsigned head;                /* end of the submitted descriptors */
+  unsigned tail;                /* end of the transfer being built */
+  unsigned fetch;               /* next descriptor for the engine */
+  unsigned long nTransfers;     /* completions run */
+  unsigned long nBytes;
+  po_dma_Desc desc[po_dma_RING_SIZE];
+} po_dma_Channel;
+
+/*-GLOBAL-
+ * An emulated engine
+ */
+typedef struct _po_dma_Engine {
+  pthread_t thread;
+  pthread_mutex_t lock;         /* protects the channels' heads and stop */
+  pthread_cond_t cond;          /* signaled when a transfer is submitted */
+  int stop;
+  po_inbox_Inbox *inbox;
+  po_dma_Channel *channels;
+  po_dma_Channel *current;      /* channel served last */
+  unsigned long bandwidth;      /* bytes per second, 0 for no limit */
+  unsigned long latency;        /* set up of a transfer, in nanoseconds */
+  unsigned long long free;      /* time the engine is done, in nanoseconds */
+  unsigned long long busy;      /* time spent on transfers */
+} po_dma_Engine;
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Starts an engine copying at bandwidth bytes per second (0 for no limit)
+ * after latency nanoseconds per transfer, whose completions are posted to
+ * inbox. Returns 0, or -1 if its thread could not be created.
+ */
+int po_dma_init(po_dma_Engine *engine, po_inbox_Inbox *inbox,
+		unsigned long bandwidth, unsigned long latency)
+;
+
+/*-GLOBAL-
+ * Stops an engine once the submitted transfers are done. Completions
+ * still waiting in the inbox are run when it is drained.
+ */
+void po_dma_stop(po_dma_Engine *engine)
+;
+
+/*-GLOBAL-
+ * Init a channel of an engine.
+ */
+void po_dma_chinit(po_dma_Channel *channel, po_dma_Engine *engine)
+;
+
+/*-GLOBAL-
+ * Adds a descriptor copying len bytes of src to dst to the transfer being
+ * built. Returns 0, or -1 if the ring is full.
+ */
+int po_dma_add(po_dma_Channel *channel, void *dst, const void *src,
+	       size_t len)
+;
+
+/*-GLOBAL-
+ * Submits the descriptors added since the last transfer as a transfer
+ * completing into done(arg, bytes) at a priority level. Returns 0, or -1
+ * if none were added.
+ */
+int po_dma_submit(po_dma_Channel *channel, po_dma_Done done, void *arg,
+		  int priority)
+;
+
+/*-GLOBAL-
+ * Drops the descriptors added since the last transfer (eg, when the ring
+ * was found full in the middle of a transfer).
+ */
+void po_dma_abort(po_dma_Channel *channel)
+;
+
+/*-GLOBAL-
+ * Copies len bytes of src to dst in a transfer of its own. Returns 0, or
+ * -1 if the ring is full or a transfer is being built.
+ */
+int po_dma_copy(po_dma_Channel *channel, void *dst, const void *src,
+		size_t len, po_dma_Done done, void *arg, int priority)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+#endif // po_target_HOSTED
+
+#endif // po_dma__H
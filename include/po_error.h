@@ -24,8 +24,11 @@ enum {
   po_error_HASH_NOT_POWER_OF_2 = 300,/* Hash size not a positive power of 2 */
   po_error_HASH_NODE_NOT_IN_TABLE,   /* Node not in table */
 
-  po_error_FUNC_BAD_PRIORITY = 400, /* Priority level out of range */
+  po_error_FUNC_BAD_PRIORITY = 400, /* Priority level out of range (or not
+				      fair in fairweight()) */
   po_error_FUNC_INVALID_RAISE_PRI,  /* raisepri() called with lower priority */
+  po_error_FUNC_BAD_SOURCE,         /* Source id out of range (fair levels) */
+  po_error_FUNC_LEVEL_FULL,         /* Call rejected: level limit reached */
 
   po_error_SIG_POST_OUT_OF_RANGE = 500, /* hashSize!=2^n, post out of range */
   po_error_SIG_ATTACH_OUT_OF_RANGE,     /* Same but attach sig out of range */
@@ -37,7 +40,29 @@ enum {
 
   po_error_LOG_SIZE_NOT_POWER_OF_2 = 700,/* Log buffer not power of 2 */
 
-  po_error_CANNOT_CREATE_SWI = 1100      /* Failed to create SWI */
+  po_error_IRQ_BAD_SOURCE = 800,         /* Interrupt source out of range
+					    or not bound */
+
+  po_error_MUTEX_ABOVE_CEILING = 900,    /* Locked above its ceiling */
+  po_error_MUTEX_NESTED,                 /* Locked while already locked */
+  po_error_MUTEX_NOT_LOCKED,             /* Unlocked while not locked */
+  po_error_MUTEX_ORDER,                  /* Not unlocked in reverse order of
+					    locking */
+
+  po_error_FIBER_NONE = 1000,            /* Blocking outside a fiber */
+  po_error_FIBER_RAISED,                 /* Blocking above the fiber's
+					    priority level */
+
+  po_error_CANNOT_CREATE_SWI = 1100,     /* Failed to create SWI */
+
+  po_error_INBOX_LIMITED_LEVEL = 1200,   /* Inbox post at a level with a
+					    pending limit */
+
+  po_error_POLL_BAD_FD = 1300,           /* File descriptor out of range or
+					    refused by epoll */
+
+  po_error_SHM_BAD_MESSAGE = 1400        /* Message number not bound or
+					    priority out of range */
 };
 
 /*-GLOBAL-
@@ -0,0 +1,107 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Fibers on hosted targets: a priority function can run legacy blocking
+ * code on a stack of its own. po_fiber_start, called from a priority
+ * function, runs a function on a new stack at the current priority level
+ * until it ends or blocks. A fiber blocks with po_fiber_wait on any
+ * directive (po_time, po_signal, po_queue, po_priority...): it returns to
+ * the priority function that ran it, and is later resumed by a priority
+ * function scheduled with that directive at its own priority level.
+ *
+ *      static void legacy(void *arg)
+ *      {
+ *        ...
+ *        po_fiber_wait(po_time(po_time_get(&po_time_ClockDefault) + 5));
+ *        ...
+ *      }
+ *
+ *      static void handler(po_priority(3), void *arg)
+ *      {
+ *        po_fiber_start(legacy, arg, 8192, &po_memory_RegionDefault);
+ *      }
+ *
+ * A fiber blocks only at its own priority level: not while a mutex is
+ * locked or in a priority function it called. Its stack is a block of a
+ * memory region, so that the stacks of the fibers that have ended are
+ * reused from the region's free list.
+ */
+
+#ifndef po_fiber__H
+#define po_fiber__H
+
+#include <po_sys.h>
+#include <po_memory.h>
+#include <po_function.h>
+
+#if po_target_HOSTED
+
+#include <ucontext.h>
+
+/*-GLOBAL-
+ * A fiber, at the start of its stack block
+ */
+typedef struct _po_fiber_Fiber {
+  ucontext_t context;       /* context of the fiber */
+  ucontext_t caller;        /* context of the priority function running it */
+  struct _po_fiber_Fiber *prev; /* fiber running that priority function */
+  void (*func)(void *arg);
+  void *arg;
+  int priority;
+  int done;
+} po_fiber_Fiber;
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Returns the running fiber, NULL if none.
+ */
+po_fiber_Fiber *po_fiber_self(void)
+;
+
+/*-GLOBAL-
+ * Runs func(arg) on a stack of stackSize bytes allocated in region, at
+ * the current priority level, until it ends or blocks. Called from a
+ * priority function. Returns 0, or -1 if the stack could not be allocated.
+ */
+int po_fiber_start(void (*func)(void *arg), void *arg, int stackSize,
+		   po_memory_Region *region)
+;
+
+/*-GLOBAL-
+ * Priority function resuming a fiber (cf. po_fiber_wait).
+ */
+void po_fiber_resume(po_priority(fiber->priority), po_fiber_Fiber *fiber)
+;
+
+/*-GLOBAL-
+ * Returns the running fiber, which is about to block. Checks in debug
+ * versions that it can block.
+ */
+po_fiber_Fiber *po_fiber_blocking(void)
+;
+
+/*-GLOBAL-
+ * Returns to the priority function that ran or resumed the fiber. The
+ * fiber must have scheduled its own resumption (cf. po_fiber_wait).
+ */
+void po_fiber_block(po_fiber_Fiber *fiber)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+/*-GLOBAL-
+ * Blocks the running fiber until a call scheduled with directive resumes
+ * it.
+ */
+#define po_fiber_wait(directive)				\
+  do {								\
+    po_fiber_Fiber *po__fiber = po_fiber_blocking();		\
+    po_fiber_resume((directive), po__fiber);			\
+    po_fiber_block(po__fiber);					\
+  } while ( 0 )
+
+#endif // po_target_HOSTED
+
+#endif // po_fiber__H
@@ -3,7 +3,8 @@
  * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
  *
  * This module is the pfunc scheduler.
- * A bitmap is used as a database of scheduled priority functions.
+ * A bitmap is used as a database of scheduled priority functions
+ * (cf. po_function_BACKEND for the alternatives).
  */
 
 #ifndef po_function__H
@@ -11,6 +12,13 @@
 
 #include <po_cfg.h>
 #include <po_sys.h>
+#include <po_lib.h>
+#include <po_list.h>
+
+#if po_function_BACKEND != po_function_BACKEND_BITMAP && \
+    po_function_BACKEND != po_function_BACKEND_MAXNODE
+#error "Unknown po_function_BACKEND"
+#endif
 
 /*-GLOBAL-
  */
@@ -27,6 +35,16 @@ static struct _po_function_ServiceHandle* const po_priority =
   (struct _po_function_ServiceHandle*)0;
 typedef struct _po_function_ServiceHandle po_funcSrvH;
 
+#if po_function_OWNERS
+/*-GLOBAL-
+ * Owner tag: the pending calls tagged with it are linked together so they
+ * can be cancelled at once (cf. po_function_cancel).
+ */
+typedef struct _po_function_Owner {
+  po_list_List list;   /* pending calls */
+} po_function_Owner;
+#endif
+
 /* Priority function handle.
  */
 typedef struct _po_function_Handle {
@@ -35,6 +53,15 @@ typedef struct _po_function_Handle {
   #if po_function_TRACK_NAME // DEBUG_MODE
   char *name;
   #endif // DEBUG_MODE
+  #if po_function_FAIR_SOURCES
+  int source;  /* source id, selects the sub-queue of a fair level */
+  #endif
+  #if po_function_OWNERS
+  po_function_Owner *owner;    /* owner tag, NULL if none */
+  po_list_Node ownernode;      /* in owner's list while pending, else NULL */
+  struct _po_function_ServiceHandle *srvhandle; /* service holding the call,
+						   NULL if scheduler */
+  #endif
 } po_function_Handle;
 
 #if 0  // It used to be a priority function
@@ -52,8 +79,23 @@ typedef void (*po_function_ServiceFunc)(
 typedef struct {
   /* Service function: called with a handle to the requested service */
   po_function_ServiceFunc func;
+  #if po_function_OWNERS
+  /* Cancel function: removes the call held by the service handle and frees
+   * both (cf. po_function_cancel) */
+  po_function_ServiceFunc cancel;
+  #endif
 } po_function_Service;
 
+/* Initializer of a service's methods
+ */
+#if po_function_OWNERS
+#define po_function_SERVICE(func, cancel)				\
+  {(po_function_ServiceFunc)(func), (po_function_ServiceFunc)(cancel)}
+#else
+#define po_function_SERVICE(func, cancel)	\
+  {(po_function_ServiceFunc)(func)}
+#endif
+
 /* Additional debugging info to track running priority functions.
  * Eventually this can be replaced with stack unwinding.
  */
@@ -61,6 +103,9 @@ typedef struct _po_function_TrackRunType {
   struct _po_function_TrackRunType *prev;
   void *funcname;
   int priority;
+  #if po_perf_ENABLE
+  void *perf;                   /* counts of the function (cf. po_perf) */
+  #endif
 } po_function_TrackRunType;
 
 /* Service handle: service provided to other modules.
@@ -72,6 +117,67 @@ typedef struct _po_function_ServiceHandle {
   int priority;                 /* priority level of priority function */
 } po_function_ServiceHandle;
 
+#if po_function_FAIR_SOURCES
+
+/* Sub-queue of a fair level: calls from one source.
+ */
+typedef struct {
+  po_function_Handle *first;
+  po_function_Handle *last;
+  int weight;            /* calls served per round (at least 1) */
+  int deficit;           /* calls left to serve in current round */
+  int nPending;          /* number of waiting calls */
+  int maxPending;        /* peak number of waiting calls */
+  unsigned long nCalls;  /* total number of served calls */
+} po_function_FairQueue;
+
+/* Fair level: one sub-queue per source, served by deficit round robin.
+ * The storage is supplied by the user (cf. po_function_fairinit).
+ */
+typedef struct {
+  int current;           /* sub-queue being served */
+  volatile int nPending; /* number of waiting calls in all sub-queues */
+  po_function_FairQueue queue[po_function_FAIR_SOURCES];
+} po_function_Fair;
+
+#endif
+
+#if po_function_LEVEL_LIMITS
+
+/*-GLOBAL-
+ * Overflow policies of a priority level (cf. po_function_setlimit)
+ */
+enum {
+  po_function_LIMIT_REJECT,      /* the new call is not scheduled */
+  po_function_LIMIT_DROP_OLDEST, /* the oldest waiting call is discarded */
+  po_function_LIMIT_MERGE        /* the new call replaces a waiting call
+				    to the same function, in place */
+};
+
+/* Limit and counters of a priority level
+ */
+typedef struct {
+  int maxPending;         /* limit on waiting calls, 0 if none */
+  int policy;             /* overflow policy */
+  int nPending;           /* waiting calls (not the running batch) */
+  int peakPending;        /* peak number of waiting calls */
+  unsigned long nRejected;/* new calls not scheduled */
+  unsigned long nDropped; /* waiting calls discarded */
+  unsigned long nMerged;  /* new calls merged into waiting ones */
+} po_function_Limit;
+
+/*-GLOBAL-
+ * Function told of a call discarded by a level limit, before the call is
+ * freed: the new call if rejected is non-zero (po_function_LIMIT_REJECT,
+ * or a merge with nothing to merge into), else a waiting call dropped or
+ * replaced by a merge.
+ */
+typedef void (*po_function_OverflowHook)(int priority,
+					 po_function_Handle *pfhandle,
+					 int rejected);
+
+#endif
+
 /* Structure for bitmap's linked list
  */
 typedef struct {
@@ -81,6 +187,24 @@ typedef struct {
   #endif
   po_function_Handle * volatile last;
   po_function_Handle * volatile first;
+  #if po_function_FAIR_SOURCES
+  // Sub-queues replacing the list when this level is fair
+  po_function_Fair *fair;
+  #endif
+  #if po_function_CHAIN
+  // Running call, last of its batch: a call posted now at this level
+  // can be chained to it
+  po_function_Handle *tail;
+  // Call chained by the tail call, run right after it
+  po_function_Handle *chain;
+  #endif
+  #if po_function_LEVEL_LIMITS
+  po_function_Limit limit;
+  #endif
+  #if po_irq_NUM_SOURCES
+  // Interrupt sources raised at this level, one bit per source (cf. po_irq)
+  volatile unsigned irqPending;
+  #endif
 } po_function_BitmapList;
 
 /* Data structure per environment
@@ -95,18 +219,62 @@ typedef struct _po_function_Environ {
   volatile int maxpri;
 
   // This is to track running functions
-  #if po_DEBUG // DEBUG_MODE
-  po_function_TrackRunType *trackrun;
-  #endif // DEBUG_MODE
+  #if po_function_TRACK_RUN
+  po_function_TrackRunType * volatile trackrun;
+  #endif
 
   // Priority database: 1 bit and one linked list per priority level.
-  volatile unsigned bitmap;
+  volatile po_lib_Bitmap bitmap;
+
+  // Highest waiting call when it was posted above everything else,
+  // kept out of the bitmap and lists until its level is run.
+  #if po_function_BACKEND == po_function_BACKEND_MAXNODE
+  po_function_Handle * volatile maxnode;
+  int maxnodepri;
+  #endif
+
+  // Source id of the running priority function, inherited by the calls
+  // it makes.
+  #if po_function_FAIR_SOURCES
+  int source;
+  #endif
+
+  // Owner of the running priority function, inherited by the calls it
+  // makes.
+  #if po_function_OWNERS
+  po_function_Owner *owner;
+  #endif
+
+  // Told of the calls discarded by level limits
+  #if po_function_LEVEL_LIMITS
+  po_function_OverflowHook overflowhook;
+  #endif
+
   po_function_BitmapList list[po_function_NUM_PRI_LEVELS];
     
 } po_function_Environ;
 
+#if po_MULTI_INSTANCE
+
+#ifndef po_THREAD_LOCAL
+#error "po_MULTI_INSTANCE requires thread-local storage on this target"
+#endif
+
+/* Environment of the instance selected by the current thread
+ */
+extern po_THREAD_LOCAL po_function_Environ *po_function_EnvCurrent;
+#define po_function_Env (*po_function_EnvCurrent)
+
+#else
+
 extern po_function_Environ po_function_Env;
 
+#endif
+
+/* Mapping of priority level to priority bit in integer bitmap
+ */
+#define po_function_PRI_BIT(priority) (priority)
+
 /*-GLOBAL-
  * Returns current priority level
  */
@@ -130,6 +298,133 @@ static inline int po_function_getmaxpri(void)
   return po_function_Env.maxpri;
 }
 
+#if po_function_CHAIN
+/* Returns the handle of the running priority function if a call posted
+ * now at this level would be chained to it (cf. po_function_later), NULL
+ * otherwise. The handle is not needed anymore by then, so its block can
+ * be reused by the chained call.
+ */
+static inline po_function_Handle *po_function_chaintail(int priority)
+{
+  po_function_BitmapList *list;
+  if ( priority != po_function_Env.currpri ) return NULL;
+  list = &po_function_Env.list[priority];
+  return list->chain || list->first ? NULL : list->tail;
+}
+
+/* Returns non-zero if the handle of the running priority function has been
+ * reused by the call chained to it, in which case it must not be freed.
+ */
+static inline int po_function_ischained(po_function_Handle *pfhandle)
+{
+  return pfhandle == po_function_Env.list[po_function_Env.currpri].chain;
+}
+#endif
+
+#if po_function_FAIR_SOURCES
+/*-GLOBAL-
+ * Returns the source id of the running priority function. Calls made
+ * from it are queued under this source on fair levels.
+ */
+static inline int po_function_getsource(void)
+{
+  return po_function_Env.source;
+}
+
+/*-GLOBAL-
+ * Sets the source id for the calls that follow. A priority function
+ * inherits the source of its caller, so this is usually needed only by
+ * producers such as interrupt handlers, which should restore the previous
+ * source before returning.
+ */
+static inline int po_function_setsource(int source)
+{
+  int prevsource = po_function_Env.source;
+  #if po_DEBUG > 1 // DEBUG_MODE
+  if ( source < 0 || source >= po_function_FAIR_SOURCES )
+    po_error(po_error_FUNC_BAD_SOURCE);
+  #endif // DEBUG_MODE
+  po_function_Env.source = source;
+  return prevsource;
+}
+#endif
+
+#if po_function_OWNERS
+/*-GLOBAL-
+ * Returns the owner of the running priority function.
+ */
+static inline po_function_Owner *po_function_getowner(void)
+{
+  return po_function_Env.owner;
+}
+
+/*-GLOBAL-
+ * Sets the owner for the calls that follow, NULL for none, and returns
+ * the previous owner which should be restored afterwards. A priority
+ * function inherits the owner of its caller.
+ */
+static inline po_function_Owner *po_function_setowner(po_function_Owner *owner)
+{
+  po_function_Owner *prevowner = po_function_Env.owner;
+  po_function_Env.owner = owner;
+  return prevowner;
+}
+
+/*-GLOBAL-
+ * Initialization routine for owners.
+ */
+static inline void po_function_ownerinit(po_function_Owner *owner)
+{
+  po_list_init(&owner->list);
+}
+
+/*-GLOBAL-
+ * Initialization macro for statically allocated owners.
+ */
+#define po_function_OWNER_INIT(ownerPtr)  {po_list_INIT(&(ownerPtr)->list)}
+
+/* Tags a new call with the current owner, linking it to the owner's
+ * pending calls.
+ */
+static inline void po_function_tag(po_function_Handle *pfhandle)
+{
+  po_function_Owner *owner = po_function_Env.owner;
+  pfhandle->owner = owner;
+  pfhandle->srvhandle = NULL;
+  pfhandle->ownernode.next = NULL;
+  if ( owner ) {
+    int protectState = po_interrupt_disable();
+    po_list_pushtail(&owner->list, &pfhandle->ownernode);
+    po_interrupt_restore(protectState);
+  }
+}
+
+/* Unlinks a call from its owner's pending calls, when it runs or when it
+ * is discarded.
+ */
+static inline void po_function_untag(po_function_Handle *pfhandle)
+{
+  if ( pfhandle->ownernode.next ) {
+    int protectState = po_interrupt_disable();
+    if ( pfhandle->ownernode.next ) {
+      po_list_pop(&pfhandle->ownernode);
+      pfhandle->ownernode.next = NULL;
+    }
+    po_interrupt_restore(protectState);
+  }
+}
+
+/* Enters a call from the scheduler entry: the call is no longer pending,
+ * and it runs on behalf of its owner. Returns the previous owner, to be
+ * restored when the call returns.
+ */
+static inline po_function_Owner *po_function_ownerenter(po_function_Handle *pfhandle)
+{
+  po_function_untag(pfhandle);
+  return po_function_setowner(pfhandle->owner);
+}
+#endif
+
 /*-GLOBAL-INSERT-*/
 
 /*-GLOBAL-
@@ -143,15 +438,19 @@ void po_function_restorepri(int prevpri)
  * Schedule a priority function call that we are sure it will not be
  * immediately called (for its priority is not higher than the current
  * priority).
+ * Returns po_error_FUNC_LEVEL_FULL if the level limit rejected the call,
+ * in which case its handle has been freed, and 0 otherwise.
  */
-void po_function_later(po_function_Handle *pfhandle, int priority)
+int po_function_later(po_function_Handle *pfhandle, int priority)
 ;
 
 /*-GLOBAL-
  * Calls the priority function if priority level is above current one.
  * Otherwise, it schedules it for later call.
+ * Returns po_error_FUNC_LEVEL_FULL if the call was rejected
+ * (cf. po_function_later), and 0 otherwise.
  */
-void po_function_call(po_function_Handle *pfhandle, int priority)
+int po_function_call(po_function_Handle *pfhandle, int priority)
 ;
 
 /*-GLOBAL-
@@ -172,14 +471,81 @@ int po_function_raisepri(int priority)
 
 /*-GLOBAL-
  * Schedules priority functions or calls the requested service.
+ * Returns po_error_FUNC_LEVEL_FULL if a priority function call was
+ * rejected (cf. po_function_later), and 0 otherwise.
  */
-void po_function_service(
+int po_function_service(
     po_function_Handle *pfhandle,
     po_function_ServiceHandle *srvhandle,
     void (*func_entry_scheduler)(po_function_Handle*),
     int priority)
 ;
 
+#if po_function_FAIR_SOURCES
+/*-GLOBAL-
+ * Makes a priority level fair, or back to a simple fifo if fair is NULL.
+ * The calls at this level are kept in one sub-queue per source and are
+ * served by deficit round robin, so that a chatty source cannot starve
+ * the others. All weights are set to 1. This should be done at start up,
+ * while nothing is scheduled at this level.
+ */
+void po_function_fairinit(int priority, po_function_Fair *fair)
+;
+
+/*-GLOBAL-
+ * Sets the weight of a source on a fair level: the number of its calls
+ * served per round (at least 1). The level must have been made fair.
+ */
+void po_function_fairweight(int priority, int source, int weight)
+;
+#endif
+
+#if po_function_OWNERS
+/*-GLOBAL-
+ * Cancels all the pending calls of an owner: waiting in the scheduler,
+ * attached to signals or timers, or waiting in queues. The calls are
+ * freed and never run, and user signal handles become inactive. As with
+ * po_signal_detach, this should be called at a priority level not below
+ * the levels of the signal groups and clocks involved, and not from HWI.
+ * Returns the number of cancelled calls. The cost is proportional to the
+ * number of calls of the owner.
+ */
+int po_function_cancel(po_function_Owner *owner)
+;
+#endif
+
+#if po_function_LEVEL_LIMITS
+/*-GLOBAL-
+ * Limits the number of calls waiting at a priority level, 0 for no limit.
+ * When the limit is reached, a new call is handled according to policy:
+ * po_function_LIMIT_REJECT does not schedule it, po_function_LIMIT_DROP_OLDEST
+ * discards the oldest waiting call to make room for it, and
+ * po_function_LIMIT_MERGE replaces the oldest waiting call to the same
+ * priority function with it (otherwise it is rejected). Discarded calls are
+ * freed and never run. The calls of the batch being run by the scheduler
+ * are no longer waiting, and fair levels are not limited.
+ */
+void po_function_setlimit(int priority, int maxPending, int policy)
+;
+
+/*-GLOBAL-
+ * Copies the limit and counters of a priority level, then resets its peak
+ * depth to the current depth.
+ */
+void po_function_getlimit(int priority, po_function_Limit *limit)
+;
+
+/*-GLOBAL-
+ * Sets the function told of the calls discarded by level limits, NULL for
+ * none, and returns the previous one. A priority function call returns
+ * nothing, so this is how its caller learns that it was rejected; the
+ * counters of po_function_getlimit only give the totals. The hook runs in
+ * the context of the post, with interrupts enabled.
+ */
+po_function_OverflowHook po_function_setoverflowhook(po_function_OverflowHook hook)
+;
+#endif
+
 /*-GLOBAL-INSERT-END-*/
 
 /* Report scheduled priority functions
@@ -215,16 +581,39 @@ static inline void po_function_exitnow_(int prevpri)
   po_function_restorepri(prevpri);
 }
 
-#if po_DEBUG // DEBUG_MODE
+#if po_function_TRACK_RUN
+
+// The profiler samples the chain asynchronously: an entry is complete
+// before it is linked.
+#if po_profile_ENABLE
+#define po_function_trackrunlink() po_target_barrier()
+#else
+#define po_function_trackrunlink()
+#endif
+
+// The event counters are read when a function is entered and exited:
+// the counts in between go to the function on top of the chain.
+#if po_perf_ENABLE
+void po_perf_enter_(po_function_TrackRunType *run);
+void po_perf_exit_(po_function_TrackRunType *run);
+#define po_function_perfenter(run) po_perf_enter_(run)
+#define po_function_perfexit(run) po_perf_exit_(run)
+#else
+#define po_function_perfenter(run)
+#define po_function_perfexit(run)
+#endif
 
 #define po_function_trackrunenter(priority_, funcname_) \
   po_function_TrackRunType po__trackrun;                \
   po__trackrun.funcname = (void*)(funcname_);		\
   po__trackrun.priority = (priority_);			\
   po__trackrun.prev = po_function_Env.trackrun;		\
+  po_function_perfenter(&po__trackrun);			\
+  po_function_trackrunlink();				\
   po_function_Env.trackrun = &po__trackrun;
 
 #define po_function_trackrunexit()                      \
+  po_function_perfexit(&po__trackrun);			\
   po_function_Env.trackrun = po__trackrun.prev;
 
 #define po_function_enternow(priority, funcname)	\
@@ -235,7 +624,7 @@ static inline void po_function_exitnow_(int prevpri)
   po_function_trackrunexit();                           \
   po_function_exitnow_(prevpri);
 
-#else // NON_DEBUG_MODE_START
+#else
 
 #define po_function_enternow(priority, funcname)	\
   int prevpri = po_function_enternow_(priority);
@@ -243,7 +632,7 @@ static inline void po_function_exitnow_(int prevpri)
 #define po_function_exitnow()			        \
   po_function_exitnow_(prevpri);
 
-#endif // NON_DEBUG_MODE_END
+#endif
 
 /* Calls immediately the scheduler of the priority function, which means
  * the priority function must have equal priority level to current priority
@@ -251,21 +640,32 @@ static inline void po_function_exitnow_(int prevpri)
  */
 static inline void po_function_callschedulerentry(po_function_Handle *pfhandle)
 {
-  #if po_DEBUG // DEBUG_MODE
+  #if po_function_TRACK_RUN || po_function_FAIR_SOURCES
   po_function_Environ *env = &po_function_Env;
+  #endif
+  #if po_function_TRACK_RUN
   #if !po_function_TRACK_NAME
   po_function_trackrunenter(env->currpri, pfhandle->func);
   #else
   po_function_trackrunenter(env->currpri, pfhandle->name);
   #endif
-  #endif // DEBUG_MODE
+  #endif
+
+  #if po_function_FAIR_SOURCES
+  int source = env->source;
+  env->source = pfhandle->source;
+  #endif
 
   pfhandle->func(pfhandle);
   //po_free(pfhandle);
 
-  #if po_DEBUG // DEBUG_MODE
+  #if po_function_FAIR_SOURCES
+  env->source = source;
+  #endif
+
+  #if po_function_TRACK_RUN
   po_function_trackrunexit();
-  #endif // DEBUG_MODE
+  #endif
 }
 
 /*-GLOBAL-
@@ -316,6 +716,11 @@ static inline void po_function_setsrv(po_function_ServiceHandle *srvhandle, po_f
   srvhandle->service = service;
 }
 
+/*-GLOBAL-
+ * Init an environment: empty database, no running priority function.
+ */
+void po_function_envinit(po_function_Environ *env);
+
 /*-GLOBAL-
  * Module initialization.
  */
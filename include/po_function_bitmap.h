@@ -0,0 +1,176 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Bitmap backend of the database of waiting calls (cf. po_function_db.h).
+ * One bit per priority level indicating if there are awaiting priority
+ * functions at this level. If there are, then the priority functions are
+ * stored in a simple linked list (in sub-queues on fair levels). In order
+ * to insert at the end of the list and retrieve from the beginning of the
+ * list, the simple linked list for priority p is organized as follows:
+ *
+ *      L(p).first-> First-->Second-->Third-->Last-->NULL
+ *      L(p).last -> Last-->NULL
+ *
+ * Empty list
+ *      L(p).first = NULL
+ *      L(p).last -> (H*)&L(p).first (filling last automatically fills first)
+ */
+
+#ifndef po_function_bitmap__H
+#define po_function_bitmap__H
+
+#include <po_sys.h>
+#include <po_lib.h>
+#include <po_function.h>
+
+/* Mapping of priority bit in integer bitmap to priority level
+ * (cf. po_function_PRI_BIT)
+ */
+#define po_function_PRI_MAX(bitmap) (po_function_PRI_BIT(po_lib_msbmap(bitmap)))
+
+#if po_function_FAIR_SOURCES
+/* Insert a call in its source's sub-queue. Interrupts must be disabled.
+ */
+static inline void po_function_fairpush(po_function_Fair *fair,
+					po_function_Handle *pfhandle)
+{
+  po_function_FairQueue *queue = &fair->queue[pfhandle->source];
+
+  if ( queue->last ) queue->last->next = pfhandle;
+  else queue->first = pfhandle;
+  queue->last = pfhandle;
+
+  if ( ++queue->nPending > queue->maxPending )
+    queue->maxPending = queue->nPending;
+  fair->nPending++;
+}
+#endif
+
+/* Empties the database.
+ */
+static inline void po_function_bitmapinit(po_function_Environ *env)
+{
+  int i;
+  env->bitmap = 0;
+  for ( i = 0 ; i < po_function_NUM_PRI_LEVELS ; i++ ) {
+    env->list[i].last = (po_function_Handle*)&env->list[i].first;
+    env->list[i].first = NULL;
+  }
+}
+
+/* Marks a level as having waiting calls. Interrupts must be disabled.
+ */
+static inline void po_function_bitmapmark(po_function_Environ *env,
+					  int priority)
+{
+  if ( priority > env->maxpri ) {
+    env->maxpri = priority; // We cannot use maxpri in no-lock ISR version (?)
+  }
+  po_lib_BITMAP_SET(env->bitmap, po_function_PRI_BIT(priority));  // Critical if non-atomic
+}
+
+/* Adds a call at the tail of its level. Interrupts must be disabled.
+ */
+static inline void po_function_bitmapput(po_function_Environ *env,
+					 po_function_Handle *pfhandle,
+					 int priority)
+{
+  po_function_BitmapList *list = &env->list[priority];
+
+  po_function_bitmapmark(env, priority);
+  #if po_function_FAIR_SOURCES
+  if ( list->fair ) {
+    po_function_fairpush(list->fair, pfhandle);
+    return;
+  }
+  #endif
+  list->last->next = pfhandle;
+  list->last = pfhandle; // Do this first if non-lock ISR
+  #if po_function_LEVEL_LIMITS
+  if ( ++list->limit.nPending > list->limit.peakPending )
+    list->limit.peakPending = list->limit.nPending;
+  #endif
+
+  // If no-lock ISR (RE-CHECK) (there may be issues with non-atomic ptr load)
+  #if 0
+  {
+    po_function_Handle *tmp, *before = list->last;
+    // Preemptions here precede us
+    list->last = pfhandle;
+    // Preemptions here succeed us
+    while ( (tmp = before->next) != NULL )
+      before = tmp; // Ignore all that preceded us
+    before->next = pfhandle;
+  }
+  #endif
+}
+
+/* Takes the calls waiting in the list of a level, in order, and starts a
+ * new list so that they can be run without locking interrupts (in
+ * particular, the last node cannot be freed while the last pointer is
+ * pointing at it). Returns the first one, NULL if none. With level
+ * limits, the overflow policies unlink waiting calls, so the list is
+ * detached under lock.
+ */
+static inline po_function_Handle *po_function_bitmaptake(
+    po_function_Environ *env, int priority)
+{
+  po_function_BitmapList *list = &env->list[priority];
+  po_function_Handle *first;
+
+  #if po_function_LEVEL_LIMITS
+  int protectState = po_interrupt_disable();
+  first = list->first;
+  list->limit.nPending = 0;
+  list->first = NULL;
+  list->last = (po_function_Handle*)&(list->first);
+  po_interrupt_restore(protectState);
+  #else
+  first = list->first;
+  po_emulateirupt();
+  if ( first ) {
+    list->first = NULL;
+    po_emulateirupt();
+    list->last = (po_function_Handle*)&(list->first);
+  }
+  #endif
+  po_emulateirupt();
+  return first;
+}
+
+/* Returns non-zero if no priority function is waiting at this level.
+ */
+static inline int po_function_bitmapisempty(po_function_Environ *env,
+					    int priority)
+{
+  po_function_BitmapList *list = &env->list[priority];
+  #if po_irq_NUM_SOURCES
+  if ( list->irqPending ) return 0;
+  #endif
+  #if po_function_FAIR_SOURCES
+  if ( list->fair ) return list->fair->nPending == 0;
+  #endif
+  return list->first == NULL;
+}
+
+/* Clears the bit of a level found empty. Returns the highest level with
+ * waiting calls.
+ */
+static inline int po_function_bitmapmax(po_function_Environ *env,
+					int priority)
+{
+  po_lib_Bitmap bitmap;
+
+  // Bit clear instruction must be atomic
+  int protectState = po_interrupt_disable();
+  po_lib_BITMAP_CLR(env->bitmap, po_function_PRI_BIT(priority));
+  po_interrupt_restore(protectState);
+
+  po_emulateirupt();
+  bitmap = env->bitmap;
+  po_emulateirupt();
+  return po_function_PRI_MAX(bitmap);
+}
+
+#endif // po_function_bitmap__H
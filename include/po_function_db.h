@@ -0,0 +1,49 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Database of the priority functions waiting at each priority level, as
+ * seen by the scheduler. Each backend (cf. po_function_BACKEND) has its
+ * own file and implements these operations:
+ *
+ *      po_function_dbinit(env)             empties the database
+ *      po_function_dbput(env, h, p)        adds a call at the tail of level p
+ *      po_function_dbmark(env, p)          level p has waiting calls that
+ *                                          are not in the database (po_irq)
+ *      po_function_dbtake(env, p)          takes the calls waiting at level p
+ *      po_function_dbisempty(env, p)       non-zero if nothing waits at p
+ *      po_function_dbmax(env, p)           level p is empty: returns the
+ *                                          highest level with waiting calls
+ *
+ * put and mark are called with interrupts disabled, the others take care
+ * of the interrupts themselves.
+ */
+
+#ifndef po_function_db__H
+#define po_function_db__H
+
+#include <po_function_bitmap.h>
+
+#if po_function_BACKEND == po_function_BACKEND_MAXNODE
+
+#include <po_function_maxnode.h>
+
+#define po_function_dbinit     po_function_maxnodeinit
+#define po_function_dbput      po_function_maxnodeput
+#define po_function_dbmark     po_function_maxnodemark
+#define po_function_dbtake     po_function_maxnodetake
+#define po_function_dbisempty  po_function_maxnodeisempty
+#define po_function_dbmax      po_function_maxnodemax
+
+#else
+
+#define po_function_dbinit     po_function_bitmapinit
+#define po_function_dbput      po_function_bitmapput
+#define po_function_dbmark     po_function_bitmapmark
+#define po_function_dbtake     po_function_bitmaptake
+#define po_function_dbisempty  po_function_bitmapisempty
+#define po_function_dbmax      po_function_bitmapmax
+
+#endif
+
+#endif // po_function_db__H
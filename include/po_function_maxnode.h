@@ -0,0 +1,101 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Maxnode backend of the database of waiting calls (cf. po_function_db.h).
+ * It is the bitmap backend plus a one call cache: the call posted above
+ * all waiting calls is kept in env->maxnode instead of setting its bit and
+ * appending it to its list. When its level is taken, it is put back at
+ * the head of the list (it is the oldest call at this level) and the
+ * batch is run as usual. Fair levels and limited levels always use the
+ * lists.
+ */
+
+#ifndef po_function_maxnode__H
+#define po_function_maxnode__H
+
+#include <po_function_bitmap.h>
+
+/* Empties the database.
+ */
+static inline void po_function_maxnodeinit(po_function_Environ *env)
+{
+  po_function_bitmapinit(env);
+  env->maxnode = NULL;
+}
+
+/* Marks a level as having waiting calls. Interrupts must be disabled.
+ */
+static inline void po_function_maxnodemark(po_function_Environ *env,
+					   int priority)
+{
+  po_function_bitmapmark(env, priority);
+}
+
+/* Adds a call at the tail of its level, in the cache if it is above all
+ * waiting calls. Interrupts must be disabled.
+ */
+static inline void po_function_maxnodeput(po_function_Environ *env,
+					  po_function_Handle *pfhandle,
+					  int priority)
+{
+  if ( env->maxnode || priority <= env->maxpri
+       #if po_function_FAIR_SOURCES
+       || env->list[priority].fair
+       #endif
+       #if po_function_LEVEL_LIMITS
+       || env->list[priority].limit.maxPending
+       #endif
+       ) {
+    po_function_bitmapput(env, pfhandle, priority);
+    return;
+  }
+  env->maxnode = pfhandle;
+  env->maxnodepri = priority;
+  env->maxpri = priority;
+}
+
+/* Takes the calls waiting at a level, the cached call first if it
+ * belongs to this level. Returns the first one, NULL if none.
+ */
+static inline po_function_Handle *po_function_maxnodetake(
+    po_function_Environ *env, int priority)
+{
+  po_function_BitmapList *list = &env->list[priority];
+  po_function_Handle *pfhandle;
+  int protectState = po_interrupt_disable();
+
+  pfhandle = env->maxnode;
+  if ( pfhandle && env->maxnodepri == priority ) {
+    env->maxnode = NULL;
+    if ( (pfhandle->next = list->first) == NULL ) list->last = pfhandle;
+    list->first = pfhandle;
+  }
+  po_interrupt_restore(protectState);
+
+  return po_function_bitmaptake(env, priority);
+}
+
+/* Returns non-zero if no priority function is waiting at this level.
+ */
+static inline int po_function_maxnodeisempty(po_function_Environ *env,
+					     int priority)
+{
+  if ( env->maxnode && env->maxnodepri == priority ) return 0;
+  return po_function_bitmapisempty(env, priority);
+}
+
+/* Clears the bit of a level found empty. Returns the highest level with
+ * waiting calls, the cached call included.
+ */
+static inline int po_function_maxnodemax(po_function_Environ *env,
+					 int priority)
+{
+  int maxpri = po_function_bitmapmax(env, priority);
+  int protectState = po_interrupt_disable();
+  if ( env->maxnode && env->maxnodepri > maxpri ) maxpri = env->maxnodepri;
+  po_interrupt_restore(protectState);
+  return maxpri;
+}
+
+#endif // po_function_maxnode__H
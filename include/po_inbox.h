@@ -0,0 +1,113 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Inbox of a Portos thread on hosted targets: other threads (I/O threads,
+ * callbacks of libraries) schedule functions at some priority level in
+ * the thread running Portos. Portos itself is not thread safe.
+ *
+ * A post is a preallocated handle owned by the poster: posting takes no
+ * lock and allocates nothing, it pushes the post on a lock-free list and
+ * wakes the Portos thread through an eventfd when the list was empty. The
+ * Portos thread drains the whole list at once, schedules the batch with
+ * po_function_later and runs it in priority order. A post can be posted
+ * again as soon as its function has started.
+ *
+ * The handles are never freed by Portos, so the levels posted to must
+ * have no pending limit (cf. po_function_setlimit).
+ */
+
+#ifndef po_inbox__H
+#define po_inbox__H
+
+#include <po_sys.h>
+#include <po_function.h>
+
+#if po_target_HOSTED
+
+/*-GLOBAL-
+ * Function of a post
+ */
+typedef void (*po_inbox_Func)(void *arg);
+
+/*-GLOBAL-
+ * A post. Initialized by po_inbox_postinit.
+ */
+typedef struct _po_inbox_Post {
+  po_function_Handle pfhandle;  /* MUST BE FIRST */
+  po_inbox_Func func;
+  void *arg;
+  int priority;
+  volatile int pending;         /* posted, not yet started */
+} po_inbox_Post;
+
+/*-GLOBAL-
+ * An inbox
+ */
+typedef struct {
+  po_inbox_Post * volatile head; /* posts, last one first */
+  int fd;                       /* readable when posts are waiting */
+  int wfd;                      /* written to wake the Portos thread */
+  unsigned long nPosts;         /* posts run */
+  unsigned long nBatches;       /* drains that found posts */
+  int maxBatch;                 /* largest batch */
+} po_inbox_Inbox;
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Init an inbox. Returns 0, or -1 if its file descriptor could not be
+ * created.
+ */
+int po_inbox_init(po_inbox_Inbox *inbox)
+;
+
+/*-GLOBAL-
+ * Closes the file descriptors of an inbox.
+ */
+void po_inbox_close(po_inbox_Inbox *inbox)
+;
+
+/*-GLOBAL-
+ * Init a post that calls func(arg) at a priority level.
+ */
+void po_inbox_postinit(po_inbox_Post *post, int priority, po_inbox_Func func,
+		       void *arg)
+;
+
+/*-GLOBAL-
+ * Posts to the inbox, from any thread. Returns 0, or -1 if the post is
+ * still pending.
+ */
+int po_inbox_post(po_inbox_Inbox *inbox, po_inbox_Post *post)
+;
+
+/*-GLOBAL-
+ * Schedules the waiting posts and runs those above the current level,
+ * from the Portos thread. Returns the number of posts.
+ */
+int po_inbox_drain(po_inbox_Inbox *inbox)
+;
+
+/*-GLOBAL-
+ * Waits up to timeout milliseconds (-1 for ever) for posts, then drains
+ * them. Called from the Portos thread outside priority functions. Returns
+ * the number of posts.
+ */
+int po_inbox_wait(po_inbox_Inbox *inbox, int timeout)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+/*-GLOBAL-
+ * File descriptor of an inbox, readable when posts are waiting (eg, to
+ * wait for it with other file descriptors).
+ */
+static inline int po_inbox_fd(po_inbox_Inbox *inbox)
+{
+  return inbox->fd;
+}
+
+#endif // po_target_HOSTED
+
+#endif // po_inbox__H
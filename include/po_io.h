@@ -0,0 +1,163 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Asynchronous file I/O on Linux hosted targets. po_io_read and
+ * po_io_write return at once; the I/O runs off the Portos thread and its
+ * result (a byte count, or minus an errno value) is given to a completion
+ * function run at a chosen priority level, like po_offload's:
+ *
+ *      static void written(void *arg, intptr_t result)
+ *      {
+ *        ...                                      // level 2
+ *      }
+ *
+ *      po_io_write(&Io, fd, record, size, offset, written, record, 2);
+ *
+ * The I/O goes to an io_uring when the kernel provides one. The requests
+ * made at a priority level are submitted together by a call scheduled at
+ * that level, so that a burst of requests costs one system call. Requests
+ * on buffers registered up front with po_io_register use fixed buffers,
+ * which the kernel does not map for each request. The completions are
+ * found through an eventfd waited for by a poller (cf. po_poll.h), by a
+ * call at the level given to po_io_init.
+ *
+ * Without io_uring, or if asked to, the I/O is offloaded to the worker
+ * pool of po_offload, which must be started with the poller's inbox.
+ *
+ * Requests are preallocated, and buffers must stay valid until their
+ * completion has run.
+ */
+
+#ifndef po_io__H
+#define po_io__H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <po_sys.h>
+#include <po_poll.h>
+#include <po_offload.h>
+
+#if po_target_HOSTED && defined(__linux__)
+
+/* Number of requests in progress at most and of registered buffers. They
+ * can be set on the command line.
+ */
+#ifndef po_io_NUM_REQUESTS
+#define po_io_NUM_REQUESTS 64
+#endif
+#ifndef po_io_MAX_BUFFERS
+#define po_io_MAX_BUFFERS  16
+#endif
+
+/* Modes of po_io_init
+ */
+#define po_io_AUTO    0         /* io_uring if available, else po_offload */
+#define po_io_OFFLOAD 1         /* po_offload only */
+
+/*-GLOBAL-
+ * Completion of a request
+ */
+typedef po_offload_Done po_io_Done;
+
+struct _po_io_Context;
+
+/*-GLOBAL-
+ * A request
+ */
+typedef struct _po_io_Request {
+  struct _po_io_Request *next;  /* in the free list */
+  struct _po_io_Context *io;
+  int write;
+  int fd;
+  void *buf;
+  size_t len;
+  off_t offset;
+  po_io_Done done;
+  void *arg;
+  int priority;
+} po_io_Request;
+
+/*-GLOBAL-
+ * An I/O context
+ */
+typedef struct _po_io_Context {
+  int ringfd;                   /* io_uring, -1 when offloading */
+  int efd;                      /* eventfd signaled on completions */
+  po_poll_Poller *poller;
+  int priority;                 /* level of the completion reaping */
+  po_poll_Handle reaper;
+
+  // Rings shared with the kernel
+  unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+  unsigned *cqHead, *cqTail, *cqMask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sqMap, *cqMap;
+  size_t sqMapSize, cqMapSize, sqesSize;
+  unsigned tail;                /* submission tail, not yet published */
+  int nQueued;                  /* requests not yet submitted */
+  int submitLevel;              /* level with a submission scheduled, or -1 */
+
+  struct iovec buffers[po_io_MAX_BUFFERS];
+  int nBuffers;
+
+  po_io_Request *free;
+  unsigned long nRequests;      /* requests made */
+  unsigned long nSubmits;       /* submissions to the kernel */
+  int maxBatch;                 /* most requests submitted at once */
+  po_io_Request request[po_io_NUM_REQUESTS];
+} po_io_Context;
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Init an I/O context whose completions are reaped at a priority level
+ * through poller, in a mode (po_io_AUTO or po_io_OFFLOAD). Returns 0, or
+ * -1 for an unknown mode.
+ */
+int po_io_init(po_io_Context *io, po_poll_Poller *poller, int priority,
+	       int mode)
+;
+
+/*-GLOBAL-
+ * Registers buffers up front, with the buffers registered before. Returns
+ * 0, or -1 if there are too many or the kernel refuses them.
+ */
+int po_io_register(po_io_Context *io, const struct iovec *buffers, int n)
+;
+
+/*-GLOBAL-
+ * Closes an I/O context whose requests have all completed.
+ */
+void po_io_close(po_io_Context *io)
+;
+
+/*-GLOBAL-
+ * Returns non-zero if the requests go to an io_uring.
+ */
+int po_io_isring(po_io_Context *io)
+;
+
+/*-GLOBAL-
+ * Reads len bytes at offset of fd into buf, then calls done(arg, result)
+ * at a priority level. Returns 0, or -1 if there is no request left.
+ */
+int po_io_read(po_io_Context *io, int fd, void *buf, size_t len,
+	       off_t offset, po_io_Done done, void *arg, int priority)
+;
+
+/*-GLOBAL-
+ * Writes len bytes of buf at offset of fd, then calls done(arg, result)
+ * at a priority level. Returns 0, or -1 if there is no request left.
+ */
+int po_io_write(po_io_Context *io, int fd, const void *buf, size_t len,
+		off_t offset, po_io_Done done, void *arg, int priority)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+#endif // po_target_HOSTED && __linux__
+
+#endif // po_io__H
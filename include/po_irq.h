@@ -0,0 +1,100 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Dispatch table from interrupt sources to functions run at a fixed
+ * priority level. An interrupt handler raises its source, which only sets
+ * a pending bit: there is no allocation and no linked list in the
+ * interrupt path. The scheduler then calls the bound function at its
+ * priority level, before the priority functions waiting at this level.
+ * Several raises of a source before it is dispatched result in one call.
+ */
+
+#ifndef po_irq__H
+#define po_irq__H
+
+#include <po_sys.h>
+#include <po_lib.h>
+#include <po_function.h>
+#include <po_function_db.h>
+
+#if po_irq_NUM_SOURCES
+
+// The pending sources of a level are the bits of an unsigned
+#if po_irq_NUM_SOURCES > po_INT_SIZE
+#error "At most po_INT_SIZE interrupt sources"
+#endif
+
+/*-GLOBAL-
+ * Function bound to an interrupt source
+ */
+typedef void (*po_irq_Func)(void *arg);
+
+/* Interrupt source entry. The handle is preallocated and never freed.
+ */
+typedef struct {
+  po_function_Handle pfhandle;  /* MUST BE FIRST */
+  po_irq_Func func;             /* NULL if not bound */
+  void *arg;
+  int priority;
+} po_irq_Source;
+
+/* Dispatch table, one entry per interrupt source. With multiple instances,
+ * it is the table selected by the current thread.
+ */
+#if po_MULTI_INSTANCE
+extern po_THREAD_LOCAL po_irq_Source *po_irq_TableP;
+#define po_irq_Table po_irq_TableP
+#else
+extern po_irq_Source po_irq_Table[po_irq_NUM_SOURCES];
+#endif
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Binds an interrupt source to a function called with arg at the given
+ * priority level when the source is raised.
+ */
+void po_irq_bind(int source, int priority, po_irq_Func func, void *arg)
+;
+
+/*-GLOBAL-
+ * Unbinds an interrupt source. A pending raise is dropped.
+ */
+void po_irq_unbind(int source)
+;
+
+/*-GLOBAL-
+ * Called by the scheduler at the priority level of list: calls the
+ * functions of the sources raised at this level, higher source ids first.
+ */
+void po_irq_dispatch(po_function_BitmapList *list)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+/*-GLOBAL-
+ * Raises an interrupt source from its handler, which should be wrapped
+ * with po_interrupt_enter and po_interrupt_exit as usual so that the bound
+ * function runs when the handler exits (if its level is high enough).
+ */
+static inline void po_irq_raise(int source)
+{
+  po_function_Environ *env = &po_function_Env;
+  int priority, protectState;
+
+  #if po_DEBUG > 1 // DEBUG_MODE
+  if ( source < 0 || source >= po_irq_NUM_SOURCES || !po_irq_Table[source].func )
+    po_error(po_error_IRQ_BAD_SOURCE);
+  #endif // DEBUG_MODE
+
+  priority = po_irq_Table[source].priority;
+  protectState = po_interrupt_disable();
+  env->list[priority].irqPending |= 1u << source;
+  po_function_dbmark(env, priority);
+  po_interrupt_restore(protectState);
+}
+
+#endif // po_irq_NUM_SOURCES
+
+#endif // po_irq__H
@@ -41,6 +41,21 @@
 #define po_lib_BIT_TOGGLE(x, bit) ((x) ^= 1 << (bit))
 #define po_lib_BIT_TEST(x, bit) ((x) & (1 << (bit)))
 
+/* Bitmap of the scheduler: one bit per priority level, in one word. The
+ * word is wider than an int if there are more levels than int bits, eg,
+ * 64 levels on LP64 hosts.
+ */
+#if po_function_NUM_PRI_LEVELS <= po_INT_SIZE
+typedef unsigned po_lib_Bitmap;
+#elif po_function_NUM_PRI_LEVELS <= 64
+typedef unsigned long long po_lib_Bitmap;
+#else
+#error "At most 64 priority levels"
+#endif
+
+#define po_lib_BITMAP_SET(x, bit) ((x) |= (po_lib_Bitmap)1 << (bit))
+#define po_lib_BITMAP_CLR(x, bit) ((x) &= ~((po_lib_Bitmap)1 << (bit)))
+
 /*-GLOBAL-INSERT-*/
 
 /*-GLOBAL-
@@ -61,4 +76,18 @@ static inline int po_lib_msb(unsigned x)
   #endif
 }
 
+/* Returns MSB position of a bitmap, -1 if x is 0.
+ */
+static inline int po_lib_msbmap(po_lib_Bitmap x)
+{
+  #if po_function_NUM_PRI_LEVELS <= po_INT_SIZE
+  return po_lib_msb(x);
+  #elif po_lib_MSB_HW
+  return po_lib_msb64_hw(x);
+  #else
+  unsigned high = (unsigned)(x >> 32);
+  return high ? 32 + po_lib_msb(high) : po_lib_msb((unsigned)x);
+  #endif
+}
+
 #endif // po_lib__H
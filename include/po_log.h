@@ -10,25 +10,42 @@
 #ifndef po_log__H
 #define po_log__H
 
-#include <portos.h>
+#include <stdint.h>
+#include <po_sys.h>
+#include <po_memory.h>
+#include <po_function.h>
+#include <po_prep.h>
+
+/* Log word: large enough for the address of the format string, and for
+ * pointer values.
+ */
+typedef intptr_t po_log_Word;
 
 /* Circular buffer handle.
  */
 typedef struct {
-  int *buffer;
+  po_log_Word *buffer;
   volatile int wrptr;
   int mask;
   int priority;
 } po_log_Handle;
 
-/* Default handle.
+/* Default handle. With multiple instances, it is the handle selected by
+ * the current thread.
  */
+#if po_MULTI_INSTANCE
+extern po_THREAD_LOCAL po_log_Handle *po_log_HandleDefaultP;
+#  ifndef po_INIT_FILE
+#  define po_log_HandleDefault (*po_log_HandleDefaultP)
+#  endif
+#else
 extern po_log_Handle po_log_HandleDefault;
+#endif
 
 /* Static initialization of circular buffer.
  * Initialize a logging area with user-supplied buffer.
- * buffer has to be int aligned (e.g. int buffer[128]).
- * nelements is number of int elements in buffer and must be a power of 2.
+ * buffer is an array of log words (e.g. po_log_Word buffer[128]).
+ * nelements is number of words in buffer and must be a power of 2.
  * Logging for this handle occurs at specified priority level.
  * Example: po_log_Handle myhandle = po_log_HANDLEINIT(buffer, 512, 7);
  */
@@ -36,7 +53,8 @@ extern po_log_Handle po_log_HandleDefault;
   {(buffer), 0, (nelements) - 1, (priority)}
 
 /* Priority function that performs logging into a circular buffer. It
- * prints 1 format string and 2 int values.
+ * prints 1 format string and 2 values (ints, or pointers cast to
+ * po_log_Word).
  * For a given buffer, the priority level should be fixed in order to
  * prevent data corruption.
  * The formatting is not performed on the target platform. The host machine
@@ -47,11 +65,11 @@ void po_log_pf(
     #ifndef po_log_NO_PRIORITY
     po_priority(handle->priority),
     #endif
-    po_log_Handle *handle, const char *format, int a0, int a1);
+    po_log_Handle *handle, const char *format, po_log_Word a0, po_log_Word a1);
 
 /* Shorthand version for po_log_pf and that hides the priority function
  * and handle details: it uses the default handle.
  */
-void po_log(const char *format, int a0, int a1);
+void po_log(const char *format, po_log_Word a0, po_log_Word a1);
 
 #endif // po_log__H
@@ -214,12 +214,29 @@ typedef struct {
   extern po_memory_Region region
 #endif
 
-/* Default memory region when it's not specified
+/* Default memory region when it's not specified. With multiple instances,
+ * it is the region selected by the current thread.
  */
-#ifndef po_INIT_FILE
+#if po_MULTI_INSTANCE
+extern po_THREAD_LOCAL po_memory_Region *po_memory_RegionDefaultP;
+#  ifndef po_INIT_FILE
+#  define po_memory_RegionDefault (*po_memory_RegionDefaultP)
+#  endif
+#elif !defined(po_INIT_FILE)
 extern po_memory_Region po_memory_RegionDefault;
 #endif
 
+#if po_memory_PRIORITY_REGIONS
+/* Preferred region of the handles of each priority level, NULL for none
+ * (cf. po_gmalloc_pri).
+ */
+#if po_MULTI_INSTANCE
+extern po_THREAD_LOCAL po_memory_Region *po_memory_RegionPri[po_function_NUM_PRI_LEVELS];
+#else
+extern po_memory_Region *po_memory_RegionPri[po_function_NUM_PRI_LEVELS];
+#endif
+#endif
+
 /*-GLOBAL-INSERT-*/
 
 /*-GLOBAL-
@@ -266,6 +283,31 @@ void *po_gmalloc_forever(int size, po_memory_Region *region, char *file, int lin
 #endif
 ;
 
+#if po_memory_PRIORITY_REGIONS
+/*-GLOBAL-
+ * Allocates a block of a free list index for a handle running at some
+ * priority level. The region of this level is tried first, then the
+ * regions of the lower levels, and finally the fallback region where the
+ * heap full error, if any, is reported as usual. Priorities above the
+ * highest level (eg, from HWI) use the highest level, and those below 0
+ * (eg, outside priority functions) go to the fallback region directly.
+ */
+#if po_memory_TRACK_ALLOC <= 1
+void *po_gmalloc_pri(int index, int priority, po_memory_Region *fallback)
+#else
+void *po_gmalloc_pri(int index, int priority, po_memory_Region *fallback,
+		     char *file, int line)
+#endif
+;
+
+/*-GLOBAL-
+ * Sets the preferred region of the handles of a priority level, NULL for
+ * none.
+ */
+void po_memory_setpriregion(int priority, po_memory_Region *region)
+;
+#endif
+
 /*-GLOBAL-
  * Init memory region. An inline function wrapper should be called.
  */
@@ -292,6 +334,16 @@ static inline void *po_gmalloc_const(int size, po_memory_Region *region, char *f
   #endif
 }
 
+/* Returns non-zero if an allocated block comes from the free list index of
+ * region, ie, if it can be reused as is for a block of that size.
+ */
+static inline int po_memory_isindex(void *block, int index, po_memory_Region *region)
+{
+  po_memory_HeaderType *header =
+    (po_memory_HeaderType*)((char*)block - po_memory_HEADER_SIZE);
+  return header->freeList == &region->freeList[index];
+}
+
 /*-GLOBAL-
  * Functions using the a user supplied region.
  */
@@ -332,5 +384,35 @@ static inline void *po_gmalloc_const(int size, po_memory_Region *region, char *f
 #define po_smalloc_index(index)  po_rmalloc_index((index), &po_memory_RegionSystem)
 #define po_scalloc(size)         po_rcalloc((size), &po_memory_RegionSystem)
 
+/*-GLOBAL-
+ * Functions used by portos for the handles of a priority level: the
+ * region is chosen by priority (cf. po_gmalloc_pri), region being the
+ * fallback. The size must be a constant.
+ */
+#if !po_memory_PRIORITY_REGIONS
+#define po_rmalloc_pri(size, priority, region)   po_rmalloc_const((size), (region))
+#define po_rmalloc_priP(size, priority, region)  po_rmalloc_constP((size), (region))
+#elif po_memory_TRACK_ALLOC <= 1
+#define po_rmalloc_pri(size, priority, region)   po_gmalloc_pri(po_memory_size2index(size), (priority), (region))
+#define po_rmalloc_priP(size, priority, region)  po_gmalloc_pri(po_memory_size2index(size), (priority), (region))
+#else
+#define po_rmalloc_pri(size, priority, region)   po_gmalloc_pri(po_memory_size2index(size), (priority), (region), __FILE__, __LINE__)
+#define po_rmalloc_priP(size, priority, region)  po_gmalloc_pri(po_memory_size2index(size), (priority), (region), %f, %l)
+#endif
+#define po_smalloc_priP(size, priority)  po_rmalloc_priP((size), (priority), &po_memory_RegionSystem)
+
+/* Region where the handles of a priority level are preferably allocated,
+ * region being the fallback.
+ */
+static inline po_memory_Region *po_memory_priregion(int priority, po_memory_Region *region)
+{
+  #if po_memory_PRIORITY_REGIONS
+  if ( priority >= 0 && priority < po_function_NUM_PRI_LEVELS &&
+       po_memory_RegionPri[priority] )
+    region = po_memory_RegionPri[priority];
+  #endif
+  return region;
+}
+
 
 #endif // po_memory__H
@@ -0,0 +1,141 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Mutexes based on priority ceiling. A mutex is registered with the
+ * highest priority level of the priority functions that use it. Locking
+ * raises the current priority level to this ceiling, without masking
+ * interrupts, so that none of the other users can preempt the holder.
+ * Unlocking restores the previous level and runs the priority functions
+ * that were posted above it in the meantime. As with po_function_raisepri,
+ * a mutex cannot be used from HWI.
+ */
+
+#ifndef po_mutex__H
+#define po_mutex__H
+
+#include <po_sys.h>
+#include <po_function.h>
+
+#if po_mutex_STATS
+/*-GLOBAL-
+ * Mutex statistics, hold times in po_target_timestamp() units
+ */
+typedef struct {
+  unsigned long nLocks;    /* number of locks */
+  unsigned long holdMax;   /* longest hold time */
+  unsigned long holdTotal; /* sum of hold times */
+} po_mutex_Stats;
+#endif
+
+/* Mutex.
+ */
+typedef struct {
+  int ceiling;             /* highest level of the users */
+  int prevpri;             /* level restored by unlock */
+  #if po_DEBUG // DEBUG_MODE
+  int locked;
+  #endif // DEBUG_MODE
+  #if po_mutex_STATS
+  unsigned long lockTime;  /* time stamp of lock */
+  po_mutex_Stats stats;
+  #endif
+} po_mutex_Mutex;
+
+/*-GLOBAL-
+ * Initialization macro for statically allocated mutexes.
+ */
+#if po_mutex_STATS
+#  define po_mutex_STATS_INIT , 0, {0, 0, 0}
+#else
+#  define po_mutex_STATS_INIT
+#endif
+#if po_DEBUG
+#  define po_mutex_INIT(ceiling) { (ceiling), -1, 0 po_mutex_STATS_INIT }
+#else
+#  define po_mutex_INIT(ceiling) { (ceiling), -1 po_mutex_STATS_INIT }
+#endif
+
+/*-GLOBAL-
+ * Initialization routine for dynamically allocated mutexes.
+ */
+static inline void po_mutex_init(po_mutex_Mutex *mutex, int ceiling)
+{
+  mutex->ceiling = ceiling;
+  mutex->prevpri = -1;
+  #if po_DEBUG // DEBUG_MODE
+  mutex->locked = 0;
+  #endif // DEBUG_MODE
+  #if po_mutex_STATS
+  mutex->stats.nLocks = 0;
+  mutex->stats.holdMax = mutex->stats.holdTotal = 0;
+  #endif
+}
+
+/*-GLOBAL-
+ * Locks a mutex: raises the current priority level to the mutex ceiling.
+ * Priority functions posted meanwhile at or below the ceiling wait until
+ * it is unlocked. Mutexes must be unlocked in the reverse order of locking.
+ */
+static inline void po_mutex_lock(po_mutex_Mutex *mutex)
+{
+  int prevpri = po_function_getpri();
+
+  #if po_DEBUG // DEBUG_MODE
+  if ( prevpri > mutex->ceiling ) po_error(po_error_MUTEX_ABOVE_CEILING);
+  if ( mutex->locked ) po_error(po_error_MUTEX_NESTED);
+  mutex->locked = 1;
+  #endif // DEBUG_MODE
+
+  // No other user can run from now on: the mutex fields are ours
+  if ( mutex->ceiling > prevpri ) po_function_setpri(mutex->ceiling);
+  mutex->prevpri = prevpri;
+
+  #if po_mutex_STATS
+  mutex->stats.nLocks++;
+  mutex->lockTime = po_target_timestamp();
+  #endif
+}
+
+/*-GLOBAL-
+ * Unlocks a mutex: restores the priority level it was locked at, and
+ * runs the priority functions waiting above it.
+ */
+static inline void po_mutex_unlock(po_mutex_Mutex *mutex)
+{
+  int prevpri = mutex->prevpri;
+
+  #if po_mutex_STATS
+  unsigned long hold = po_target_timestamp() - mutex->lockTime;
+  if ( hold > mutex->stats.holdMax ) mutex->stats.holdMax = hold;
+  mutex->stats.holdTotal += hold;
+  #endif
+
+  #if po_DEBUG // DEBUG_MODE
+  if ( !mutex->locked ) po_error(po_error_MUTEX_NOT_LOCKED);
+  if ( po_function_getpri() !=
+       (mutex->ceiling > prevpri ? mutex->ceiling : prevpri) )
+    po_error(po_error_MUTEX_ORDER);
+  mutex->locked = 0;
+  #endif // DEBUG_MODE
+
+  po_function_restorepri(prevpri);
+}
+
+#if po_mutex_STATS
+/*-GLOBAL-
+ * Copies the statistics of a mutex, then resets its longest hold time.
+ */
+static inline void po_mutex_getstats(po_mutex_Mutex *mutex,
+				     po_mutex_Stats *stats)
+{
+  // Raise to the ceiling to keep the users out while copying
+  int prevpri = po_function_getpri();
+  if ( mutex->ceiling > prevpri ) po_function_setpri(mutex->ceiling);
+  *stats = mutex->stats;
+  mutex->stats.holdMax = 0;
+  po_function_restorepri(prevpri);
+}
+#endif
+
+#endif // po_mutex__H
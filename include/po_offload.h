@@ -0,0 +1,121 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Offload of blocking work on hosted targets: priority functions run to
+ * completion and must not block, so slow calls (file reads, compression)
+ * are handed to a fixed pool of worker threads. po_offload runs a work
+ * function on a worker, then calls a completion function with its result
+ * at a chosen priority level, in the Portos thread:
+ *
+ *      static intptr_t readfile(void *arg)
+ *      {
+ *        return read(...);                       // any worker thread
+ *      }
+ *
+ *      static void fileread(void *arg, intptr_t result)
+ *      {
+ *        process(po_priority, arg, result);      // Portos thread, level 3
+ *      }
+ *
+ *      po_offload(readfile, request, fileread, 3);
+ *
+ * The jobs are preallocated: submitting takes one from a free list and
+ * fails when there is none left. The completions are posts to the inbox
+ * given to po_offload_init (cf. po_inbox.h), which the Portos thread
+ * drains in its event loop, so the completion levels must have no pending
+ * limit. The pool serves a single Portos thread.
+ */
+
+#ifndef po_offload__H
+#define po_offload__H
+
+#include <stdint.h>
+#include <po_sys.h>
+#include <po_inbox.h>
+
+#if po_target_HOSTED
+
+#include <pthread.h>
+
+/* Number of jobs and maximum number of workers. They can be set on the
+ * command line.
+ */
+#ifndef po_offload_NUM_JOBS
+#define po_offload_NUM_JOBS    64
+#endif
+#ifndef po_offload_MAX_WORKERS
+#define po_offload_MAX_WORKERS 16
+#endif
+
+/*-GLOBAL-
+ * Work run by a worker, and completion run with its result
+ */
+typedef intptr_t (*po_offload_Work)(void *arg);
+typedef void (*po_offload_Done)(void *arg, intptr_t result);
+
+/*-GLOBAL-
+ * A job
+ */
+typedef struct _po_offload_Job {
+  po_inbox_Post post;           /* completion */
+  struct _po_offload_Job *next; /* in the free list or the work queue */
+  po_offload_Work work;
+  po_offload_Done done;
+  void *arg;
+  intptr_t result;
+  unsigned long submitTime;     /* po_target_timestamp() */
+  unsigned long startTime;
+} po_offload_Job;
+
+/*-GLOBAL-
+ * Statistics, times in po_target_timestamp() units
+ */
+typedef struct {
+  unsigned long nJobs;          /* jobs completed */
+  unsigned long nRejected;      /* submits with no job left */
+  int depth;                    /* jobs waiting for a worker */
+  int maxDepth;
+  unsigned long waitTotal;      /* submit to start on a worker */
+  unsigned long waitMax;
+  unsigned long latencyTotal;   /* submit to start of the completion */
+  unsigned long latencyMax;
+} po_offload_Stats;
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Starts nWorkers worker threads (at most po_offload_MAX_WORKERS) that
+ * post the completions to inbox. Returns 0, or -1 if a thread could not be
+ * created.
+ */
+int po_offload_init(int nWorkers, po_inbox_Inbox *inbox)
+;
+
+/*-GLOBAL-
+ * Stops the workers once the submitted work has run. Completions still
+ * waiting in the inbox are run when it is drained.
+ */
+void po_offload_stop(void)
+;
+
+/*-GLOBAL-
+ * Runs work(arg) on a worker, then done(arg, result) at a priority level
+ * in the Portos thread. Called from the Portos thread. Returns 0, or -1 if
+ * there is no job left.
+ */
+int po_offload(po_offload_Work work, void *arg, po_offload_Done done,
+	       int priority)
+;
+
+/*-GLOBAL-
+ * Copies the statistics, from the Portos thread.
+ */
+void po_offload_stats(po_offload_Stats *stats)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+#endif // po_target_HOSTED
+
+#endif // po_offload__H
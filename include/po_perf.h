@@ -0,0 +1,134 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Event counters of priority functions on hosted Linux. The counters of
+ * the Portos thread (perf_event_open) are read whenever a priority
+ * function is entered or exited, by its scheduler entry or by an
+ * immediate call, and the counts in between go to the function running
+ * on top: the counts of a function exclude those of the functions it
+ * preempts or calls immediately. They add up per function name and
+ * priority level, and per level:
+ *
+ *      po_perf_start();
+ *      ...
+ *      po_perf_stop();
+ *      po_perf_write(stdout);
+ *
+ *      function          calls  time us     cycles  instructions   ipc  cache/ki ...
+ *      filter@3           1000     5230   15240117      21336163  1.40     12.31
+ *      ...
+ *      level 3            1000     5230   15240117      21336163  1.40     12.31
+ *
+ * where the misses are given per thousand instructions: high ones point at
+ * cache-unfriendly handlers. The task clock is always counted. The
+ * hardware counters are counted when the host has them (not in most
+ * virtual machines), cf. po_perf_Stats.available. Each function entry and
+ * exit costs a system call while the counters run.
+ */
+
+#ifndef po_perf__H
+#define po_perf__H
+
+#include <stdio.h>
+#include <po_sys.h>
+#include <po_function.h>
+
+#if po_perf_ENABLE
+
+#if !po_target_HOSTED || !defined(__linux__)
+#error "po_perf_ENABLE requires a hosted Linux target"
+#endif
+
+/* Distinct functions (name and level) counted. It can be set on the
+ * command line.
+ */
+#ifndef po_perf_MAX_FUNCS
+#define po_perf_MAX_FUNCS 256
+#endif
+
+/*-GLOBAL-
+ * Counters
+ */
+enum {
+  po_perf_TIME,                 /* task clock, in nanoseconds */
+  po_perf_CYCLES,
+  po_perf_INSTRUCTIONS,
+  po_perf_CACHE_MISSES,
+  po_perf_BRANCH_MISSES,
+  po_perf_NUM_COUNTERS
+};
+
+/*-GLOBAL-
+ * Counts of a function or a level
+ */
+typedef struct {
+  unsigned long calls;
+  unsigned long long count[po_perf_NUM_COUNTERS];
+} po_perf_Counts;
+
+/*-GLOBAL-
+ * State of the counters
+ */
+typedef struct {
+  unsigned available;       /* bit per counter counted, 0 if stopped */
+  unsigned long nReads;     /* readings of the counters */
+  unsigned long nDropped;   /* counts not given to their function: table
+			       full */
+  int nFuncs;               /* distinct functions */
+} po_perf_Stats;
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Starts counting in the calling thread, which runs the priority
+ * functions, from zero counts. Returns 0, or -1 if not even the task
+ * clock could be opened.
+ */
+int po_perf_start(void)
+;
+
+/*-GLOBAL-
+ * Stops counting. The counts are kept.
+ */
+void po_perf_stop(void)
+;
+
+/*-GLOBAL-
+ * Clears all counts.
+ */
+void po_perf_reset(void)
+;
+
+/*-GLOBAL-
+ * Copies the state of the counters.
+ */
+void po_perf_getstats(po_perf_Stats *stats)
+;
+
+/*-GLOBAL-
+ * Adds up the counts of a function at all levels. Returns the number of
+ * levels it ran at.
+ */
+int po_perf_getfunc(const char *name, po_perf_Counts *counts)
+;
+
+/*-GLOBAL-
+ * Adds up the counts of the functions of a priority level.
+ */
+void po_perf_getlevel(int priority, po_perf_Counts *counts)
+;
+
+/*-GLOBAL-
+ * Writes the counts per function, the busiest first, then per level.
+ * Counts outside priority functions are given under "[none]", and those
+ * dropped under "[other]".
+ */
+void po_perf_write(FILE *file)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+#endif // po_perf_ENABLE
+
+#endif // po_perf__H
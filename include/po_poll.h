@@ -0,0 +1,191 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * File descriptor readiness on Linux hosted targets. This module is a
+ * layer on top of the signal module, like po_time: a pfunc is scheduled
+ * on a file descriptor becoming readable or writable, and runs at its own
+ * priority level once it is.
+ *
+ *      static void onread(po_priority(4), int fd)
+ *      {
+ *        read(fd, ...);
+ *        onread(po_poll_read_p(fd, &Poller), fd);     // next read
+ *      }
+ *
+ * A poller owns an epoll file descriptor and a signal group defined by
+ * the user (cf. po_init.c), whose hash size must be a power of 2.
+ * po_poll_wait, in the event loop of the Portos thread, makes one
+ * epoll_wait and schedules every ready call of the batch before any of
+ * them runs. A file descriptor stays registered with epoll while calls
+ * wait on it, and as long as they are scheduled again from the calls that
+ * ran: a call rescheduling itself costs no system call. An inbox (cf.
+ * po_inbox.h) can be given to the poller, which then drains it when its
+ * file descriptor is ready.
+ *
+ * Each scheduling is for one readiness, like a timer. Calls waiting on a
+ * file descriptor must be cancelled, and the descriptor removed from the
+ * poller, before it is closed.
+ */
+
+#ifndef po_poll__H
+#define po_poll__H
+
+#include <po_sys.h>
+#include <po_memory.h>
+#include <po_function.h>
+#include <po_signal.h>
+#include <po_inbox.h>
+
+#if po_target_HOSTED && defined(__linux__)
+
+/* Size of the tables of file descriptors (highest descriptor + 1) and
+ * number of events read by epoll_wait at once. They can be set on the
+ * command line.
+ */
+#ifndef po_poll_MAX_FDS
+#define po_poll_MAX_FDS     1024
+#endif
+#ifndef po_poll_MAX_EVENTS
+#define po_poll_MAX_EVENTS  64
+#endif
+
+/* Readiness, also the lowest bit of the group signal (fd * 2 + event)
+ */
+#define po_poll_READ  0
+#define po_poll_WRITE 1
+
+/*-GLOBAL-
+ * A poller
+ */
+typedef struct {
+  int epfd;                     /* epoll file descriptor */
+  po_signal_Group *group;       /* signals of the file descriptors */
+  po_inbox_Inbox *inbox;        /* drained when ready, or NULL */
+  unsigned long nWakeups;       /* epoll_wait calls that found events */
+  unsigned long nEvents;        /* events found */
+  int maxBatch;                 /* most events found at once */
+  unsigned char armed[po_poll_MAX_FDS];   /* readiness registered with epoll */
+  unsigned char waiting[po_poll_MAX_FDS]; /* readiness with waiting calls */
+} po_poll_Poller;
+
+/* Poller handle. It can be user supplied to check on the status of the
+ * call or to cancel it.
+ */
+typedef po_signal_Handle po_poll_Handle;
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Init a poller whose calls are signals of group (initialized), and that
+ * drains inbox if not NULL. Returns 0, or -1 if epoll could not be set up.
+ */
+int po_poll_init(po_poll_Poller *poller, po_signal_Group *group,
+		 po_inbox_Inbox *inbox)
+;
+
+/*-GLOBAL-
+ * Closes the epoll file descriptor of a poller.
+ */
+void po_poll_close(po_poll_Poller *poller)
+;
+
+/*-GLOBAL-
+ * Sets the argument used to schedule a call on an event (po_poll_READ or
+ * po_poll_WRITE) of a file descriptor, with a user handle or NULL.
+ */
+po_function_ServiceHandle *po_poll_setsrv(int fd, int event,
+					  po_poll_Poller *poller,
+					  po_poll_Handle *handle)
+;
+
+/*-GLOBAL-
+ * Removes a file descriptor from the poller, once the calls waiting on it
+ * are cancelled.
+ */
+void po_poll_remove(int fd, po_poll_Poller *poller)
+;
+
+/*-GLOBAL-
+ * Waits up to timeout milliseconds (-1 for ever) for file descriptors to
+ * be ready, then runs the calls waiting on them. Called from the Portos
+ * thread outside priority functions. Returns the number of events.
+ */
+int po_poll_wait(po_poll_Poller *poller, int timeout)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+/*-GLOBAL-
+ * Poll directives
+ */
+static inline po_function_ServiceHandle* po_poll_read_p(
+    int fd, po_poll_Poller *poller
+)
+{
+  return po_poll_setsrv(fd, po_poll_READ, poller, NULL);
+}
+
+/*-GLOBAL-
+ * Poll directives
+ */
+static inline po_function_ServiceHandle* po_poll_read_ph(
+    int fd, po_poll_Poller *poller, po_poll_Handle *handle
+)
+{
+  return po_poll_setsrv(fd, po_poll_READ, poller, handle);
+}
+
+/*-GLOBAL-
+ * Poll directives
+ */
+static inline po_function_ServiceHandle* po_poll_write_p(
+    int fd, po_poll_Poller *poller
+)
+{
+  return po_poll_setsrv(fd, po_poll_WRITE, poller, NULL);
+}
+
+/*-GLOBAL-
+ * Poll directives
+ */
+static inline po_function_ServiceHandle* po_poll_write_ph(
+    int fd, po_poll_Poller *poller, po_poll_Handle *handle
+)
+{
+  return po_poll_setsrv(fd, po_poll_WRITE, poller, handle);
+}
+
+/*-GLOBAL-
+ * Cancel a call waiting on a file descriptor. The handle must be known.
+ */
+static inline void po_poll_cancel(po_poll_Handle *handle)
+{
+  po_signal_detach(handle);
+}
+
+/*-GLOBAL-
+ * Return non-zero if the call is still waiting.
+ */
+static inline int po_poll_isactive(po_poll_Handle *handle)
+{
+  return po_signal_isactive(handle);
+}
+
+/*-GLOBAL-
+ * Init a user handle (sometimes useful at start up if the handle
+ * can be tested before it has been attached).
+ */
+static inline void po_poll_inithandle(po_poll_Handle *handle)
+{
+  po_signal_init(handle);
+}
+
+/*-GLOBAL-
+ * Static initialization for user handles
+ */
+#define po_poll_INIT  po_signal_INIT
+
+#endif // po_target_HOSTED && __linux__
+
+#endif // po_poll__H
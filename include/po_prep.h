@@ -30,7 +30,16 @@ typedef struct {
 %D__po__schedulerentry(po_function_Handle *pfhandle)
 {
   %B%F__po__Handle *handle = (%F__po__Handle*)pfhandle;%b
+  #if po_function_OWNERS
+  po_function_Owner *po__owner = po_function_ownerenter(pfhandle);
+  #endif
   %F__po__priorityfunction((po_function_ServiceHandle*)0%B, handle->args.%a%b);
+  #if po_function_OWNERS
+  po_function_setowner(po__owner);
+  #endif
+  #if po_function_CHAIN
+  if ( !po_function_ischained(pfhandle) )
+  #endif
   po_free(pfhandle);
 }
 
@@ -42,7 +51,7 @@ typedef struct {
   %F__po__Handle *po__pfhandle;
   #if po_function_TRACK_NAME // DEBUG_MODE
   void *po__funcname = (void*)"%F";
-  #elif po_DEBUG
+  #elif po_function_TRACK_RUN
   void *po__funcname = (void*)%F;
   #endif
 
@@ -56,8 +65,17 @@ typedef struct {
   }
 
   /* Not an immediate call, pack arguments inside handle */
-  po__pfhandle = po_smalloc_constP(sizeof(*po__pfhandle));
-  if ( !po__pfhandle ) po_memory_error();
+  #if po_function_CHAIN
+  /* Reuse the block of the running call if this one gets chained to it */
+  po__pfhandle = (%F__po__Handle*)po_function_chaintail(po__priority);
+  if ( po__srvhandle || !po__pfhandle ||
+       !po_memory_isindex(po__pfhandle, po_memory_size2index(sizeof(*po__pfhandle)),
+			  po_memory_priregion(po__priority, &po_memory_RegionSystem)) )
+  #endif
+  {
+    po__pfhandle = po_smalloc_priP(sizeof(*po__pfhandle), po__priority);
+    if ( !po__pfhandle ) po_memory_error();
+  }
   //po__pfhandle = &%F__po__handle;
 
 %B%n  po__pfhandle->args.%a = %a;%b
@@ -66,6 +84,20 @@ typedef struct {
   po__pfhandle->pfhandle.name = po__funcname;
   #endif // DEBUG_MODE
 
+  #if po_function_FAIR_SOURCES
+  po__pfhandle->pfhandle.source = po_function_getsource();
+  #endif
+
+  #if po_function_OWNERS
+  #ifndef po_function_UNOWNED
+  po_function_tag(&po__pfhandle->pfhandle);
+  #else
+  po__pfhandle->pfhandle.owner = NULL;
+  po__pfhandle->pfhandle.srvhandle = NULL;
+  po__pfhandle->pfhandle.ownernode.next = NULL;
+  #endif
+  #endif
+
   po_function_service((po_function_Handle*)po__pfhandle, po__srvhandle, %F__po__schedulerentry, po__priority);
 }
 
@@ -0,0 +1,96 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Sampling profiler of priority functions. Each sample walks the chain of
+ * running priority functions (po_function_Env.trackrun) and counts the
+ * stack of their names and priority levels in a fixed table: there is no
+ * allocation and no tracing. On hosted targets the samples are taken by a
+ * profiling timer signal. On other targets, po_profile_sample() is called
+ * from a periodic timer interrupt. The counts are written in the collapsed
+ * format of flame graphs, one line per stack, root first:
+ *
+ *      outerfunc@2;innerfunc@5 132
+ */
+
+#ifndef po_profile__H
+#define po_profile__H
+
+#include <stdio.h>
+#include <po_sys.h>
+#include <po_function.h>
+
+#if po_profile_ENABLE
+
+#if !po_function_TRACK_NAME
+#error "po_profile_ENABLE requires po_function_TRACK_NAME"
+#endif
+
+/* Deepest stack recorded (innermost frames are kept) and number of
+ * distinct stacks counted. They can be set on the command line.
+ */
+#ifndef po_profile_MAX_DEPTH
+#define po_profile_MAX_DEPTH  16
+#endif
+#ifndef po_profile_MAX_STACKS
+#define po_profile_MAX_STACKS 512
+#endif
+
+/*-GLOBAL-
+ * Counters of the profiler
+ */
+typedef struct {
+  unsigned long nSamples;   /* samples taken */
+  unsigned long nDropped;   /* samples lost: stack table full */
+  int nStacks;              /* distinct stacks */
+} po_profile_Stats;
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Takes one sample: counts the stack of running priority functions. To be
+ * called from a periodic timer interrupt, unless po_profile_start is used.
+ */
+void po_profile_sample(void)
+;
+
+/*-GLOBAL-
+ * Clears all counts.
+ */
+void po_profile_reset(void)
+;
+
+/*-GLOBAL-
+ * Copies the counters of the profiler.
+ */
+void po_profile_getstats(po_profile_Stats *stats)
+;
+
+/*-GLOBAL-
+ * Writes the counted stacks in collapsed format. Samples taken outside
+ * priority functions are counted under "[none]".
+ */
+void po_profile_write(FILE *file)
+;
+
+#if po_target_HOSTED
+/*-GLOBAL-
+ * Starts sampling at the given rate of CPU time (SIGPROF), 1 to 1000000
+ * Hz. Returns 0, or -1 if the rate is out of range or the timer or signal
+ * handler could not be set.
+ */
+int po_profile_start(int hz)
+;
+
+/*-GLOBAL-
+ * Stops sampling.
+ */
+void po_profile_stop(void)
+;
+#endif
+
+/*-GLOBAL-INSERT-END-*/
+
+#endif // po_profile_ENABLE
+
+#endif // po_profile__H
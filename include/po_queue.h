@@ -48,7 +48,7 @@ typedef struct _po_queue_HandleInt {
  * Initialization macro for statically allocated queues.
  */
 #define po_queue_INIT(queuePtr, nServers, memRegion)			\
-  { {(po_function_ServiceFunc)po_queue_push},				\
+  { po_function_SERVICE(po_queue_push, po_queue_cancel),		\
       (nServers), (nServers), (memRegion), po_list_INIT(&(queuePtr)->list) }
 
 /*-GLOBAL-INSERT-*/
@@ -72,6 +72,15 @@ void po_queue_next(po_queue_Queue *queue)
 po_queue_HandleInt *po_queue_setsrv(po_queue_Queue *queue)
 ;
 
+#if po_function_OWNERS
+/*-GLOBAL-
+ * Cancel method of queues (cf. po_function_cancel): removes a call waiting
+ * for a server.
+ */
+void po_queue_cancel(po_queue_HandleInt *quehandle)
+;
+#endif
+
 /*-GLOBAL-INSERT-END-*/
 
 /*-GLOBAL-
@@ -81,6 +90,9 @@ static inline void po_queue_init(po_queue_Queue *queue, int nServers,
 				 po_memory_Region *memRegion)
 {
   queue->service.func = (po_function_ServiceFunc)po_queue_push;
+  #if po_function_OWNERS
+  queue->service.cancel = (po_function_ServiceFunc)po_queue_cancel;
+  #endif
   queue->nServers = nServers;
   queue->count = nServers;
   queue->memRegion = memRegion;
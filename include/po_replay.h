@@ -0,0 +1,72 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Record and replay of emulated interrupts in test versions (po_TEST).
+ * The emulation points of the scheduler and signals (po_emulateirupt) are
+ * numbered in the order they are passed. While recording, the user's
+ * po_emulateirupt_ decides whether an interrupt occurs at the current
+ * point, and runs it with po_replay_fire: the point and the work value
+ * given to the interrupt handler are logged. While replaying, the user's
+ * decisions are ignored and the handler is called with the same work
+ * values at the same points, which reproduces the same interleaving as
+ * long as the rest of the program is deterministic.
+ *
+ * The log is a text file, one line per interrupt: point number, source
+ * line of the emulation point and work value. A last line gives the
+ * number of points passed.
+ */
+
+#ifndef po_replay__H
+#define po_replay__H
+
+#include <stdio.h>
+#include <po_sys.h>
+
+#if po_TEST
+
+/*-GLOBAL-
+ * Interrupt handler: work tells it what to do (eg, which device)
+ */
+typedef void (*po_replay_Handler)(int work);
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Emulation point: called by po_emulateirupt() with the source line.
+ */
+void po_replay_point(int line)
+;
+
+/*-GLOBAL-
+ * Runs an emulated interrupt at the current point, and logs it while
+ * recording. Called from po_emulateirupt_, ignored while replaying.
+ */
+void po_replay_fire(int work)
+;
+
+/*-GLOBAL-
+ * Starts recording in file the interrupts run by handler.
+ */
+void po_replay_record(FILE *file, po_replay_Handler handler)
+;
+
+/*-GLOBAL-
+ * Starts replaying a run recorded in file.
+ */
+void po_replay_play(FILE *file, po_replay_Handler handler)
+;
+
+/*-GLOBAL-
+ * Stops recording or replaying. Returns 0, or while replaying the number
+ * of mismatches with the recorded run: interrupts at points of a different
+ * source line, interrupts not replayed, different number of points.
+ */
+int po_replay_stop(void)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+#endif // po_TEST
+
+#endif // po_replay__H
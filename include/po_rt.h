@@ -0,0 +1,92 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Real time set up of the Portos thread on Linux hosted targets, for low
+ * jitter: po_rt_start pins the calling thread to a CPU (by default an
+ * isolated one, cf. the isolcpus kernel parameter), switches it to
+ * SCHED_FIFO, locks the process memory and pre-faults the heap of the
+ * default memory region. Each step is done where permitted (root or
+ * CAP_SYS_NICE and CAP_IPC_LOCK, or matching resource limits): the result
+ * tells which succeeded. It is called by po_init when po_rt_ENABLE is set
+ * (cf. po_cfg.h); other regions are pre-faulted with po_rt_prefault.
+ *
+ * po_rt_jitter measures how late the thread wakes up from periodic
+ * timers, to check the set up.
+ */
+
+#ifndef po_rt__H
+#define po_rt__H
+
+#include <po_sys.h>
+#include <po_memory.h>
+
+#if po_target_HOSTED && defined(__linux__)
+
+/* Steps of po_rt_start
+ */
+#define po_rt_PIN      1        /* pin to a CPU */
+#define po_rt_FIFO     2        /* SCHED_FIFO */
+#define po_rt_LOCK     4        /* mlockall, current and future pages */
+#define po_rt_PREFAULT 8        /* touch the default region's heap */
+#define po_rt_ALL      15
+
+/* Buckets of the lateness histogram, bucket i counting wake ups late by
+ * less than 2^(i+1) microseconds (and at least 2^i but for bucket 0).
+ */
+#define po_rt_BUCKETS  16
+
+/*-GLOBAL-
+ * Lateness of wake ups, in nanoseconds
+ */
+typedef struct {
+  int samples;
+  unsigned long min;
+  unsigned long max;
+  unsigned long total;
+  unsigned long histogram[po_rt_BUCKETS];
+} po_rt_Jitter;
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Writes every page of the part of a region's heap not yet handed out, so
+ * that allocating from it causes no page fault.
+ */
+void po_rt_prefault(po_memory_Region *region)
+;
+
+/*-GLOBAL-
+ * Sets up the calling thread for real time: the steps given (po_rt_PIN,
+ * po_rt_FIFO, po_rt_LOCK, po_rt_PREFAULT) on a CPU (-1 for the first
+ * isolated one, else the last one allowed) at a SCHED_FIFO priority.
+ * Returns the steps that succeeded.
+ */
+int po_rt_start(int cpu, int priority, int steps)
+;
+
+/*-GLOBAL-
+ * Measures the lateness of samples wake ups from a timer of period
+ * microseconds, in the calling thread.
+ */
+void po_rt_jitter(po_rt_Jitter *jitter, int samples, int period)
+;
+
+/*-GLOBAL-
+ * Returns a bound, in microseconds, of the lateness of a share of the
+ * wake ups, in thousandths (eg, 999).
+ */
+unsigned long po_rt_quantile(po_rt_Jitter *jitter, int perMille)
+;
+
+/*-GLOBAL-
+ * Logs the lateness distribution.
+ */
+void po_rt_report(po_rt_Jitter *jitter)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+#endif // po_target_HOSTED && __linux__
+
+#endif // po_rt__H
@@ -0,0 +1,210 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Channel between processes on Linux hosted targets, each process running
+ * its own Portos. A channel is a shared memory mapping (a memfd) holding
+ * a ring of fixed size messages and a memory region. Any thread of any
+ * process attached to it posts messages; the one Portos thread receiving
+ * them calls, at the priority level chosen by the poster, the function
+ * it has bound to the message's number:
+ *
+ *      static void received(void *payload, intptr_t word)
+ *      {
+ *        ...                                      // level 3 in B
+ *        po_shm_free(&Channel, payload);
+ *      }
+ *
+ *      po_shm_bind(&Channel, 7, received);        // B
+ *
+ *      record = po_shm_malloc(&Channel, size);    // A
+ *      po_shm_post(&Channel, 7, 3, record, size);
+ *
+ * Posting takes no lock and makes no system call unless the receiver is
+ * idle in po_shm_wait, in which case it is woken through an eventfd.
+ * Payloads allocated in the channel's region are handed over without
+ * copying: the region is mapped at the same address in every process so
+ * that its pointers hold, and its allocations are serialized by a lock
+ * shared by the processes.
+ *
+ * A process forked after po_shm_create uses the channel as is. Another
+ * process is given both file descriptors (eg, over a Unix socket) and
+ * calls po_shm_attach.
+ */
+
+#ifndef po_shm__H
+#define po_shm__H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <po_sys.h>
+#include <po_memory.h>
+#include <po_function.h>
+
+#if po_target_HOSTED && defined(__linux__)
+
+/* Messages in the ring (a power of 2), message numbers, and largest block
+ * of the region. They can be set on the command line.
+ */
+#ifndef po_shm_NUM_SLOTS
+#define po_shm_NUM_SLOTS  256
+#endif
+#ifndef po_shm_NUM_FUNCS
+#define po_shm_NUM_FUNCS  32
+#endif
+#ifndef po_shm_MAX_BLOCK
+#define po_shm_MAX_BLOCK  4096
+#endif
+
+/*-GLOBAL-
+ * Function bound to a message number
+ */
+typedef void (*po_shm_Func)(void *payload, intptr_t word);
+
+/*-GLOBAL-
+ * A message. seq tells whether the slot is free or filled.
+ */
+typedef struct {
+  volatile unsigned long seq;
+  int number;
+  int priority;
+  void *payload;
+  intptr_t word;
+} po_shm_Slot;
+
+/*-GLOBAL-
+ * Start of the mapping, shared by the processes. The counters written by
+ * the posters and by the receiver are on separate cache lines.
+ */
+typedef struct {
+  unsigned long magic;
+  void *base;                   /* address of the mapping */
+  size_t size;                  /* size of the mapping */
+
+  volatile unsigned long tail __attribute__((aligned(64))); /* next post */
+  volatile unsigned long nFull; /* posts refused, ring full */
+  volatile int lock;            /* region lock */
+
+  volatile unsigned long head __attribute__((aligned(64))); /* next to run */
+  volatile int waiting;         /* receiver idle in po_shm_wait */
+
+  po_shm_Slot slot[po_shm_NUM_SLOTS] __attribute__((aligned(64)));
+
+  po_memory_RegionLocal(region, po_shm_MAX_BLOCK);
+} po_shm_Shared;
+
+/*-GLOBAL-
+ * A channel, as seen by one process
+ */
+typedef struct {
+  po_shm_Shared *shared;
+  int fd;                       /* memfd */
+  int efd;                      /* eventfd waking the receiver */
+  po_shm_Func func[po_shm_NUM_FUNCS];
+  unsigned long nMessages;      /* messages received */
+  unsigned long nBatches;       /* drains that found messages */
+  unsigned long nWakeups;       /* wake ups by a poster */
+  int maxBatch;                 /* largest batch */
+} po_shm_Channel;
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Creates a channel whose region has a heap of heapSize bytes. Returns 0,
+ * or -1 if the mapping or the eventfd could not be created.
+ */
+int po_shm_create(po_shm_Channel *channel, size_t heapSize)
+;
+
+/*-GLOBAL-
+ * Attaches to a channel created by another process, given its memfd and
+ * eventfd. Returns 0, or -1 if it cannot be mapped at the creator's
+ * address.
+ */
+int po_shm_attach(po_shm_Channel *channel, int fd, int efd)
+;
+
+/*-GLOBAL-
+ * Unmaps a channel and closes its file descriptors.
+ */
+void po_shm_close(po_shm_Channel *channel)
+;
+
+/*-GLOBAL-
+ * Binds a function to a message number, in the receiving process, or
+ * unbinds it if func is NULL.
+ */
+void po_shm_bind(po_shm_Channel *channel, int number, po_shm_Func func)
+;
+
+/*-GLOBAL-
+ * Posts a message calling the function bound to number with payload and
+ * word at a priority level of the receiver, from any thread of any
+ * process. Returns 0, or -1 if the ring is full.
+ */
+int po_shm_post(po_shm_Channel *channel, int number, int priority,
+		void *payload, intptr_t word)
+;
+
+/*-GLOBAL-
+ * Schedules the waiting messages and runs those above the current level,
+ * from the receiving Portos thread. Returns the number of messages. At
+ * most one ring of messages is taken, so that posters refilling the ring
+ * meanwhile cannot make the batch, and the handles it allocates, grow
+ * without bound.
+ */
+int po_shm_drain(po_shm_Channel *channel)
+;
+
+/*-GLOBAL-
+ * Tells the posters that the receiver is about to wait on po_shm_fd.
+ * Returns 0, or -1 if messages are already waiting (then drain them
+ * rather than wait).
+ */
+int po_shm_arm(po_shm_Channel *channel)
+;
+
+/*-GLOBAL-
+ * Waits up to timeout milliseconds (-1 for ever) for messages, then
+ * drains them. Called from the receiving Portos thread outside priority
+ * functions. Returns the number of messages.
+ */
+int po_shm_wait(po_shm_Channel *channel, int timeout)
+;
+
+/*-GLOBAL-
+ * Allocates a payload of size bytes in the channel's region, from any
+ * process. Returns NULL if the heap is full, unless that aborts (cf.
+ * po_memory_HEAP_FULL_ABORT).
+ */
+void *po_shm_malloc(po_shm_Channel *channel, int size)
+;
+
+/*-GLOBAL-
+ * Frees a payload of the channel's region, from any process.
+ */
+void po_shm_free(po_shm_Channel *channel, void *payload)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+/*-GLOBAL-
+ * Eventfd of a channel, readable when the receiver is woken (eg, to wait
+ * for it with other file descriptors after po_shm_arm).
+ */
+static inline int po_shm_fd(po_shm_Channel *channel)
+{
+  return channel->efd;
+}
+
+/*-GLOBAL-
+ * Region of a channel
+ */
+static inline po_memory_Region *po_shm_region(po_shm_Channel *channel)
+{
+  return &channel->shared->region.region;
+}
+
+#endif // po_target_HOSTED && __linux__
+
+#endif // po_shm__H
@@ -70,7 +70,7 @@ typedef struct _po_signal_Group {
  */
 #define po_signal_GROUPINIT(groupPriority, hashSize, memRegion) \
   {{								\
-    {(po_function_ServiceFunc)po_signal_attach},		\
+    po_function_SERVICE(po_signal_attach, po_signal_cancel),	\
     (groupPriority),						\
     (po_memory_Region*)(memRegion),				\
     (hashSize), 						\
@@ -97,9 +97,15 @@ typedef struct _po_signal_Group {
   po_target_ALIAS_SYMBOL(po_signal_Group, group, group ## _po_storage)
 #endif
 
-/* Default signal group when it's not specified
+/* Default signal group when it's not specified. With multiple instances,
+ * it is the group selected by the current thread.
  */
-#ifndef po_INIT_FILE
+#if po_MULTI_INSTANCE
+extern po_THREAD_LOCAL po_signal_Group *po_signal_GroupDefaultP;
+#  ifndef po_INIT_FILE
+#  define po_signal_GroupDefault (*po_signal_GroupDefaultP)
+#  endif
+#elif !defined(po_INIT_FILE)
 extern po_signal_Group po_signal_GroupDefault;
 #endif
 
@@ -150,6 +156,15 @@ void po_signal_post_(po_priority(group->groupPriority),
 void po_signal_detach(po_signal_Handle *usighandle)
 ;
 
+#if po_function_OWNERS
+/*-GLOBAL-
+ * Cancel method of signal groups (cf. po_function_cancel): detaches the
+ * call right away, the caller running at or above the group priority.
+ */
+void po_signal_cancel(po_signal_HandleInt *sighandle)
+;
+#endif
+
 /*-GLOBAL-
  * Sets the argument used to carry the signal info to a priority function.
  */
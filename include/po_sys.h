@@ -17,23 +17,37 @@
   #define po_INT_SIZE        16
 #elif INT_MAX == (1<<23)-1
   #define po_INT_SIZE        24
-#elif INT_MAX == (1<<31)-1
+#elif INT_MAX == 0x7FFFFFFF
   #define po_INT_SIZE        32
-//#elif INT_MAX == (1LL<<63)-1     TODO: DOES NOT COMPILE on some machines
-//  #define po_INT_SIZE        64
+#elif INT_MAX == 0x7FFFFFFFFFFFFFFF
+  #define po_INT_SIZE        64
 #else
   #error("Unknown integer size");
 #endif
 
-/* Emulate interrupts
+/* Emulate interrupts. In test versions, each emulation point goes through
+ * po_replay, which calls po_emulateirupt_ or replays a recorded run.
  */
 void po_emulateirupt_(void);
-static inline void po_emulateirupt(void)
-{
-  #if po_TEST
-  po_emulateirupt_();
-  #endif
-}
+#if po_TEST
+void po_replay_point(int line);
+#define po_emulateirupt() po_replay_point(__LINE__)
+#else
+#define po_emulateirupt()
+#endif
+
+/* Interrupt masking (cf. the target). With po_crit_STATS, the masked
+ * windows are timed under the call site that opened them (cf. po_crit).
+ */
+#if po_crit_STATS
+int po_crit_disable_(const char *file, int line);
+void po_crit_restore_(int oldState);
+#define po_interrupt_disable()         po_crit_disable_(__FILE__, __LINE__)
+#define po_interrupt_restore(oldState) po_crit_restore_(oldState)
+#else
+#define po_interrupt_disable()         po_target_disable()
+#define po_interrupt_restore(oldState) po_target_restore(oldState)
+#endif
 
 /*-GLOBAL-INSERT-*/
 /*-GLOBAL-INSERT-END-*/
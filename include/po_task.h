@@ -0,0 +1,156 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Blocking tasks below the priority function levels, on hosted targets.
+ * Each task is a thread with its own stack that may block (file I/O,
+ * legacy libraries). The priority functions keep running in a single
+ * thread, the scheduler thread. The task levels are below all priority
+ * levels: the task threads are normal time sharing threads (SCHED_OTHER,
+ * whatever the scheduler thread's policy) whose nice value is that of the
+ * scheduler thread plus po_task_NICE_OFFSET, plus one per level below the
+ * highest (at most 19). With the default offset, a task's CFS weight is at
+ * most 7% of the scheduler thread's, so a runnable task gets at most that
+ * share of a CPU the two contend for. When the scheduler thread is real
+ * time (cf. po_rt), the tasks never run while it is runnable.
+ *
+ * The two worlds exchange messages, a function and a word, run by the
+ * receiver:
+ *   - po_task_send, from the scheduler thread, puts a message in a task's
+ *     mailbox. It never blocks nor takes a lock: it fails if the mailbox
+ *     is full. The task gets it with po_task_receive.
+ *   - po_task_post, from a task, puts a message in the inbox of the
+ *     scheduler thread, which runs it in po_task_dispatch, outside
+ *     priority functions. Tasks serialize their posts with a lock that
+ *     the scheduler thread never takes.
+ * A message run by the scheduler thread usually calls priority functions.
+ */
+
+#ifndef po_task__H
+#define po_task__H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <po_sys.h>
+
+#if po_target_HOSTED
+
+#include <pthread.h>
+#include <semaphore.h>
+
+/* Sizes of a task's mailbox and of the scheduler's inbox (powers of 2),
+ * and number of task levels. They can be set on the command line.
+ */
+#ifndef po_task_MAILBOX_SIZE
+#define po_task_MAILBOX_SIZE 64
+#endif
+#ifndef po_task_INBOX_SIZE
+#define po_task_INBOX_SIZE   256
+#endif
+#ifndef po_task_NUM_LEVELS
+#define po_task_NUM_LEVELS   8
+#endif
+
+/* Nice value of the highest task level above the scheduler thread's. It
+ * can be set on the command line.
+ */
+#ifndef po_task_NICE_OFFSET
+#define po_task_NICE_OFFSET  12
+#endif
+
+/*-GLOBAL-
+ * Function of a message, run by the receiver
+ */
+typedef void (*po_task_Function)(intptr_t word);
+
+/*-GLOBAL-
+ * A message
+ */
+typedef struct {
+  po_task_Function func;
+  intptr_t word;
+} po_task_Message;
+
+/* Ring of messages with one reader and one writer
+ */
+typedef struct {
+  unsigned rd;
+  unsigned wr;
+  po_task_Message *slot;
+  unsigned mask;
+} po_task_Ring;
+
+/*-GLOBAL-
+ * A task
+ */
+typedef struct _po_task_Task {
+  pthread_t thread;
+  void (*func)(struct _po_task_Task *task, void *arg);
+  void *arg;
+  int level;
+  int nice;                 /* nice value of its thread */
+  volatile int stop;
+  sem_t sem;                /* counts messages in the mailbox */
+  po_task_Ring mailbox;
+  po_task_Message storage[po_task_MAILBOX_SIZE];
+} po_task_Task;
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Creates a task running func(task, arg) at a task level, 0 being the
+ * lowest, on a stack of stackSize bytes (0 for the default size). Returns
+ * 0, or -1 if the thread could not be created.
+ */
+int po_task_create(po_task_Task *task, void (*func)(po_task_Task *task, void *arg),
+		   void *arg, int level, size_t stackSize)
+;
+
+/*-GLOBAL-
+ * Asks a task to stop and waits for it: po_task_receive returns -1 once
+ * the mailbox is empty.
+ */
+void po_task_stop(po_task_Task *task)
+;
+
+/*-GLOBAL-
+ * Sends a message to a task, from the scheduler thread. Returns 0, or -1
+ * if the mailbox is full.
+ */
+int po_task_send(po_task_Task *task, po_task_Function func, intptr_t word)
+;
+
+/*-GLOBAL-
+ * Waits for the next message of the calling task. Returns 0, or -1 if the
+ * task is stopped.
+ */
+int po_task_receive(po_task_Task *task, po_task_Message *message)
+;
+
+/*-GLOBAL-
+ * Main function of a task that runs the messages it receives until it is
+ * stopped.
+ */
+void po_task_serve(po_task_Task *task, void *unused)
+;
+
+/*-GLOBAL-
+ * Posts a message to the scheduler thread, from a task. Returns 0, or -1
+ * if the inbox is full.
+ */
+int po_task_post(po_task_Function func, intptr_t word)
+;
+
+/*-GLOBAL-
+ * Runs the messages posted by tasks, from the scheduler thread while no
+ * priority function runs. If wait is non-zero and there are none, waits
+ * for one. Returns the number of messages run.
+ */
+int po_task_dispatch(int wait)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+#endif // po_target_HOSTED
+
+#endif // po_task__H
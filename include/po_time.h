@@ -59,9 +59,15 @@ typedef struct {
   po_target_ALIAS_SYMBOL(po_time_Clock, clock, clock ## _po_storage)
 #endif
 
-/* Default clock when it's not specified
- */
-#ifndef po_INIT_FILE
+/* Default clock when it's not specified. With multiple instances, it is
+ * the clock selected by the current thread.
+ */
+#if po_MULTI_INSTANCE
+extern po_THREAD_LOCAL po_time_Clock *po_time_ClockDefaultP;
+#  ifndef po_INIT_FILE
+#  define po_time_ClockDefault (*po_time_ClockDefaultP)
+#  endif
+#elif !defined(po_INIT_FILE)
 extern po_time_Clock po_time_ClockDefault;
 #endif
 
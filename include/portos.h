@@ -18,6 +18,68 @@
 #include <po_time.h>
 #include <po_queue.h>
 #include <po_log.h>
+#include <po_irq.h>
+#include <po_mutex.h>
+#include <po_profile.h>
+#include <po_perf.h>
+#include <po_crit.h>
+#include <po_replay.h>
+#include <po_checkpoint.h>
+#include <po_task.h>
+#include <po_fiber.h>
+#include <po_inbox.h>
+#include <po_offload.h>
+#include <po_poll.h>
+#include <po_io.h>
+#include <po_rt.h>
+#include <po_shm.h>
+#include <po_dma.h>
+
+#if po_MULTI_INSTANCE
+
+/* A Portos instance: its scheduler environment, its default objects and
+ * its interrupt sources. The objects are defined and initialized by the
+ * user, as in the init file. Several instances can run in one process,
+ * each in its own thread.
+ */
+typedef struct {
+  po_function_Environ *env;
+  po_memory_Region *regionDefault;
+  po_signal_Group *groupDefault;
+  po_time_Clock *clockDefault;
+  po_log_Handle *logDefault;
+  #if po_irq_NUM_SOURCES
+  po_irq_Source *irqTable;      /* po_irq_NUM_SOURCES entries, zeroed */
+  #endif
+} po_Instance;
+
+/*-GLOBAL-
+ * Select the instance used by the calling thread. It must be called by
+ * each thread before any other Portos call.
+ */
+static inline void po_instance_select(po_Instance *instance)
+{
+  po_function_EnvCurrent = instance->env;
+  po_memory_RegionDefaultP = instance->regionDefault;
+  po_signal_GroupDefaultP = instance->groupDefault;
+  po_time_ClockDefaultP = instance->clockDefault;
+  po_log_HandleDefaultP = instance->logDefault;
+  #if po_irq_NUM_SOURCES
+  po_irq_TableP = instance->irqTable;
+  #endif
+}
+
+/*-GLOBAL-
+ * Init the scheduler environment of an instance and select it for the
+ * calling thread. The default objects must be initialized separately.
+ */
+static inline void po_instance_init(po_Instance *instance)
+{
+  po_function_envinit(instance->env);
+  po_instance_select(instance);
+}
+
+#endif
 
 /* One time initialization of Portos.
  */
@@ -25,6 +87,9 @@ static inline void po_init_(void)
 {
   po_function_init();
   po_target_init();
+  #if po_rt_ENABLE
+  po_rt_start(po_rt_CPU, po_rt_PRIORITY, po_rt_ALL);
+  #endif
 }
 
 /*-GLOBAL-
@@ -9,12 +9,24 @@
 #define po_target_arm__H
 
 #include <stdio.h>
+#include <stdint.h>
 
 #include <po_cfg_arm.h>
 
 /* Empty */
 #define po_NEARFAR
 
+/* Bare metal target
+ */
+#define po_target_HOSTED 0
+
+/* Compiler barrier: memory accesses are not moved across it
+ */
+static inline void po_target_barrier(void)
+{
+  __asm__ __volatile__("" ::: "memory");
+}
+
 /* Tell Portos how to abort when an error occurs. In release
  * versions this may force the processor to reboot. In debug versions you
  * may want to catch the bug and analyze the last functions on the stack.
@@ -26,9 +38,10 @@ static inline void po_abort(void)
 
 /* Logging (cf. po_log)
  */
-static inline void po_target_log(int *buffer)
+static inline void po_target_log(intptr_t *buffer)
 {
-  printf((char*)buffer[1], buffer[2], buffer[3]);
+  // Log words and ints have the same size
+  printf((char*)buffer[1], (int)buffer[2], (int)buffer[3]);
 }
 
 /* Error handling
@@ -58,7 +71,7 @@ static inline void po_target_error(int error)
 
 /* Target specific
  */
-static inline int po_interrupt_disable(void)
+static inline int po_target_disable(void)
 {
   int oldState;
   asm volatile(
@@ -74,7 +87,7 @@ static inline int po_interrupt_disable(void)
 
 /* Target specific
  */
-static inline void po_interrupt_restore(int oldState)
+static inline void po_target_restore(int oldState)
 {
   asm volatile(
 	       "and    r1, %0, " po_arm_DISABLE_IRUPT "\n"
@@ -104,6 +117,14 @@ static inline void po_interrupt_restore(int oldState)
  */
 #define po_function_iscontext() (po_function_getpri() >= 0)
 
+/* Free running time stamp (cf. po_mutex_STATS). To be mapped to a timer
+ * of the board: hold times read 0 until then.
+ */
+static inline unsigned long po_target_timestamp(void)
+{
+  return 0;
+}
+
 /* Target init
  */
 static inline void po_target_init(void)
@@ -17,6 +17,7 @@
 #include <hwi.h>
 #include <log.h>
 #include <sem.h>
+#include <clk.h>
 #include <mem.h>
 #include <po_cfg_dspbios.h>
 
@@ -32,6 +33,15 @@
 #  define po_NEARFAR
 #endif
 
+/* Target under DSP/BIOS, not a hosted one
+ */
+#define po_target_HOSTED 0
+
+/* Compiler barrier (an opaque call)
+ */
+void po_target_barrier(void)
+;
+
 /* Tell Portos how to abort when an error occurs. In release
  * versions this may force the processor to reboot. In debug versions you
  * may want to catch the bug and analyze the last functions on the stack.
@@ -72,11 +82,11 @@ static inline int po_lib_msb_hw(unsigned x)
 
 /* Disable HWI
  */
-#define po_interrupt_disable   HWI_disableI
+#define po_target_disable      HWI_disableI
 
 /* Restore HWI
  */
-#define po_interrupt_restore   HWI_restoreI
+#define po_target_restore      HWI_restoreI
 
 #if 0
 /* A replacement, on some targets, for __attribute__((alias("...")))
@@ -96,6 +106,14 @@ void po_target_error(int error)
 void po_target_init(void)
 ;
 
+/* Free running time stamp, in high resolution clock units
+ * (cf. po_mutex_STATS)
+ */
+static inline unsigned long po_target_timestamp(void)
+{
+  return CLK_gethtime();
+}
+
 /* Set context
  */
 static inline void po_function_context(void)
@@ -0,0 +1,27 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * YOU CANNOT MODIFY THIS FILE UNLESS YOU HAVE THE FULL PORTOS SOURCE
+ * CODE IN ORDER TO RECOMPILE IT. OTHERWISE, MODIFYING THIS FILE WILL
+ * RESULT IN SYSTEM CRASH.
+ *
+ * Configuration file containing default values that can be modified by
+ * the programmer.
+ */
+
+#ifndef po_cfg_linux__H
+#define po_cfg_linux__H
+
+
+/* PRIORITY FUNCTIONS */
+
+/* Total number of priority levels, at most 64 (cf. po_lib_Bitmap) */
+#if defined(__LP64__) || defined(_WIN64)
+#define po_function_NUM_PRI_LEVELS 64
+#else
+#define po_function_NUM_PRI_LEVELS 32  // po_INT_SIZE
+#endif
+
+
+#endif // po_cfg_linux__H
@@ -0,0 +1,269 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Linux hosted target with real interrupts: POSIX signals bound with
+ * po_target_bind act as hardware interrupts of the thread that called
+ * po_init (the Portos thread). A periodic timer (po_target_timerstart) or
+ * another thread (po_target_raise) sends them. The handler of a signal
+ * runs inside po_interrupt_enter and po_interrupt_exit, so that the
+ * priority functions it calls above the interrupted level run before the
+ * signal handler returns, interrupts enabled: they preempt.
+ *
+ * po_interrupt_disable sets a flag rather than masking the signals with a
+ * system call. A signal arriving while it is set is left pending and its
+ * handler runs when po_interrupt_restore enables interrupts again. The
+ * handler of a signal never nests in itself, handlers of different
+ * signals do.
+ *
+ * Priority functions that preempt run inside a signal handler: they
+ * should not call C library functions that are not reentrant (stdio,
+ * malloc) while lower levels may be calling them too.
+ */
+
+#ifndef po_target_linux__H
+#define po_target_linux__H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <po_cfg_linux.h>
+
+/* Empty */
+#define po_NEARFAR
+
+/* Hosted target: POSIX signals, threads and files are available
+ */
+#define po_target_HOSTED 1
+
+/* Linux target, with signals as interrupts
+ */
+#define po_target_LINUX 1
+
+/* Signals that can be bound, 1 to po_target_NUM_SIGNALS - 1
+ */
+#define po_target_NUM_SIGNALS 64
+
+/* Compiler barrier: memory accesses are not moved across it
+ */
+static inline void po_target_barrier(void)
+{
+  __asm__ __volatile__("" ::: "memory");
+}
+
+/* Bounds of the executable image, code and static data, as placed in this
+ * process (cf. po_checkpoint). NULL if unknown.
+ */
+#if defined(__ELF__)
+extern char __executable_start[], _end[];
+#define po_target_IMAGE_START __executable_start
+#define po_target_IMAGE_END   _end
+#else
+#define po_target_IMAGE_START NULL
+#define po_target_IMAGE_END   NULL
+#endif
+
+/* Thread-local storage class, needed by po_MULTI_INSTANCE
+ */
+#define po_THREAD_LOCAL __thread
+
+/* Tell Portos how to abort when an error occurs. In release
+ * versions this may force the processor to reboot. In debug versions you
+ * may want to catch the bug and analyze the last functions on the stack.
+ */
+static inline void po_abort(void)
+{
+  *(volatile int*)0 = 0;
+}
+
+/* Error handling
+ */
+static inline void po_target_error(int error)
+{
+  //printf("Portos ERROR %d (%s:%d)\n", error, filename, line);
+  printf("Portos ERROR %d\n", error);
+  po_abort();
+}
+
+/* Hardware MSB detection: one count leading zeros instruction
+ */
+#define po_lib_MSB_HW 1
+static inline int po_lib_msb_hw(unsigned x)
+{
+  return x ? (int)(sizeof(x) * CHAR_BIT) - 1 - __builtin_clz(x) : -1;
+}
+
+/* Same for a 64 bit word (cf. po_lib_Bitmap)
+ */
+static inline int po_lib_msb64_hw(unsigned long long x)
+{
+  return x ? 63 - __builtin_clzll(x) : -1;
+}
+
+/* Interrupt state of a thread
+ */
+typedef struct {
+  volatile int disabled;              /* po_interrupt_disable */
+  volatile uint64_t pending;          /* signals left pending */
+  volatile uint64_t running;          /* signals whose handler runs */
+} po_target_IrqState;
+
+extern po_THREAD_LOCAL po_target_IrqState po_target_Irq;
+
+/* Runs the handlers of the pending signals
+ */
+void po_target_irqreplay(void)
+;
+
+/* Target specific
+ */
+static inline int po_target_disable(void)
+{
+  int oldState = po_target_Irq.disabled;
+  po_target_Irq.disabled = 1;
+  po_target_barrier();
+  return oldState;
+}
+
+/* Target specific
+ */
+static inline void po_target_restore(int oldState)
+{
+  po_target_barrier();
+  po_target_Irq.disabled = oldState;
+  if ( !oldState && po_target_Irq.pending ) po_target_irqreplay();
+}
+
+/* A replacement, on some targets, for __attribute__((alias("...")))
+ */
+#define po_target_ALIAS_SYMBOL(type, sym1, sym2)	\
+  extern type sym1 __attribute__((alias(#sym2)))
+
+//asm(".globl\t_" #sym1 "\n\t.set _" #sym1 ", _" #sym2)
+
+/* Set context
+ */
+#define po_function_context po_function_resume
+
+/* On some targets this function can be optimized.
+ */
+#define po_function_iscontext() (po_function_getpri() >= 0)
+
+/* Returns non-zero if the next conversion of a log format takes an int,
+ * and moves past it. Other conversions (strings, pointers, longs) take a
+ * whole log word.
+ */
+static inline int po_target_logint(const char **format)
+{
+  const char *f = *format;
+  int isint = 1;
+
+  // Find next conversion
+  for ( ; *f ; f++ ) {
+    if ( *f != '%' ) continue;
+    if ( f[1] != '%' ) break;
+    f++;
+  }
+
+  if ( *f ) {
+    // Skip flags, width and precision, then length and conversion
+    for ( f++ ; *f && strchr("#0- +.123456789", *f) ; f++ )
+      ;
+    for ( ; *f == 'l' || *f == 'z' || *f == 'j' || *f == 't' ; f++ )
+      isint = 0;
+    if ( *f == 's' || *f == 'p' ) isint = 0;
+    if ( *f ) f++;
+  }
+
+  *format = f;
+  return isint;
+}
+
+/* Logging (cf. po_log): the words are format and 2 values. The values are
+ * passed to printf as ints unless the format says otherwise.
+ */
+static inline void po_target_log(intptr_t *buffer)
+{
+  const char *format = (const char*)buffer[1];
+  const char *f = format;
+  int int0 = po_target_logint(&f);
+  int int1 = po_target_logint(&f);
+  if ( int0 && int1 )
+    printf(format, (int)buffer[2], (int)buffer[3]);
+  else if ( int0 )
+    printf(format, (int)buffer[2], buffer[3]);
+  else if ( int1 )
+    printf(format, buffer[2], (int)buffer[3]);
+  else
+    printf(format, buffer[2], buffer[3]);
+}
+
+/* Free running time stamp, in cycles of the time stamp counter where
+ * there is one, else in nanoseconds (cf. po_target_timestampfreq)
+ */
+static inline unsigned long po_target_timestamp(void)
+{
+  #if defined(__x86_64__) || defined(__i386__)
+  unsigned lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return (unsigned long)(((unsigned long long)hi << 32) | lo);
+  #elif defined(__aarch64__)
+  unsigned long t;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(t));
+  return t;
+  #else
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (unsigned long)t.tv_sec * 1000000000UL + t.tv_nsec;
+  #endif
+}
+
+/*-GLOBAL-INSERT-*/
+
+/*-GLOBAL-
+ * Target init, by the Portos thread
+ */
+void po_target_init(void)
+;
+
+/*-GLOBAL-
+ * Binds a signal to an interrupt handler of the Portos thread, or unbinds
+ * it if handler is NULL. Returns 0, or -1 if the signal cannot be bound.
+ */
+int po_target_bind(int signo, void (*handler)(int signo))
+;
+
+/*-GLOBAL-
+ * Sends a bound signal to the Portos thread, from any thread. Returns 0,
+ * or -1 on failure.
+ */
+int po_target_raise(int signo)
+;
+
+/*-GLOBAL-
+ * Starts a timer sending a bound signal to the Portos thread every period
+ * nanoseconds. Returns 0, or -1 on failure.
+ */
+int po_target_timerstart(int signo, long period)
+;
+
+/*-GLOBAL-
+ * Stops the timer of a signal.
+ */
+void po_target_timerstop(int signo)
+;
+
+/*-GLOBAL-
+ * Frequency of po_target_timestamp, in units per second. Measured at the
+ * first call, which takes about 10 ms.
+ */
+unsigned long po_target_timestampfreq(void)
+;
+
+/*-GLOBAL-INSERT-END-*/
+
+
+#endif // po_target_linux__H
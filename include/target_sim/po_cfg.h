@@ -32,7 +32,22 @@
 /* For debugging on hosts such as TI CCS using GEL commands, we currently
  * need to keep track of priority functions' names.
  */
-#define po_function_TRACK_NAME     po_DEBUG
+#define po_function_TRACK_NAME     (po_DEBUG || po_profile_ENABLE || po_perf_ENABLE)
+
+/* Keep track of running priority functions (po_function_Env.trackrun).
+ */
+#define po_function_TRACK_RUN      (po_DEBUG || po_profile_ENABLE || po_perf_ENABLE)
+
+/* Sampling profiler of the running priority functions (cf. po_profile).
+ * It tracks running functions and their names in release versions too.
+ */
+#define po_profile_ENABLE          0
+
+/* Event counters (cycles, cache misses...) of each priority function on
+ * hosted Linux (cf. po_perf). It tracks running functions and their names
+ * too.
+ */
+#define po_perf_ENABLE             0
 
 /* Track memory allocations for debugging: file name and line number.
  * The level of this value denotes more or less tracking:
@@ -68,6 +83,93 @@
 /* Abort program if heap is full (otherwise, return NULL pointer) */
 #define po_memory_HEAP_FULL_ABORT  1
 
+/* Place the handles of priority functions, signals and queues in a region
+ * chosen by priority level, eg, fast internal RAM for the highest levels
+ * (cf. po_memory_setpriregion).
+ */
+#define po_memory_PRIORITY_REGIONS 0
+
+
+/* PRIORITY FUNCTIONS */
+
+/* Scheduler backend, ie, the database of waiting calls:
+ * po_function_BACKEND_BITMAP keeps one bit and one list per level.
+ * po_function_BACKEND_MAXNODE adds a one call cache of the highest waiting
+ * call, which bypasses the bitmap when a priority function posts a single
+ * call below it. Can be selected on the command line, eg,
+ * -Dpo_function_BACKEND=po_function_BACKEND_MAXNODE.
+ */
+#define po_function_BACKEND_BITMAP  1
+#define po_function_BACKEND_MAXNODE 2
+#ifndef po_function_BACKEND
+#define po_function_BACKEND        po_function_BACKEND_BITMAP
+#endif
+
+/* Fairness among sources within a priority level. Number of sub-queues
+ * per fair level, one per source id, served by deficit round robin
+ * (cf. po_function_fairinit). 0 disables fair levels altogether.
+ */
+#define po_function_FAIR_SOURCES   0
+
+/* Chaining: a call posted by a priority function at its own level, when
+ * nothing else is waiting there, is run right after it by the scheduler
+ * without going through the bitmap, and reuses its memory block when the
+ * size matches.
+ */
+#define po_function_CHAIN          1
+
+/* Per level limit on the number of waiting calls, with an overflow policy
+ * (cf. po_function_setlimit), and per level counters of peak depth and
+ * of rejected, dropped and merged calls.
+ */
+#define po_function_LEVEL_LIMITS   0
+
+/* Owner tags: the calls made while an owner is set, directly or through
+ * signals, timers and queues, can all be cancelled at once
+ * (cf. po_function_cancel).
+ */
+#define po_function_OWNERS         0
+
+/* Number of interrupt sources that can be bound to a function run at a
+ * fixed priority level (cf. po_irq_bind), at most the number of bits in
+ * an int. 0 disables the dispatch table.
+ */
+#define po_irq_NUM_SOURCES         0
+
+/* Lock count and hold time statistics of mutexes (cf. po_mutex_getstats).
+ * Hold times are measured with po_target_timestamp().
+ */
+#define po_mutex_STATS             0
+
+/* Length statistics of the windows with interrupts masked, per call site
+ * of po_interrupt_disable (cf. po_crit). Lengths are measured with
+ * po_target_timestamp().
+ */
+#define po_crit_STATS              0
+
+
+/* MULTIPLE INSTANCES */
+
+/* Run several independent Portos instances in one process, one per thread
+ * (hosted targets only). The scheduler environment, the default memory
+ * region, signal group, clock and log handle, and the interrupt sources
+ * are then reached through thread-local pointers. Each thread selects its
+ * instance with po_instance_select().
+ */
+#define po_MULTI_INSTANCE          0
+
+
+/* REAL TIME */
+
+/* Real time set up of the thread calling po_init (Linux hosted targets
+ * only, cf. po_rt): pinned to po_rt_CPU (-1 for the first isolated CPU,
+ * else the last one allowed), SCHED_FIFO at po_rt_PRIORITY, memory locked
+ * and the default region's heap pre-faulted, where permitted.
+ */
+#define po_rt_ENABLE               0
+#define po_rt_CPU                  -1
+#define po_rt_PRIORITY             80
+
 
 /* MISCELLANEOUS */
 
@@ -16,8 +16,12 @@
 
 /* PRIORITY FUNCTIONS */
 
-/* Total number of priority levels */
+/* Total number of priority levels, at most 64 (cf. po_lib_Bitmap) */
+#if defined(__LP64__) || defined(_WIN64)
+#define po_function_NUM_PRI_LEVELS 64
+#else
 #define po_function_NUM_PRI_LEVELS 32  // po_INT_SIZE
+#endif
 
 
 #endif // po_cfg_sim__H
@@ -9,11 +9,42 @@
 #define po_target_sim__H
 
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
 #include <po_cfg_sim.h>
 
 /* Empty */
 #define po_NEARFAR
 
+/* Hosted target: POSIX signals, threads and files are available
+ */
+#define po_target_HOSTED 1
+
+/* Compiler barrier: memory accesses are not moved across it
+ */
+static inline void po_target_barrier(void)
+{
+  __asm__ __volatile__("" ::: "memory");
+}
+
+/* Bounds of the executable image, code and static data, as placed in this
+ * process (cf. po_checkpoint). NULL if unknown.
+ */
+#if defined(__ELF__)
+extern char __executable_start[], _end[];
+#define po_target_IMAGE_START __executable_start
+#define po_target_IMAGE_END   _end
+#else
+#define po_target_IMAGE_START NULL
+#define po_target_IMAGE_END   NULL
+#endif
+
+/* Thread-local storage class, needed by po_MULTI_INSTANCE
+ */
+#define po_THREAD_LOCAL __thread
+
 /* Tell Portos how to abort when an error occurs. In release
  * versions this may force the processor to reboot. In debug versions you
  * may want to catch the bug and analyze the last functions on the stack.
@@ -32,20 +63,31 @@ static inline void po_target_error(int error)
   po_abort();
 }
 
-/* Use software MSB detection
+/* Hardware MSB detection: one count leading zeros instruction
  */
-#define po_lib_MSB_HW 0
+#define po_lib_MSB_HW 1
+static inline int po_lib_msb_hw(unsigned x)
+{
+  return x ? (int)(sizeof(x) * CHAR_BIT) - 1 - __builtin_clz(x) : -1;
+}
+
+/* Same for a 64 bit word (cf. po_lib_Bitmap)
+ */
+static inline int po_lib_msb64_hw(unsigned long long x)
+{
+  return x ? 63 - __builtin_clzll(x) : -1;
+}
 
 /* Target specific
  */
-static inline int po_interrupt_disable(void)
+static inline int po_target_disable(void)
 {
   return 0;
 }
 
 /* Target specific
  */
-static inline void po_interrupt_restore(int oldState)
+static inline void po_target_restore(int oldState)
 {
 }
 
@@ -64,11 +106,62 @@ static inline void po_interrupt_restore(int oldState)
  */
 #define po_function_iscontext() (po_function_getpri() >= 0)
 
-/* Logging (cf. po_log)
+/* Returns non-zero if the next conversion of a log format takes an int,
+ * and moves past it. Other conversions (strings, pointers, longs) take a
+ * whole log word.
+ */
+static inline int po_target_logint(const char **format)
+{
+  const char *f = *format;
+  int isint = 1;
+
+  // Find next conversion
+  for ( ; *f ; f++ ) {
+    if ( *f != '%' ) continue;
+    if ( f[1] != '%' ) break;
+    f++;
+  }
+
+  if ( *f ) {
+    // Skip flags, width and precision, then length and conversion
+    for ( f++ ; *f && strchr("#0- +.123456789", *f) ; f++ )
+      ;
+    for ( ; *f == 'l' || *f == 'z' || *f == 'j' || *f == 't' ; f++ )
+      isint = 0;
+    if ( *f == 's' || *f == 'p' ) isint = 0;
+    if ( *f ) f++;
+  }
+
+  *format = f;
+  return isint;
+}
+
+/* Logging (cf. po_log): the words are format and 2 values. The values are
+ * passed to printf as ints unless the format says otherwise.
+ */
+static inline void po_target_log(intptr_t *buffer)
+{
+  const char *format = (const char*)buffer[1];
+  const char *f = format;
+  int int0 = po_target_logint(&f);
+  int int1 = po_target_logint(&f);
+  if ( int0 && int1 )
+    printf(format, (int)buffer[2], (int)buffer[3]);
+  else if ( int0 )
+    printf(format, (int)buffer[2], buffer[3]);
+  else if ( int1 )
+    printf(format, buffer[2], (int)buffer[3]);
+  else
+    printf(format, buffer[2], buffer[3]);
+}
+
+/* Free running time stamp, in nanoseconds (cf. po_mutex_STATS)
  */
-static inline void po_target_log(int *buffer)
+static inline unsigned long po_target_timestamp(void)
 {
-  printf((char*)buffer[1], buffer[2], buffer[3]);
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (unsigned long)t.tv_sec * 1000000000UL + t.tv_nsec;
 }
 
 /* Target init
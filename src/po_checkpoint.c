@@ -0,0 +1,206 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_checkpoint.h for a module description.
+ *
+ * File layout, in the native word size and byte order: a header, the
+ * table of the saved ranges (address and size), then the bytes of each
+ * range.
+ */
+
+#include <string.h>
+#include <portos.h>
+#include <po_checkpoint.h>
+
+#if po_target_HOSTED
+
+#define po_checkpoint_MAGIC "po_chk1"
+
+/* File header
+ */
+typedef struct {
+  char magic[8];
+  unsigned long wordSize;
+  unsigned long nRanges;
+  uintptr_t imageStart;     /* bounds of the executable image */
+  uintptr_t imageEnd;
+} po_checkpoint_Header;
+
+/* A range of memory
+ */
+typedef struct {
+  uintptr_t addr;
+  size_t size;
+} po_checkpoint_Range;
+
+static po_checkpoint_Range po_checkpoint_Table[po_checkpoint_MAX_RANGES];
+static int po_checkpoint_Count = 0;
+
+/* Relocates a word: pointers into an old range go into its new range,
+ * pointers into the old image into the new image. A pointer just past
+ * the end of a range is only taken if no range starts there.
+ */
+static uintptr_t po_checkpoint_relocate(uintptr_t word,
+					const po_checkpoint_Range *old,
+					const po_checkpoint_Header *header)
+{
+  int i;
+
+  for ( i = 0 ; i < po_checkpoint_Count ; i++ )
+    if ( word - old[i].addr < old[i].size )
+      return word - old[i].addr + po_checkpoint_Table[i].addr;
+  for ( i = 0 ; i < po_checkpoint_Count ; i++ )
+    if ( word == old[i].addr + old[i].size )
+      return word - old[i].addr + po_checkpoint_Table[i].addr;
+  if ( header->imageStart && word - header->imageStart <=
+       header->imageEnd - header->imageStart )
+    return word - header->imageStart + (uintptr_t)po_target_IMAGE_START;
+  return word;
+}
+
+/*-GLOBAL-
+ * Clears the list of ranges.
+ */
+void po_checkpoint_reset(void)
+{
+  po_checkpoint_Count = 0;
+}
+
+/*-GLOBAL-
+ * Registers a range of memory. Returns 0, or -1 if the list is full.
+ */
+int po_checkpoint_add(void *addr, size_t size)
+{
+  if ( po_checkpoint_Count == po_checkpoint_MAX_RANGES ) return -1;
+  po_checkpoint_Table[po_checkpoint_Count].addr = (uintptr_t)addr;
+  po_checkpoint_Table[po_checkpoint_Count].size = size;
+  po_checkpoint_Count++;
+  return 0;
+}
+
+/*-GLOBAL-
+ * Registers the state of the scheduler and of the other system modules.
+ */
+int po_checkpoint_addsystem(void)
+{
+  int error = po_checkpoint_add(&po_function_Env, sizeof(po_function_Env));
+  #if po_memory_PRIORITY_REGIONS
+  error |= po_checkpoint_add(po_memory_RegionPri, sizeof(po_memory_RegionPri));
+  #endif
+  #if po_irq_NUM_SOURCES
+  error |= po_checkpoint_add(po_irq_Table,
+			     po_irq_NUM_SOURCES * sizeof(po_irq_Source));
+  #endif
+  return error;
+}
+
+/*-GLOBAL-
+ * Registers a memory region and its heap buffer.
+ */
+int po_checkpoint_addregion(po_memory_Region *region, void *heap, size_t length)
+{
+  size_t size = offsetof(po_memory_Region, freeList) +
+    region->nFreeLists * sizeof(po_memory_FreeListType);
+  return po_checkpoint_add(region, size) | po_checkpoint_add(heap, length);
+}
+
+/*-GLOBAL-
+ * Registers a signal group.
+ */
+int po_checkpoint_addgroup(po_signal_Group *group)
+{
+  return po_checkpoint_add(group, offsetof(po_signal_Group, list) +
+			   group->hashSize * sizeof(po_list_List));
+}
+
+/*-GLOBAL-
+ * Registers a clock.
+ */
+int po_checkpoint_addclock(po_time_Clock *clock)
+{
+  return po_checkpoint_add(clock, offsetof(po_time_Clock, signalGroup) +
+			   offsetof(po_signal_Group, list) +
+			   clock->signalGroup.hashSize * sizeof(po_list_List));
+}
+
+/*-GLOBAL-
+ * Writes the registered ranges to file. Returns 0, or -1 if a priority
+ * function is running or on a write error.
+ */
+int po_checkpoint_save(FILE *file)
+{
+  po_checkpoint_Header header;
+  int i, n = po_checkpoint_Count;
+
+  if ( po_function_getpri() >= 0 ) return -1;
+
+  memset(&header, 0, sizeof(header));
+  strcpy(header.magic, po_checkpoint_MAGIC);
+  header.wordSize = sizeof(uintptr_t);
+  header.nRanges = n;
+  header.imageStart = (uintptr_t)po_target_IMAGE_START;
+  header.imageEnd = (uintptr_t)po_target_IMAGE_END;
+
+  if ( fwrite(&header, sizeof(header), 1, file) != 1 ) return -1;
+  if ( n && fwrite(po_checkpoint_Table, sizeof(po_checkpoint_Range), n, file) != (size_t)n )
+    return -1;
+  for ( i = 0 ; i < n ; i++ )
+    if ( fwrite((void*)po_checkpoint_Table[i].addr, 1,
+		po_checkpoint_Table[i].size, file) != po_checkpoint_Table[i].size )
+      return -1;
+  return fflush(file) ? -1 : 0;
+}
+
+/*-GLOBAL-
+ * Reads the registered ranges from file and relocates their pointers.
+ * Returns 0, or -1 if a priority function is running, if the file was not
+ * saved with the same list of range sizes or on a read error. The state
+ * is unchanged if the list does not match, undefined after a read error.
+ */
+int po_checkpoint_restore(FILE *file)
+{
+  po_checkpoint_Header header;
+  po_checkpoint_Range old[po_checkpoint_MAX_RANGES];
+  int i, n = po_checkpoint_Count, moved = 0;
+
+  if ( po_function_getpri() >= 0 ) return -1;
+
+  if ( fread(&header, sizeof(header), 1, file) != 1 ||
+       strcmp(header.magic, po_checkpoint_MAGIC) ||
+       header.wordSize != sizeof(uintptr_t) || header.nRanges != (unsigned long)n )
+    return -1;
+  if ( n && fread(old, sizeof(po_checkpoint_Range), n, file) != (size_t)n )
+    return -1;
+
+  // Words are relocated at the same offsets where they were aligned
+  for ( i = 0 ; i < n ; i++ ) {
+    uintptr_t addr = po_checkpoint_Table[i].addr;
+    if ( old[i].size != po_checkpoint_Table[i].size ||
+	 (addr - old[i].addr) % sizeof(uintptr_t) )
+      return -1;
+    moved |= addr != old[i].addr;
+  }
+  moved |= header.imageStart != (uintptr_t)po_target_IMAGE_START;
+
+  for ( i = 0 ; i < n ; i++ ) {
+    char *start = (char*)po_checkpoint_Table[i].addr;
+    char *end = start + po_checkpoint_Table[i].size;
+    char *p;
+
+    if ( fread(start, 1, end - start, file) != (size_t)(end - start) )
+      return -1;
+    if ( !moved ) continue;
+
+    p = start + (-(uintptr_t)start & (sizeof(uintptr_t) - 1));
+    for ( ; p + sizeof(uintptr_t) <= end ; p += sizeof(uintptr_t) ) {
+      uintptr_t word;
+      memcpy(&word, p, sizeof(word));
+      word = po_checkpoint_relocate(word, old, &header);
+      memcpy(p, &word, sizeof(word));
+    }
+  }
+  return 0;
+}
+
+#endif // po_target_HOSTED
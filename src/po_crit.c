@@ -0,0 +1,170 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_crit.h for a module description.
+ *
+ * A window opens when the nesting depth of the masked sections goes from
+ * 0 to 1, and is counted just before the restore that closes it, with
+ * interrupts still masked. The sites are kept in an open addressing hash
+ * table keyed by file name pointer and line. This module masks interrupts
+ * with the target functions, so that its own sections are not counted.
+ */
+
+#include <string.h>
+#include <po_sys.h>
+#include <po_lib.h>
+#include <po_crit.h>
+
+#if po_crit_STATS
+
+#ifdef po_THREAD_LOCAL
+#define po_crit_LOCAL po_THREAD_LOCAL
+#else
+#define po_crit_LOCAL
+#endif
+
+static po_crit_LOCAL po_crit_Site po_crit_Table[po_crit_MAX_SITES];
+static po_crit_LOCAL po_crit_Stats po_crit_Data;
+
+/* Window being timed
+ */
+static po_crit_LOCAL int po_crit_Depth;
+static po_crit_LOCAL const char *po_crit_File;
+static po_crit_LOCAL int po_crit_Line;
+static po_crit_LOCAL unsigned long po_crit_Start;
+
+/* Counts a window of the given length
+ */
+static void po_crit_count(const char *file, int line, unsigned long length)
+{
+  unsigned long hash = (unsigned long)file * 31 + line;
+  int i = (int)(hash % po_crit_MAX_SITES), n, bin;
+
+  po_crit_Data.nWindows++;
+  if ( length > po_crit_Data.max ) po_crit_Data.max = length;
+
+  for ( n = 0 ; n < po_crit_MAX_SITES ; n++ ) {
+    po_crit_Site *site = &po_crit_Table[i];
+
+    if ( site->file == NULL ) {
+      site->file = file;
+      site->line = line;
+      po_crit_Data.nSites++;
+    }
+    if ( site->file == file && site->line == line ) {
+      site->count++;
+      site->total += length;
+      if ( length > site->max ) site->max = length;
+      bin = length >> 16 >> 16 ? po_crit_NUM_BINS - 1 :
+	po_lib_msb((unsigned)length | 1);
+      if ( bin >= po_crit_NUM_BINS ) bin = po_crit_NUM_BINS - 1;
+      site->bin[bin]++;
+      return;
+    }
+
+    if ( ++i == po_crit_MAX_SITES ) i = 0;
+  }
+
+  po_crit_Data.nDropped++;
+}
+
+/* po_interrupt_disable, at a call site
+ */
+int po_crit_disable_(const char *file, int line)
+{
+  int oldState = po_target_disable();
+  if ( po_crit_Depth++ == 0 ) {
+    po_crit_File = file;
+    po_crit_Line = line;
+    po_crit_Start = po_target_timestamp();
+  }
+  return oldState;
+}
+
+/* po_interrupt_restore
+ */
+void po_crit_restore_(int oldState)
+{
+  if ( --po_crit_Depth == 0 )
+    po_crit_count(po_crit_File, po_crit_Line,
+		  po_target_timestamp() - po_crit_Start);
+  po_target_restore(oldState);
+}
+
+/*-GLOBAL-
+ * Clears all counts.
+ */
+void po_crit_reset(void)
+{
+  int protectState = po_target_disable();
+  memset(po_crit_Table, 0, sizeof(po_crit_Table));
+  memset(&po_crit_Data, 0, sizeof(po_crit_Data));
+  po_target_restore(protectState);
+}
+
+/*-GLOBAL-
+ * Copies the counters of all sites.
+ */
+void po_crit_getstats(po_crit_Stats *stats)
+{
+  int protectState = po_target_disable();
+  *stats = po_crit_Data;
+  po_target_restore(protectState);
+}
+
+/*-GLOBAL-
+ * Copies at most n sites into sites, the longest window first. Returns
+ * the number copied.
+ */
+int po_crit_top(po_crit_Site *sites, int n)
+{
+  int protectState, count = 0, i, k;
+
+  if ( n <= 0 ) return 0;
+  protectState = po_target_disable();
+  for ( i = 0 ; i < po_crit_MAX_SITES ; i++ ) {
+    po_crit_Site *site = &po_crit_Table[i];
+    if ( !site->file ) continue;
+    if ( count == n && site->max <= sites[n-1].max ) continue;
+
+    // Insertion, dropping the shortest if full
+    k = count < n ? count++ : n - 1;
+    for ( ; k > 0 && sites[k-1].max < site->max ; k-- )
+      sites[k] = sites[k-1];
+    sites[k] = *site;
+  }
+  po_target_restore(protectState);
+  return count;
+}
+
+/*-GLOBAL-
+ * Writes the n sites with the longest windows, longest first.
+ */
+void po_crit_write(FILE *file, int n)
+{
+  static po_crit_LOCAL po_crit_Site sites[po_crit_MAX_SITES];
+  const char *name;
+  char label[32];
+  int i, k;
+
+  if ( n > po_crit_MAX_SITES ) n = po_crit_MAX_SITES;
+  n = po_crit_top(sites, n);
+
+  fprintf(file, "%-24s %9s %10s %10s  %s\n", "site", "windows", "mean",
+	  "max", "lengths (2^k:windows)");
+  for ( i = 0 ; i < n ; i++ ) {
+    name = strrchr(sites[i].file, '/');
+    name = name ? name + 1 : sites[i].file;
+    snprintf(label, sizeof(label), "%.18s:%d", name, sites[i].line);
+    fprintf(file, "%-24s %9lu %10lu %10lu ", label, sites[i].count,
+	    (unsigned long)(sites[i].total / sites[i].count), sites[i].max);
+    for ( k = 0 ; k < po_crit_NUM_BINS ; k++ )
+      if ( sites[i].bin[k] )
+	fprintf(file, " %s%lu:%lu", k == po_crit_NUM_BINS - 1 ? ">=" : "",
+		1UL << k, sites[i].bin[k]);
+    fprintf(file, "\n");
+  }
+}
+
+#endif // po_crit_STATS
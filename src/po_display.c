@@ -26,7 +26,7 @@ int po_memory_display(po_memory_Region *region)
   int index;
   int nAllocTotal = 0;
 
-  //po_log("po_memory: region 0x%p: currently allocated blocks:\n", (int)region, 0);
+  //po_log("po_memory: region 0x%p: currently allocated blocks:\n", (po_log_Word)region, 0);
 
   for ( index = 0 ; index < region->nFreeLists ; index++ ) {
     int nAlloc = region->freeList[index].nAlloc -
@@ -47,7 +47,7 @@ int po_memory_display(po_memory_Region *region)
       do {
 	po_memory_HeaderType *hdr = po_list_getobj(node, po_memory_HeaderType, node);
 	if ( hdr->file != file || hdr->line != line ) {
-	  //po_log("    %s:%d\n", (int)hdr->file, hdr->line);
+	  //po_log("    %s:%d\n", (po_log_Word)hdr->file, hdr->line);
 	  file = hdr->file;
 	  line = hdr->line;
 	}
@@ -94,7 +94,7 @@ int po_hash_display(po_hash_Table *hashTable)
   int i;
   int count = 0;
 
-  //po_log("po_hash: HASH TABLE %p:", (int)hashTable, 0);
+  //po_log("po_hash: HASH TABLE %p:", (po_log_Word)hashTable, 0);
   for ( i = 0 ; i <= hashTable->modulo ; i++ ) {
     po_hash_Node *node = hashTable->entry[i].trunk;
     while ( node != po_hash_Node_DUMMY(hashTable) ) {
@@ -103,7 +103,7 @@ int po_hash_display(po_hash_Table *hashTable)
       //po_log("\n%3d: ", node->value, 0);
       // Display the objects assigned this value
       while ( listNode != (void*)&node->list ) {
-	//po_log("%p ", (int)listNode, 0);
+	//po_log("%p ", (po_log_Word)listNode, 0);
 	count++;
 	listNode = po_list_next(listNode);
       }
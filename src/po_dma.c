@@ -0,0 +1,262 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_dma.h for a module description.
+ *
+ * The descriptors belong to the Portos thread until they are submitted,
+ * then to the engine until it posts the completion, then to the Portos
+ * thread again. Only the head of a channel is shared, under the engine's
+ * lock. The emulated engine keeps the time at which it will be done with
+ * the transfers so far: a transfer is copied at once but completes at
+ * that time plus its own duration, and the thread sleeps until then on
+ * the absolute time. While the engine has work, a transfer starts when
+ * the previous one is due, not when the thread wakes up, so that sleeping
+ * too long is paid back by the next transfers and the bandwidth holds on
+ * average. Only after the engine went idle does a transfer start now.
+ */
+
+#include <po_sys.h>
+#include <po_dma.h>
+
+#if po_target_HOSTED
+
+#include <errno.h>
+#include <time.h>
+
+/* Monotonic time, in nanoseconds
+ */
+static unsigned long long po_dma_now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (unsigned long long)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/* Completion of a transfer, in the Portos thread
+ */
+static void po_dma_complete(void *arg)
+{
+  po_dma_Desc *last = (po_dma_Desc*)arg;
+  po_dma_Channel *channel = last->channel;
+  po_dma_Done done = last->done;
+  void *donearg = last->arg;
+  size_t bytes = last->bytes;
+  unsigned i = last->first;
+
+  // Freed first so that the completion can submit again
+  while ( 1 ) {
+    po_dma_Desc *desc = &channel->desc[i++ % po_dma_RING_SIZE];
+    desc->busy = 0;
+    if ( desc == last ) break;
+  }
+  channel->nTransfers++;
+  channel->nBytes += bytes;
+
+  done(donearg, bytes);
+}
+
+/* Next channel with a transfer to do, after the one served last. Called
+ * under the engine's lock.
+ */
+static po_dma_Channel *po_dma_next(po_dma_Engine *engine)
+{
+  po_dma_Channel *channel = engine->current, *first = NULL;
+
+  while ( 1 ) {
+    channel = channel && channel->next ? channel->next : engine->channels;
+    if ( !channel || channel == first ) return NULL;
+    if ( channel->fetch != channel->head ) {
+      engine->current = channel;
+      return channel;
+    }
+    if ( !first ) first = channel;
+  }
+}
+
+/* Does the next transfer of a channel. idle is non-zero if the engine
+ * waited for it.
+ */
+static void po_dma_transfer(po_dma_Engine *engine, po_dma_Channel *channel,
+			    int idle)
+{
+  unsigned long long start = engine->free, now = po_dma_now(), due;
+  struct timespec until;
+  po_dma_Desc *desc;
+  size_t bytes = 0;
+
+  if ( idle && start < now ) start = now;
+  do {
+    desc = &channel->desc[channel->fetch++ % po_dma_RING_SIZE];
+    memcpy(desc->dst, desc->src, desc->len);
+    bytes += desc->len;
+  } while ( !desc->last );
+
+  due = start + engine->latency;
+  if ( engine->bandwidth )
+    due += (unsigned long long)((double)bytes * 1e9 / engine->bandwidth);
+  engine->busy += due - start;
+  engine->free = due;
+
+  until.tv_sec = due / 1000000000ULL;
+  until.tv_nsec = due % 1000000000ULL;
+  while ( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL)
+	  == EINTR )
+    ;
+  po_inbox_post(engine->inbox, &desc->post);
+}
+
+/* Thread of an engine
+ */
+static void *po_dma_engine(void *arg)
+{
+  po_dma_Engine *engine = (po_dma_Engine*)arg;
+  po_dma_Channel *channel;
+  int idle = 1;
+
+  while ( 1 ) {
+    pthread_mutex_lock(&engine->lock);
+    while ( !(channel = po_dma_next(engine)) && !engine->stop ) {
+      pthread_cond_wait(&engine->cond, &engine->lock);
+      idle = 1;
+    }
+    pthread_mutex_unlock(&engine->lock);
+    if ( !channel ) return NULL; // Stopped and nothing left
+
+    po_dma_transfer(engine, channel, idle);
+    idle = 0;
+  }
+}
+
+/*-GLOBAL-
+ * Starts an engine copying at bandwidth bytes per second (0 for no limit)
+ * after latency nanoseconds per transfer, whose completions are posted to
+ * inbox. Returns 0, or -1 if its thread could not be created.
+ */
+int po_dma_init(po_dma_Engine *engine, po_inbox_Inbox *inbox,
+		unsigned long bandwidth, unsigned long latency)
+{
+  pthread_mutex_init(&engine->lock, NULL);
+  pthread_cond_init(&engine->cond, NULL);
+  engine->stop = 0;
+  engine->inbox = inbox;
+  engine->channels = engine->current = NULL;
+  engine->bandwidth = bandwidth;
+  engine->latency = latency;
+  engine->free = engine->busy = 0;
+
+  if ( pthread_create(&engine->thread, NULL, po_dma_engine, engine) ) {
+    pthread_cond_destroy(&engine->cond);
+    pthread_mutex_destroy(&engine->lock);
+    return -1;
+  }
+  return 0;
+}
+
+/*-GLOBAL-
+ * Stops an engine once the submitted transfers are done. Completions
+ * still waiting in the inbox are run when it is drained.
+ */
+void po_dma_stop(po_dma_Engine *engine)
+{
+  pthread_mutex_lock(&engine->lock);
+  engine->stop = 1;
+  pthread_cond_signal(&engine->cond);
+  pthread_mutex_unlock(&engine->lock);
+  pthread_join(engine->thread, NULL);
+  pthread_cond_destroy(&engine->cond);
+  pthread_mutex_destroy(&engine->lock);
+}
+
+/*-GLOBAL-
+ * Init a channel of an engine.
+ */
+void po_dma_chinit(po_dma_Channel *channel, po_dma_Engine *engine)
+{
+  int i;
+
+  memset(channel, 0, sizeof(*channel));
+  channel->engine = engine;
+  for ( i = 0 ; i < po_dma_RING_SIZE ; i++ )
+    channel->desc[i].channel = channel;
+
+  pthread_mutex_lock(&engine->lock);
+  channel->next = engine->channels;
+  engine->channels = channel;
+  pthread_mutex_unlock(&engine->lock);
+}
+
+/*-GLOBAL-
+ * Adds a descriptor copying len bytes of src to dst to the transfer being
+ * built. Returns 0, or -1 if the ring is full.
+ */
+int po_dma_add(po_dma_Channel *channel, void *dst, const void *src,
+	       size_t len)
+{
+  po_dma_Desc *desc = &channel->desc[channel->tail % po_dma_RING_SIZE];
+
+  if ( desc->busy ) return -1;
+  desc->dst = dst;
+  desc->src = src;
+  desc->len = len;
+  desc->last = 0;
+  desc->busy = 1;
+  channel->tail++;
+  return 0;
+}
+
+/*-GLOBAL-
+ * Submits the descriptors added since the last transfer as a transfer
+ * completing into done(arg, bytes) at a priority level. Returns 0, or -1
+ * if none were added.
+ */
+int po_dma_submit(po_dma_Channel *channel, po_dma_Done done, void *arg,
+		  int priority)
+{
+  po_dma_Engine *engine = channel->engine;
+  po_dma_Desc *last;
+  size_t bytes = 0;
+  unsigned i;
+
+  if ( channel->tail == channel->head ) return -1;
+
+  for ( i = channel->head ; i != channel->tail ; i++ )
+    bytes += channel->desc[i % po_dma_RING_SIZE].len;
+  last = &channel->desc[(channel->tail - 1) % po_dma_RING_SIZE];
+  last->last = 1;
+  last->first = channel->head;
+  last->bytes = bytes;
+  last->done = done;
+  last->arg = arg;
+  po_inbox_postinit(&last->post, priority, po_dma_complete, last);
+
+  pthread_mutex_lock(&engine->lock);
+  channel->head = channel->tail;
+  pthread_cond_signal(&engine->cond);
+  pthread_mutex_unlock(&engine->lock);
+  return 0;
+}
+
+/*-GLOBAL-
+ * Drops the descriptors added since the last transfer (eg, when the ring
+ * was found full in the middle of a transfer).
+ */
+void po_dma_abort(po_dma_Channel *channel)
+{
+  while ( channel->tail != channel->head )
+    channel->desc[--channel->tail % po_dma_RING_SIZE].busy = 0;
+}
+
+/*-GLOBAL-
+ * Copies len bytes of src to dst in a transfer of its own. Returns 0, or
+ * -1 if the ring is full or a transfer is being built.
+ */
+int po_dma_copy(po_dma_Channel *channel, void *dst, const void *src,
+		size_t len, po_dma_Done done, void *arg, int priority)
+{
+  if ( channel->tail != channel->head || po_dma_add(channel, dst, src, len) )
+    return -1;
+  return po_dma_submit(channel, done, arg, priority);
+}
+
+#endif // po_target_HOSTED
@@ -0,0 +1,114 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_fiber.h for a module description.
+ *
+ * The priority function running a fiber switches to it and gets back
+ * when the fiber blocks or ends, so the scheduler never sees the fiber's
+ * stack. When the fiber ends, its context returns to the caller's (uc_link)
+ * which frees the stack block.
+ */
+
+#include <portos.h>
+#include <po_fiber.h>
+
+#if po_target_HOSTED
+
+/* Running fiber
+ */
+#if po_MULTI_INSTANCE
+static po_THREAD_LOCAL po_fiber_Fiber *po_fiber_Current;
+#else
+static po_fiber_Fiber *po_fiber_Current;
+#endif
+
+/* Entry of a new fiber
+ */
+static void po_fiber_entry(void)
+{
+  po_fiber_Fiber *fiber = po_fiber_Current;
+  fiber->func(fiber->arg);
+  fiber->done = 1;
+}
+
+/* Runs a fiber until it blocks or ends
+ */
+static void po_fiber_run(po_fiber_Fiber *fiber)
+{
+  fiber->prev = po_fiber_Current;
+  po_fiber_Current = fiber;
+  swapcontext(&fiber->caller, &fiber->context);
+  po_fiber_Current = fiber->prev;
+  if ( fiber->done ) po_free(fiber);
+}
+
+/*-GLOBAL-
+ * Returns the running fiber, NULL if none.
+ */
+po_fiber_Fiber *po_fiber_self(void)
+{
+  return po_fiber_Current;
+}
+
+/*-GLOBAL-
+ * Runs func(arg) on a stack of stackSize bytes allocated in region, at
+ * the current priority level, until it ends or blocks. Called from a
+ * priority function. Returns 0, or -1 if the stack could not be allocated.
+ */
+int po_fiber_start(void (*func)(void *arg), void *arg, int stackSize,
+		   po_memory_Region *region)
+{
+  po_fiber_Fiber *fiber = (po_fiber_Fiber*)
+    po_rmalloc(sizeof(po_fiber_Fiber) + stackSize, region);
+  if ( !fiber ) return -1;
+
+  fiber->func = func;
+  fiber->arg = arg;
+  fiber->priority = po_function_getpri();
+  fiber->done = 0;
+
+  getcontext(&fiber->context);
+  fiber->context.uc_stack.ss_sp = fiber + 1;
+  fiber->context.uc_stack.ss_size = stackSize;
+  fiber->context.uc_link = &fiber->caller;
+  makecontext(&fiber->context, po_fiber_entry, 0);
+
+  po_fiber_run(fiber);
+  return 0;
+}
+
+/*-GLOBAL-
+ * Priority function resuming a fiber (cf. po_fiber_wait).
+ */
+void po_fiber_resume(po_priority(fiber->priority), po_fiber_Fiber *fiber)
+{
+  po_fiber_run(fiber);
+}
+
+/*-GLOBAL-
+ * Returns the running fiber, which is about to block. Checks in debug
+ * versions that it can block.
+ */
+po_fiber_Fiber *po_fiber_blocking(void)
+{
+  po_fiber_Fiber *fiber = po_fiber_Current;
+  #if po_DEBUG // DEBUG_MODE
+  if ( !fiber )
+    po_error(po_error_FIBER_NONE);
+  else if ( po_function_getpri() != fiber->priority )
+    po_error(po_error_FIBER_RAISED);
+  #endif // DEBUG_MODE
+  return fiber;
+}
+
+/*-GLOBAL-
+ * Returns to the priority function that ran or resumed the fiber. The
+ * fiber must have scheduled its own resumption (cf. po_fiber_wait).
+ */
+void po_fiber_block(po_fiber_Fiber *fiber)
+{
+  swapcontext(&fiber->context, &fiber->caller);
+}
+
+#endif // po_target_HOSTED
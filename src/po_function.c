@@ -4,25 +4,17 @@
  *
  * Cf. po_function.h for a module description.
  *
- * In this version of the scheduler the database is a bitmap. One bit
- * per priority level indicating if there are awaiting priority functions
- * at this level. If there are, then the priority functions are stored in
- * a simple linked list. In order to insert at the end of the list and
- * retrieve from the beginning of the list, the simple linked list for
- * priority p is organized as follows:
- *
- *      L(p).first-> First-->Second-->Third-->Last-->NULL
- *      L(p).last -> Last-->NULL
- *
- * Empty list
- *      L(p).first = NULL
- *      L(p).last -> (H*)&L(p).first (filling last automatically fills first)
+ * The scheduler keeps the waiting priority functions in a database whose
+ * backend is selected by po_function_BACKEND, behind the operations of
+ * po_function_db.h.
  */
 
 #include <po_sys.h>
 #include <po_memory.h>
 #include <po_lib.h>
 #include <po_function.h>
+#include <po_function_db.h>
+#include <po_irq.h>
 
 /* TODO: move into target area. Issue: not all variables/functions end up in these segments. May need to issue many more of these pragmas.
 #if _TI_
@@ -35,8 +27,12 @@
 #endif
 */
 
-/* Currently active environment
+/* Currently active environment. With multiple instances, this is the
+ * environment of the main thread: other threads select their own.
  */
+#if po_MULTI_INSTANCE
+#undef po_function_Env
+#endif
 po_NEARFAR po_function_Environ po_function_Env = {
   // currpri
   -1,
@@ -45,18 +41,122 @@ po_NEARFAR po_function_Environ po_function_Env = {
   -1,
 
   // trackrun
-  #if po_DEBUG // DEBUG_MODE
+  #if po_function_TRACK_RUN
   NULL,
-  #endif // DEBUG_MODE
+  #endif
 
   // bitmap
   0
 };
 
-/* Mapping of priority level to priority bit in integer bitmap
+#if po_MULTI_INSTANCE
+po_THREAD_LOCAL po_function_Environ *po_function_EnvCurrent = &po_function_Env;
+#define po_function_Env (*po_function_EnvCurrent)
+#endif
+
+#if po_function_FAIR_SOURCES
+
+/* Remove the next call to serve, NULL if there are none. Deficit round
+ * robin with a cost of 1 per call: when its turn comes, a sub-queue is
+ * credited with its weight and it is served until the credit is spent or
+ * until it is empty. Empty sub-queues lose their credit.
  */
-#define po_function_PRI_BIT(priority) (priority)
-#define po_function_PRI_MAX(bitmap) (po_function_PRI_BIT(po_lib_msb(bitmap)))
+static po_function_Handle *po_function_fairpop(po_function_Fair *fair)
+{
+  po_function_FairQueue *queue;
+  po_function_Handle *pfhandle;
+  int protectState = po_interrupt_disable();
+
+  if ( fair->nPending == 0 ) {
+    po_interrupt_restore(protectState);
+    return NULL;
+  }
+
+  queue = &fair->queue[fair->current];
+  while ( !queue->first || queue->deficit <= 0 ) {
+    if ( !queue->first ) queue->deficit = 0;
+    if ( ++fair->current == po_function_FAIR_SOURCES ) fair->current = 0;
+    queue = &fair->queue[fair->current];
+    queue->deficit += queue->weight;
+  }
+
+  pfhandle = queue->first;
+  if ( (queue->first = pfhandle->next) == NULL ) queue->last = NULL;
+  queue->deficit--;
+  queue->nPending--;
+  queue->nCalls++;
+  fair->nPending--;
+
+  po_interrupt_restore(protectState);
+  return pfhandle;
+}
+
+/* Serve the calls of a fair level until there are none left.
+ */
+static void po_function_fairrun(po_function_Fair *fair)
+{
+  po_function_Handle *pfhandle;
+  while ( (pfhandle = po_function_fairpop(fair)) != NULL ) {
+    po_emulateirupt();
+    po_function_callschedulerentry(pfhandle);
+    po_emulateirupt();
+  }
+}
+
+#endif
+
+#if po_function_LEVEL_LIMITS
+
+/* Applies the overflow policy of a full level to a new call. Returns the
+ * call to discard (possibly the new one), NULL if none. Interrupts must be
+ * disabled.
+ */
+static po_function_Handle *po_function_overflow(po_function_BitmapList *list,
+						po_function_Handle *pfhandle)
+{
+  po_function_Handle *prev, *old;
+
+  switch ( list->limit.policy ) {
+  case po_function_LIMIT_DROP_OLDEST:
+    // The running batch is not in the list: the list may be empty
+    if ( (old = list->first) == NULL ) break;
+    if ( (list->first = old->next) == NULL )
+      list->last = (po_function_Handle*)&list->first;
+    list->limit.nPending--;
+    list->limit.nDropped++;
+    return old;
+
+  case po_function_LIMIT_MERGE:
+    // Same overlapping as the empty list (next field is first)
+    prev = (po_function_Handle*)&list->first;
+    for ( ; (old = prev->next) != NULL ; prev = old ) {
+      if ( old->func != pfhandle->func ) continue;
+      pfhandle->next = old->next;
+      prev->next = pfhandle;
+      if ( list->last == old ) list->last = pfhandle;
+      list->limit.nMerged++;
+      return old;
+    }
+    break;
+  }
+
+  list->limit.nRejected++;
+  return pfhandle;
+}
+
+/* Frees a call discarded by a level limit, after telling the hook
+ */
+static void po_function_discard(po_function_Environ *env, int priority,
+				po_function_Handle *discard, int rejected)
+{
+  if ( env->overflowhook ) env->overflowhook(priority, discard, rejected);
+  #if po_function_OWNERS
+  po_function_untag(discard);
+  #endif
+  po_free(discard);
+}
+
+#endif
 
 /*-GLOBAL-
  * Execute all priority functions above prevpri level.
@@ -65,9 +165,8 @@ po_NEARFAR po_function_Environ po_function_Env = {
 void po_function_restorepri(int prevpri)
 {
   po_function_Environ *env = &po_function_Env;
-  int protectState, maxpri;
+  int maxpri;
   po_function_Handle *first, *next;
-  unsigned bitmap;
 
   // Check if new priority functions were installed and that have priorities
   // above prevpri.
@@ -106,20 +205,24 @@ void po_function_restorepri(int prevpri)
     env->currpri = maxpri;
     po_emulateirupt();
 
-    // Get first node at this current priority level to be sure it didn't
-    // vanish.
-    first = list->first;
-    po_emulateirupt();
+    // Interrupt sources first: raised without a handle or a list
+    #if po_irq_NUM_SOURCES
+    if ( list->irqPending ) po_irq_dispatch(list);
+    #endif
 
-    while ( first ) {
-      // Start a new linked list so that we can work on the current one
-      // without locking interrupts (in particular, the last node cannot
-      // be freed while last pointer is pointing at it).
-      po_emulateirupt();
-      list->first = NULL;
-      po_emulateirupt();
-      list->last = (po_function_Handle*)&(list->first);
+    #if po_function_FAIR_SOURCES
+    if ( list->fair ) {
+      // The sub-queues are served by deficit round robin
+      po_function_fairrun(list->fair);
+      first = NULL;
+    } else
+    #endif
+
+    // Take the calls waiting at this current priority level, if they
+    // didn't vanish.
+    first = po_function_dbtake(env, maxpri);
 
+    while ( first ) {
       // For tracking purposes, we can have a temporary first pointer.
       // list->first_tmp = first; (???) (Goes back automatically to NULL???)
 
@@ -136,21 +239,29 @@ void po_function_restorepri(int prevpri)
 	#endif
 	po_emulateirupt();
 
+	// The last call of the batch may chain a call at this level
+	#if po_function_CHAIN
+	list->tail = next ? NULL : first;
+	#endif
+
 	// Call function.
 	po_function_callschedulerentry(first);
 	po_emulateirupt();
+
+	#if po_function_CHAIN
+	list->tail = NULL;
+	if ( list->chain ) {
+	  next = list->chain;
+	  list->chain = NULL;
+	}
+	#endif
 	
 	first = next;
 	po_emulateirupt();
       } while ( first );
 
-      // This one is not so needed here.
-      #if 1
-      first = list->first;
-      #else
-      break;
-      #endif
-      po_emulateirupt();
+      // Calls posted at this level while the batch was running
+      first = po_function_dbtake(env, maxpri);
     }
     po_emulateirupt();
 
@@ -159,26 +270,14 @@ void po_function_restorepri(int prevpri)
     env->currpri = prevpri;
     po_emulateirupt();
 
-    // Get first node again at this lower priority level. If it's NULL then
+    // Check again at this lower priority level. If it's empty then
     // we know for sure there are no nodes left at this level and we can
     // move down to lower level.
-    first = list->first;
     po_emulateirupt();
-
-    // Check if there are really no nodes left at this level.
-    if ( !first ) {
+    if ( po_function_dbisempty(env, maxpri) ) {
       // Find new maxpri
       po_emulateirupt();
-
-      // Bit clear instruction must be atomic
-      protectState = po_interrupt_disable();
-      po_lib_BIT_CLR(env->bitmap, po_function_PRI_BIT(maxpri));
-      po_interrupt_restore(protectState);
-
-      po_emulateirupt();
-      bitmap = env->bitmap;
-      po_emulateirupt();
-      maxpri = po_function_PRI_MAX(bitmap);
+      maxpri = po_function_dbmax(env, maxpri);
       po_emulateirupt();
 
       if ( maxpri <= prevpri ) {
@@ -205,43 +304,68 @@ void po_function_restorepri(int prevpri)
  * immediately called (its priority is not higher than the current
  * priority).
  */
-void po_function_later(po_function_Handle *pfhandle, int priority)
+int po_function_later(po_function_Handle *pfhandle, int priority)
 {
   // Priority of this function is less than the currently running one.
   // Insert in waiting list.
 
   po_function_Environ *env = &po_function_Env;
-  int priorityBit = po_function_PRI_BIT(priority);
   int protectState;
+  #if po_function_LEVEL_LIMITS
+  po_function_BitmapList *list = &env->list[priority];
+  po_function_Handle *discard = NULL;
+  #endif
 
   pfhandle->next = NULL;
   po_emulateirupt();
 
-  protectState = po_interrupt_disable();
-  if ( priority > env->maxpri ) {
-    env->maxpri = priority; // We cannot use maxpri in no-lock ISR version (?)
+  #if po_function_CHAIN
+  if ( priority == env->currpri ) {
+    // Posted by the running priority function at its own level: if it is
+    // the last of its batch and nothing else is waiting, the scheduler
+    // runs this call right after it. Interrupts post at a higher level
+    // (cf. po_function_enterhwi), so the tail and chain fields need no
+    // lock. A call reusing the tail's block must always be chained.
+    po_function_BitmapList *list = &env->list[priority];
+    if ( list->tail && !list->chain &&
+	 (!list->first || pfhandle == list->tail) ) {
+      list->chain = pfhandle;
+      list->tail = NULL;
+      po_function_reportsched(priority);
+      return 0;
+    }
   }
-  po_lib_BIT_SET(env->bitmap, priorityBit);  // Critical if non-atomic
-  env->list[priority].last->next = pfhandle;
-  env->list[priority].last = pfhandle; // Do this first if non-lock ISR
-
-  // If no-lock ISR (RE-CHECK) (there may be issues with non-atomic ptr load)
-  #if 0
-  {
-    po_function_Handle *tmp, *before = env->list[priority].last;
-    // Preemptions here precede us
-    env->list[priority].last = pfhandle;
-    // Preemptions here succeed us
-    while ( (tmp = before->next) != NULL )
-      before = tmp; // Ignore all that preceded us
-    before->next = pfhandle;
+  #endif
+
+  protectState = po_interrupt_disable();
+  #if po_function_LEVEL_LIMITS
+  if ( list->limit.maxPending &&
+       list->limit.nPending >= list->limit.maxPending
+       #if po_function_FAIR_SOURCES
+       && !list->fair
+       #endif
+       ) {
+    discard = po_function_overflow(list, pfhandle);
+    if ( discard == pfhandle || list->limit.policy == po_function_LIMIT_MERGE ) {
+      // Rejected, or merged in place
+      po_interrupt_restore(protectState);
+      po_function_discard(env, priority, discard, discard == pfhandle);
+      return discard == pfhandle ? po_error_FUNC_LEVEL_FULL : 0;
+    }
   }
   #endif
 
+  po_function_dbput(env, pfhandle, priority);
   po_interrupt_restore(protectState);
 
+  // Oldest call dropped to make room
+  #if po_function_LEVEL_LIMITS
+  if ( discard ) po_function_discard(env, priority, discard, 0);
+  #endif
+
   po_emulateirupt();
   po_function_reportsched(priority);
+  return 0;
 }
 
 /*-GLOBAL-
@@ -250,9 +374,15 @@ void po_function_later(po_function_Handle *pfhandle, int priority)
  * NOTE: po_function_callschedulerentry() does not save and restore
  * prevpri (via restorepri). So we need to emulate what po_prep.h does.
  */
-void po_function_call(po_function_Handle *pfhandle, int priority)
+int po_function_call(po_function_Handle *pfhandle, int priority)
 {
   int currpri = po_function_getpri();
+  int error = 0;
+
+  // Not held by a service anymore (eg, released by a queue)
+  #if po_function_OWNERS
+  pfhandle->srvhandle = NULL;
+  #endif
 
   if ( (unsigned)priority > (unsigned)currpri ) {
     #if !po_function_TRACK_NAME
@@ -266,9 +396,10 @@ void po_function_call(po_function_Handle *pfhandle, int priority)
     po_function_exitnow();
 
   } else {
-    po_function_later(pfhandle, priority);
+    error = po_function_later(pfhandle, priority);
     if ( currpri < 0 ) po_function_context(); // Start context
   }
+  return error;
 }
 
 /*-GLOBAL-
@@ -300,7 +431,7 @@ int po_function_raisepri(int priority)
 /*-GLOBAL-
  * Schedules priority functions or calls the requested service.
  */
-void po_function_service(
+int po_function_service(
     po_function_Handle *pfhandle,
     po_function_ServiceHandle *srvhandle,
     void (*func_entry_scheduler)(po_function_Handle*),
@@ -310,30 +441,218 @@ void po_function_service(
 
   if ( !srvhandle ) {
     /* Priority function call */
-    po_function_call(pfhandle, priority);
-    return;
+    return po_function_call(pfhandle, priority);
   }
 
   /* Service request */
   srvhandle->pfhandle = pfhandle;
   srvhandle->priority = priority;
+  #if po_function_OWNERS
+  pfhandle->srvhandle = srvhandle;
+  #endif
 
   /* Call service (this used to be a priority function call) */
   srvhandle->service->func(srvhandle);
+  return 0;
 }
 
+#if po_function_FAIR_SOURCES
 /*-GLOBAL-
- * Module initialization.
+ * Makes a priority level fair, or back to a simple fifo if fair is NULL.
+ * The calls at this level are kept in one sub-queue per source and are
+ * served by deficit round robin, so that a chatty source cannot starve
+ * the others. All weights are set to 1. This should be done at start up,
+ * while nothing is scheduled at this level.
  */
-void po_function_init(void)
+void po_function_fairinit(int priority, po_function_Fair *fair)
+{
+  int i;
+
+  #if po_DEBUG > 1 // DEBUG_MODE
+  if ( priority < 0 || priority >= po_function_NUM_PRI_LEVELS )
+    po_error(po_error_FUNC_BAD_PRIORITY);
+  #endif // DEBUG_MODE
+
+  if ( fair ) {
+    fair->current = po_function_FAIR_SOURCES - 1; // First turn goes to 0
+    fair->nPending = 0;
+    for ( i = 0 ; i < po_function_FAIR_SOURCES ; i++ ) {
+      po_function_FairQueue *queue = &fair->queue[i];
+      queue->first = queue->last = NULL;
+      queue->weight = 1;
+      queue->deficit = 0;
+      queue->nPending = queue->maxPending = 0;
+      queue->nCalls = 0;
+    }
+  }
+  po_function_Env.list[priority].fair = fair;
+}
+
+/*-GLOBAL-
+ * Sets the weight of a source on a fair level: the number of its calls
+ * served per round (at least 1). The level must have been made fair.
+ */
+void po_function_fairweight(int priority, int source, int weight)
+{
+  po_function_Fair *fair;
+
+  #if po_DEBUG > 1 // DEBUG_MODE
+  if ( priority < 0 || priority >= po_function_NUM_PRI_LEVELS ||
+       po_function_Env.list[priority].fair == NULL )
+    po_error(po_error_FUNC_BAD_PRIORITY);
+  if ( source < 0 || source >= po_function_FAIR_SOURCES )
+    po_error(po_error_FUNC_BAD_SOURCE);
+  #endif // DEBUG_MODE
+
+  fair = po_function_Env.list[priority].fair;
+  if ( weight < 1 ) weight = 1;
+  fair->queue[source].weight = weight;
+}
+#endif
+
+#if po_function_LEVEL_LIMITS
+/*-GLOBAL-
+ * Limits the number of calls waiting at a priority level, 0 for no limit.
+ * When the limit is reached, a new call is handled according to policy:
+ * po_function_LIMIT_REJECT does not schedule it, po_function_LIMIT_DROP_OLDEST
+ * discards the oldest waiting call to make room for it, and
+ * po_function_LIMIT_MERGE replaces the oldest waiting call to the same
+ * priority function with it (otherwise it is rejected). Discarded calls are
+ * freed and never run. The calls of the batch being run by the scheduler
+ * are no longer waiting, and fair levels are not limited.
+ */
+void po_function_setlimit(int priority, int maxPending, int policy)
+{
+  po_function_Limit *limit = &po_function_Env.list[priority].limit;
+  int protectState = po_interrupt_disable();
+  limit->maxPending = maxPending;
+  limit->policy = policy;
+  po_interrupt_restore(protectState);
+}
+
+/*-GLOBAL-
+ * Copies the limit and counters of a priority level, then resets its peak
+ * depth to the current depth.
+ */
+void po_function_getlimit(int priority, po_function_Limit *limit)
+{
+  po_function_Limit *levelLimit = &po_function_Env.list[priority].limit;
+  int protectState = po_interrupt_disable();
+  *limit = *levelLimit;
+  levelLimit->peakPending = levelLimit->nPending;
+  po_interrupt_restore(protectState);
+}
+
+/*-GLOBAL-
+ * Sets the function told of the calls discarded by level limits, NULL for
+ * none, and returns the previous one. A priority function call returns
+ * nothing, so this is how its caller learns that it was rejected; the
+ * counters of po_function_getlimit only give the totals. The hook runs in
+ * the context of the post, with interrupts enabled.
+ */
+po_function_OverflowHook po_function_setoverflowhook(po_function_OverflowHook hook)
+{
+  po_function_OverflowHook prev = po_function_Env.overflowhook;
+  po_function_Env.overflowhook = hook;
+  return prev;
+}
+#endif
+
+#if po_function_OWNERS
+/* Scheduler entry of a cancelled call, left in place in the scheduler
+ * lists (unlinking it would cost a search of its level).
+ */
+static void po_function_cancelled(po_function_Handle *pfhandle)
+{
+  po_free(pfhandle);
+}
+
+/*-GLOBAL-
+ * Cancels all the pending calls of an owner: waiting in the scheduler,
+ * attached to signals or timers, or waiting in queues. The calls are
+ * freed and never run, and user signal handles become inactive. As with
+ * po_signal_detach, this should be called at a priority level not below
+ * the levels of the signal groups and clocks involved, and not from HWI.
+ * Returns the number of cancelled calls. The cost is proportional to the
+ * number of calls of the owner.
+ */
+int po_function_cancel(po_function_Owner *owner)
+{
+  int nCancelled = 0;
+  int protectState = po_interrupt_disable();
+
+  while ( !po_list_isempty(&owner->list) ) {
+    po_function_Handle *pfhandle =
+      po_list_getobj(po_list_pophead(&owner->list), po_function_Handle, ownernode);
+    po_function_ServiceHandle *srvhandle = pfhandle->srvhandle;
+    pfhandle->ownernode.next = NULL;
+    nCancelled++;
+
+    if ( !srvhandle ) {
+      // Waiting in the scheduler: turn it into a call that frees itself
+      pfhandle->func = po_function_cancelled;
+    } else {
+      // Held by a service, which removes and frees it
+      po_interrupt_restore(protectState);
+      srvhandle->service->cancel(srvhandle);
+      protectState = po_interrupt_disable();
+    }
+  }
+
+  po_interrupt_restore(protectState);
+  return nCancelled;
+}
+#endif
+
+/*-GLOBAL-
+ * Init an environment: empty database, no running priority function.
+ */
+void po_function_envinit(po_function_Environ *env)
 {
   int i;
+  env->currpri = -1;
+  env->maxpri = -1;
+  #if po_function_TRACK_RUN
+  env->trackrun = NULL;
+  #endif
+  po_function_dbinit(env);
+  #if po_function_FAIR_SOURCES
+  env->source = 0;
+  #endif
+  #if po_function_OWNERS
+  env->owner = NULL;
+  #endif
+  #if po_function_LEVEL_LIMITS
+  env->overflowhook = NULL;
+  #endif
   for ( i = 0 ; i < po_function_NUM_PRI_LEVELS ; i++ ) {
-    po_function_Env.list[i].last =
-      (po_function_Handle*)&po_function_Env.list[i].first;
-    po_function_Env.list[i].first = NULL;
+    #if po_function_FAIR_SOURCES
+    env->list[i].fair = NULL;
+    #endif
+    #if po_function_CHAIN
+    env->list[i].tail = env->list[i].chain = NULL;
+    #endif
+    #if po_irq_NUM_SOURCES
+    env->list[i].irqPending = 0;
+    #endif
+    #if po_function_LEVEL_LIMITS
+    env->list[i].limit.maxPending = 0;
+    env->list[i].limit.policy = po_function_LIMIT_REJECT;
+    env->list[i].limit.nPending = env->list[i].limit.peakPending = 0;
+    env->list[i].limit.nRejected = 0;
+    env->list[i].limit.nDropped = 0;
+    env->list[i].limit.nMerged = 0;
+    #endif
     #if po_DEBUG
-    po_function_Env.list[i].first_tmp = NULL;
+    env->list[i].first_tmp = NULL;
     #endif
   }
 }
+
+/*-GLOBAL-
+ * Module initialization.
+ */
+void po_function_init(void)
+{
+  po_function_envinit(&po_function_Env);
+}
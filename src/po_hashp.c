@@ -5,6 +5,9 @@
  * Cf. po_hash.h for a module description.
  */
 
+// Internal calls of this module belong to no owner (cf. po_function_OWNERS)
+#define po_function_UNOWNED
+
 #include <po_sys.h>
 #include <po_lib.h>
 #include <po_memory.h>
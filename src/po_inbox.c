@@ -0,0 +1,204 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_inbox.h for a module description.
+ *
+ * The posts form a stack: a poster pushes with a compare and swap, the
+ * Portos thread takes the whole stack with an exchange (so there is no
+ * ABA problem) and reverses it to keep the posting order. Only the push
+ * onto an empty stack wakes the Portos thread, which clears the wake up
+ * before taking the stack: a push that follows sees an empty stack and
+ * wakes it again.
+ */
+
+#include <po_sys.h>
+#include <po_function.h>
+#include <po_inbox.h>
+
+#if po_target_HOSTED
+
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+/* Scheduler entry of the posts
+ */
+static void po_inbox_entry(po_function_Handle *pfhandle)
+{
+  po_inbox_Post *post = (po_inbox_Post*)pfhandle;
+  __atomic_store_n(&post->pending, 0, __ATOMIC_RELEASE);
+  post->func(post->arg);
+}
+
+/* Wakes the Portos thread
+ */
+static void po_inbox_wake(po_inbox_Inbox *inbox)
+{
+  #ifdef __linux__
+  uint64_t one = 1;
+  #else
+  char one = 1;
+  #endif
+  ssize_t n = write(inbox->wfd, &one, sizeof(one));
+  (void)n; // Already readable if it fails
+}
+
+/* Clears the wake up
+ */
+static void po_inbox_clear(po_inbox_Inbox *inbox)
+{
+  char buffer[64];
+  while ( read(inbox->fd, buffer, sizeof(buffer)) > 0 )
+    ;
+}
+
+/*-GLOBAL-
+ * Init an inbox. Returns 0, or -1 if its file descriptor could not be
+ * created.
+ */
+int po_inbox_init(po_inbox_Inbox *inbox)
+{
+  inbox->head = NULL;
+  inbox->nPosts = inbox->nBatches = 0;
+  inbox->maxBatch = 0;
+
+  #ifdef __linux__
+  inbox->fd = inbox->wfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  return inbox->fd < 0 ? -1 : 0;
+  #else
+  {
+    int fd[2];
+    if ( pipe(fd) ) return -1;
+    fcntl(fd[0], F_SETFL, O_NONBLOCK);
+    fcntl(fd[1], F_SETFL, O_NONBLOCK);
+    inbox->fd = fd[0];
+    inbox->wfd = fd[1];
+    return 0;
+  }
+  #endif
+}
+
+/*-GLOBAL-
+ * Closes the file descriptors of an inbox.
+ */
+void po_inbox_close(po_inbox_Inbox *inbox)
+{
+  if ( inbox->wfd != inbox->fd ) close(inbox->wfd);
+  close(inbox->fd);
+}
+
+/*-GLOBAL-
+ * Init a post that calls func(arg) at a priority level.
+ */
+void po_inbox_postinit(po_inbox_Post *post, int priority, po_inbox_Func func,
+		       void *arg)
+{
+  #if po_DEBUG > 1 // DEBUG_MODE
+  if ( priority < 0 || priority >= po_function_NUM_PRI_LEVELS )
+    po_error(po_error_FUNC_BAD_PRIORITY);
+  #endif // DEBUG_MODE
+
+  post->pfhandle.next = NULL;
+  post->pfhandle.func = po_inbox_entry;
+  #if po_function_TRACK_NAME
+  post->pfhandle.name = "po_inbox_entry";
+  #endif
+  #if po_function_FAIR_SOURCES
+  post->pfhandle.source = 0;
+  #endif
+  #if po_function_OWNERS
+  post->pfhandle.owner = NULL;
+  post->pfhandle.ownernode.next = NULL;
+  post->pfhandle.srvhandle = NULL;
+  #endif
+  post->func = func;
+  post->arg = arg;
+  post->priority = priority;
+  post->pending = 0;
+}
+
+/*-GLOBAL-
+ * Posts to the inbox, from any thread. Returns 0, or -1 if the post is
+ * still pending.
+ */
+int po_inbox_post(po_inbox_Inbox *inbox, po_inbox_Post *post)
+{
+  po_inbox_Post *head;
+  int idle = 0;
+
+  if ( !__atomic_compare_exchange_n(&post->pending, &idle, 1, 0,
+				    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) )
+    return -1;
+
+  head = __atomic_load_n(&inbox->head, __ATOMIC_RELAXED);
+  do {
+    post->pfhandle.next = (po_function_Handle*)head;
+  } while ( !__atomic_compare_exchange_n(&inbox->head, &head, post, 1,
+					 __ATOMIC_RELEASE, __ATOMIC_RELAXED) );
+
+  if ( !head ) po_inbox_wake(inbox);
+  return 0;
+}
+
+/*-GLOBAL-
+ * Schedules the waiting posts and runs those above the current level,
+ * from the Portos thread. Returns the number of posts.
+ */
+int po_inbox_drain(po_inbox_Inbox *inbox)
+{
+  po_inbox_Post *post, *next, *list = NULL;
+  int prevpri, n = 0;
+
+  po_inbox_clear(inbox);
+  post = __atomic_exchange_n(&inbox->head, NULL, __ATOMIC_ACQUIRE);
+  if ( !post ) return 0;
+
+  // Back to the posting order
+  for ( ; post ; post = next ) {
+    next = (po_inbox_Post*)post->pfhandle.next;
+    post->pfhandle.next = (po_function_Handle*)list;
+    list = post;
+    n++;
+  }
+
+  // Raised so that the whole batch is scheduled before any of it runs
+  prevpri = po_function_raisepri(po_priority_MAX);
+  for ( post = list ; post ; post = next ) {
+    next = (po_inbox_Post*)post->pfhandle.next;
+    #if po_DEBUG && po_function_LEVEL_LIMITS // DEBUG_MODE
+    if ( po_function_Env.list[post->priority].limit.maxPending )
+      po_error(po_error_INBOX_LIMITED_LEVEL);
+    #endif // DEBUG_MODE
+    po_function_later(&post->pfhandle, post->priority);
+  }
+
+  inbox->nPosts += n;
+  inbox->nBatches++;
+  if ( n > inbox->maxBatch ) inbox->maxBatch = n;
+
+  po_function_restorepri(prevpri);
+  return n;
+}
+
+/*-GLOBAL-
+ * Waits up to timeout milliseconds (-1 for ever) for posts, then drains
+ * them. Called from the Portos thread outside priority functions. Returns
+ * the number of posts.
+ */
+int po_inbox_wait(po_inbox_Inbox *inbox, int timeout)
+{
+  struct pollfd pfd;
+
+  if ( !__atomic_load_n(&inbox->head, __ATOMIC_RELAXED) ) {
+    pfd.fd = inbox->fd;
+    pfd.events = POLLIN;
+    if ( poll(&pfd, 1, timeout) <= 0 ) return 0;
+  }
+  return po_inbox_drain(inbox);
+}
+
+#endif // po_target_HOSTED
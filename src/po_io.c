@@ -0,0 +1,321 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_io.h for a module description.
+ *
+ * The io_uring is driven with its system calls and the rings mapped in
+ * memory: the submission tail is published with release ordering, the
+ * completion tail read with acquire ordering. A request carries its own
+ * address as user data. The completions are copied into priority function
+ * calls, so that their requests are free before the calls run.
+ */
+
+#include <po_sys.h>
+#include <po_io.h>
+
+#if po_target_HOSTED && defined(__linux__)
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+
+/* Request out of the free list
+ */
+static po_io_Request *po_io_get(po_io_Context *io)
+{
+  po_io_Request *req = io->free;
+  if ( req ) io->free = req->next;
+  return req;
+}
+
+static void po_io_put(po_io_Context *io, po_io_Request *req)
+{
+  req->next = io->free;
+  io->free = req;
+}
+
+/* Completion of a request, at its priority level
+ */
+static void po_io_complete(po_priority(priority), int priority,
+			   po_io_Done done, void *arg, intptr_t result)
+{
+  done(arg, result);
+}
+
+/* Submits the requests made so far, at the level that made them
+ */
+static void po_io_submit(po_priority(level), int level, po_io_Context *io)
+{
+  int n;
+
+  io->submitLevel = -1;
+  if ( !io->nQueued ) return; // Submitted from a higher level
+
+  __atomic_store_n(io->sqTail, io->tail, __ATOMIC_RELEASE);
+  if ( io->nQueued > io->maxBatch ) io->maxBatch = io->nQueued;
+  io->nSubmits++;
+  do {
+    n = syscall(__NR_io_uring_enter, io->ringfd, io->nQueued, 0, 0, NULL, 0);
+    if ( n > 0 ) io->nQueued -= n;
+  } while ( io->nQueued && (n > 0 || (n < 0 && errno == EINTR)) );
+}
+
+/* Reaps the completions, then waits for more
+ */
+static void po_io_reap(po_priority(io->priority), po_io_Context *io)
+{
+  uint64_t count;
+  unsigned head = *io->cqHead;
+  unsigned tail = __atomic_load_n(io->cqTail, __ATOMIC_ACQUIRE);
+
+  if ( read(io->efd, &count, sizeof(count)) < 0 )
+    ; // Already cleared
+
+  for ( ; head != tail ; head++ ) {
+    struct io_uring_cqe *cqe = &io->cqes[head & *io->cqMask];
+    po_io_Request *req = (po_io_Request*)(uintptr_t)cqe->user_data;
+    po_io_complete(po_priority, req->priority, req->done, req->arg, cqe->res);
+    po_io_put(io, req);
+  }
+  __atomic_store_n(io->cqHead, head, __ATOMIC_RELEASE);
+
+  po_io_reap(po_poll_read_ph(io->efd, io->poller, &io->reaper), io);
+}
+
+/* Work of an offloaded request, on a worker
+ */
+static intptr_t po_io_work(void *arg)
+{
+  po_io_Request *req = (po_io_Request*)arg;
+  ssize_t n = req->write ?
+    pwrite(req->fd, req->buf, req->len, req->offset) :
+    pread(req->fd, req->buf, req->len, req->offset);
+  return n < 0 ? -errno : n;
+}
+
+/* Completion of an offloaded request, at its priority level
+ */
+static void po_io_offloaded(void *arg, intptr_t result)
+{
+  po_io_Request *req = (po_io_Request*)arg;
+  po_io_Done done = req->done;
+  void *donearg = req->arg;
+  po_io_put(req->io, req);
+  done(donearg, result);
+}
+
+/* Sets up the io_uring. Returns -1 if the kernel does not provide it.
+ */
+static int po_io_ringinit(po_io_Context *io)
+{
+  struct io_uring_params p;
+
+  memset(&p, 0, sizeof(p));
+  io->ringfd = syscall(__NR_io_uring_setup, po_io_NUM_REQUESTS, &p);
+  if ( io->ringfd < 0 ) return -1;
+
+  io->sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  io->cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  io->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+  io->sqMap = mmap(NULL, io->sqMapSize, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, io->ringfd, IORING_OFF_SQ_RING);
+  io->cqMap = mmap(NULL, io->cqMapSize, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, io->ringfd, IORING_OFF_CQ_RING);
+  io->sqes = (struct io_uring_sqe*)
+    mmap(NULL, io->sqesSize, PROT_READ | PROT_WRITE,
+	 MAP_SHARED | MAP_POPULATE, io->ringfd, IORING_OFF_SQES);
+  io->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  if ( io->sqMap == MAP_FAILED || io->cqMap == MAP_FAILED ||
+       io->sqes == MAP_FAILED || io->efd < 0 ||
+       syscall(__NR_io_uring_register, io->ringfd, IORING_REGISTER_EVENTFD,
+	       &io->efd, 1) ) {
+    if ( io->sqMap != MAP_FAILED ) munmap(io->sqMap, io->sqMapSize);
+    if ( io->cqMap != MAP_FAILED ) munmap(io->cqMap, io->cqMapSize);
+    if ( io->sqes != MAP_FAILED ) munmap(io->sqes, io->sqesSize);
+    if ( io->efd >= 0 ) close(io->efd);
+    close(io->ringfd);
+    io->ringfd = io->efd = -1;
+    return -1;
+  }
+
+  io->sqHead = (unsigned*)((char*)io->sqMap + p.sq_off.head);
+  io->sqTail = (unsigned*)((char*)io->sqMap + p.sq_off.tail);
+  io->sqMask = (unsigned*)((char*)io->sqMap + p.sq_off.ring_mask);
+  io->sqArray = (unsigned*)((char*)io->sqMap + p.sq_off.array);
+  io->cqHead = (unsigned*)((char*)io->cqMap + p.cq_off.head);
+  io->cqTail = (unsigned*)((char*)io->cqMap + p.cq_off.tail);
+  io->cqMask = (unsigned*)((char*)io->cqMap + p.cq_off.ring_mask);
+  io->cqes = (struct io_uring_cqe*)((char*)io->cqMap + p.cq_off.cqes);
+  io->tail = *io->sqTail;
+  return 0;
+}
+
+/* Makes a request
+ */
+static int po_io_request(po_io_Context *io, int write, int fd, void *buf,
+			 size_t len, off_t offset, po_io_Done done, void *arg,
+			 int priority)
+{
+  po_io_Request *req = po_io_get(io);
+  struct io_uring_sqe *sqe;
+  unsigned index;
+  int i, level;
+
+  if ( !req ) return -1;
+  req->write = write;
+  req->fd = fd;
+  req->buf = buf;
+  req->len = len;
+  req->offset = offset;
+  req->done = done;
+  req->arg = arg;
+  req->priority = priority;
+  io->nRequests++;
+
+  if ( io->ringfd < 0 ) {
+    if ( po_offload(po_io_work, req, po_io_offloaded, priority) == 0 )
+      return 0;
+    po_io_put(io, req);
+    return -1;
+  }
+
+  index = io->tail & *io->sqMask;
+  sqe = &io->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->addr = (uintptr_t)buf;
+  sqe->len = len;
+  sqe->off = offset;
+  sqe->user_data = (uintptr_t)req;
+  for ( i = 0 ; i < io->nBuffers ; i++ ) {
+    char *base = (char*)io->buffers[i].iov_base;
+    if ( (char*)buf >= base &&
+	 (char*)buf + len <= base + io->buffers[i].iov_len ) {
+      sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+      sqe->buf_index = i;
+      break;
+    }
+  }
+  io->sqArray[index] = index;
+  io->tail++;
+  io->nQueued++;
+
+  // Submitted once the requesting level has run what it has pending
+  level = po_function_getpri();
+  if ( level < 0 ) level = 0;
+  if ( level > io->submitLevel ) {
+    io->submitLevel = level;
+    po_io_submit(po_priority, level, io);
+  }
+  return 0;
+}
+
+/*-GLOBAL-
+ * Init an I/O context whose completions are reaped at a priority level
+ * through poller, in a mode (po_io_AUTO or po_io_OFFLOAD). Returns 0, or
+ * -1 for an unknown mode.
+ */
+int po_io_init(po_io_Context *io, po_poll_Poller *poller, int priority,
+	       int mode)
+{
+  int i;
+
+  if ( mode != po_io_AUTO && mode != po_io_OFFLOAD ) return -1;
+  io->poller = poller;
+  io->priority = priority;
+  io->nQueued = 0;
+  io->submitLevel = -1;
+  io->nBuffers = 0;
+  io->nRequests = io->nSubmits = 0;
+  io->maxBatch = 0;
+  io->free = NULL;
+  for ( i = po_io_NUM_REQUESTS - 1 ; i >= 0 ; i-- ) {
+    io->request[i].io = io;
+    po_io_put(io, &io->request[i]);
+  }
+  po_poll_inithandle(&io->reaper);
+
+  io->ringfd = io->efd = -1;
+  if ( mode == po_io_OFFLOAD || po_io_ringinit(io) ) return 0;
+
+  po_io_reap(po_poll_read_ph(io->efd, poller, &io->reaper), io);
+  return 0;
+}
+
+/*-GLOBAL-
+ * Registers buffers up front, with the buffers registered before. Returns
+ * 0, or -1 if there are too many or the kernel refuses them.
+ */
+int po_io_register(po_io_Context *io, const struct iovec *buffers, int n)
+{
+  if ( io->nBuffers + n > po_io_MAX_BUFFERS ) return -1;
+  memcpy(&io->buffers[io->nBuffers], buffers, n * sizeof(*buffers));
+
+  if ( io->ringfd >= 0 ) {
+    if ( io->nBuffers )
+      syscall(__NR_io_uring_register, io->ringfd, IORING_UNREGISTER_BUFFERS,
+	      NULL, 0);
+    if ( syscall(__NR_io_uring_register, io->ringfd, IORING_REGISTER_BUFFERS,
+		 io->buffers, io->nBuffers + n) ) {
+      if ( io->nBuffers )
+	syscall(__NR_io_uring_register, io->ringfd, IORING_REGISTER_BUFFERS,
+		io->buffers, io->nBuffers);
+      return -1;
+    }
+  }
+  io->nBuffers += n;
+  return 0;
+}
+
+/*-GLOBAL-
+ * Closes an I/O context whose requests have all completed.
+ */
+void po_io_close(po_io_Context *io)
+{
+  if ( io->ringfd < 0 ) return;
+  if ( po_poll_isactive(&io->reaper) ) po_poll_cancel(&io->reaper);
+  po_poll_remove(io->efd, io->poller);
+  munmap(io->sqMap, io->sqMapSize);
+  munmap(io->cqMap, io->cqMapSize);
+  munmap(io->sqes, io->sqesSize);
+  close(io->efd);
+  close(io->ringfd);
+  io->ringfd = io->efd = -1;
+}
+
+/*-GLOBAL-
+ * Returns non-zero if the requests go to an io_uring.
+ */
+int po_io_isring(po_io_Context *io)
+{
+  return io->ringfd >= 0;
+}
+
+/*-GLOBAL-
+ * Reads len bytes at offset of fd into buf, then calls done(arg, result)
+ * at a priority level. Returns 0, or -1 if there is no request left.
+ */
+int po_io_read(po_io_Context *io, int fd, void *buf, size_t len,
+	       off_t offset, po_io_Done done, void *arg, int priority)
+{
+  return po_io_request(io, 0, fd, buf, len, offset, done, arg, priority);
+}
+
+/*-GLOBAL-
+ * Writes len bytes of buf at offset of fd, then calls done(arg, result)
+ * at a priority level. Returns 0, or -1 if there is no request left.
+ */
+int po_io_write(po_io_Context *io, int fd, const void *buf, size_t len,
+		off_t offset, po_io_Done done, void *arg, int priority)
+{
+  return po_io_request(io, 1, fd, (void*)buf, len, offset, done, arg,
+		       priority);
+}
+
+#endif // po_target_HOSTED && __linux__
@@ -0,0 +1,117 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_irq.h for a module description
+ */
+
+#include <po_sys.h>
+#include <po_lib.h>
+#include <po_function.h>
+#include <po_irq.h>
+
+#if po_irq_NUM_SOURCES
+
+/* Dispatch table, one entry per interrupt source. With multiple instances,
+ * this is the table of the main thread: other threads select their own.
+ */
+#if po_MULTI_INSTANCE
+static po_irq_Source po_irq_TableMain[po_irq_NUM_SOURCES];
+po_THREAD_LOCAL po_irq_Source *po_irq_TableP = po_irq_TableMain;
+#else
+po_NEARFAR po_irq_Source po_irq_Table[po_irq_NUM_SOURCES];
+#endif
+
+/* Scheduler entry of the preallocated handles
+ */
+static void po_irq_entry(po_function_Handle *pfhandle)
+{
+  po_irq_Source *src = (po_irq_Source*)pfhandle;
+  po_irq_Func func = src->func;
+  if ( func ) func(src->arg);
+}
+
+/*-GLOBAL-
+ * Binds an interrupt source to a function called with arg at the given
+ * priority level when the source is raised.
+ */
+void po_irq_bind(int source, int priority, po_irq_Func func, void *arg)
+{
+  po_irq_Source *src;
+
+  #if po_DEBUG > 1 // DEBUG_MODE
+  if ( source < 0 || source >= po_irq_NUM_SOURCES )
+    po_error(po_error_IRQ_BAD_SOURCE);
+  if ( priority < 0 || priority >= po_function_NUM_PRI_LEVELS )
+    po_error(po_error_FUNC_BAD_PRIORITY);
+  #endif // DEBUG_MODE
+
+  po_irq_unbind(source);
+  src = &po_irq_Table[source];
+
+  src->pfhandle.next = NULL;
+  src->pfhandle.func = po_irq_entry;
+  #if po_function_TRACK_NAME
+  src->pfhandle.name = "po_irq_entry";
+  #endif
+  #if po_function_FAIR_SOURCES
+  src->pfhandle.source = 0;
+  #endif
+  #if po_function_OWNERS
+  src->pfhandle.owner = NULL;
+  src->pfhandle.ownernode.next = NULL;
+  src->pfhandle.srvhandle = NULL;
+  #endif
+  src->arg = arg;
+  src->priority = priority;
+  src->func = func;
+}
+
+/*-GLOBAL-
+ * Unbinds an interrupt source. A pending raise is dropped.
+ */
+void po_irq_unbind(int source)
+{
+  po_irq_Source *src;
+  int protectState;
+
+  #if po_DEBUG > 1 // DEBUG_MODE
+  if ( source < 0 || source >= po_irq_NUM_SOURCES )
+    po_error(po_error_IRQ_BAD_SOURCE);
+  #endif // DEBUG_MODE
+
+  src = &po_irq_Table[source];
+  protectState = po_interrupt_disable();
+  if ( src->func )
+    po_function_Env.list[src->priority].irqPending &= ~(1u << source);
+  src->func = NULL;
+  po_interrupt_restore(protectState);
+}
+
+/*-GLOBAL-
+ * Called by the scheduler at the priority level of list: calls the
+ * functions of the sources raised at this level, higher source ids first.
+ */
+void po_irq_dispatch(po_function_BitmapList *list)
+{
+  unsigned pending;
+  int protectState;
+
+  do {
+    // Take all raised sources at once
+    protectState = po_interrupt_disable();
+    pending = list->irqPending;
+    list->irqPending = 0;
+    po_interrupt_restore(protectState);
+
+    while ( pending ) {
+      int source = po_lib_msb(pending);
+      pending &= ~(1u << source);
+      po_emulateirupt();
+      po_function_callschedulerentry(&po_irq_Table[source].pfhandle);
+      po_emulateirupt();
+    }
+  } while ( list->irqPending );
+}
+
+#endif // po_irq_NUM_SOURCES
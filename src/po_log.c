@@ -5,10 +5,20 @@
  * Cf. po_log.h for a module description.
  */
 
+// Internal calls of this module belong to no owner (cf. po_function_OWNERS)
+#define po_function_UNOWNED
+
 #include <po_log.h>
 
+#if po_MULTI_INSTANCE
+/* Default handle of the instance selected by the current thread
+ */
+po_THREAD_LOCAL po_log_Handle *po_log_HandleDefaultP;
+#endif
+
 /* Priority function that performs logging into a circular buffer. It
- * prints 1 format string and 2 int values.
+ * prints 1 format string and 2 values (ints, or pointers cast to
+ * po_log_Word).
  * For a given buffer, the priority level should be fixed in order to
  * prevent data corruption.
  * The formatting is not performed on the target platform. The host machine
@@ -19,25 +29,25 @@ void po_log_pf(
     #ifndef po_log_NO_PRIORITY
     po_priority(handle->priority),
     #endif
-    po_log_Handle *handle, const char *format, int a0, int a1)
+    po_log_Handle *handle, const char *format, po_log_Word a0, po_log_Word a1)
 {
-  int *buffer = handle->buffer;
+  po_log_Word *buffer = handle->buffer;
   int mask = handle->mask;
   int wr = handle->wrptr;
   buffer[wr & mask] = wr; // Message counter
   wr++;
-  buffer[(wr++) & mask] = (int)format; // What if char* > int ? (const section)
+  buffer[(wr++) & mask] = (po_log_Word)format;
   buffer[(wr++) & mask] = a0;
   buffer[(wr++) & mask] = a1;
   handle->wrptr = wr;
 
-  po_target_log(&buffer[wr-4]);
+  po_target_log(&buffer[(wr-4) & mask]);
 }
 
 /* Shorthand version for po_log_pf and that hides the priority function
  * and handle details: it uses the default handle.
  */
-void po_log(const char *format, int a0, int a1)
+void po_log(const char *format, po_log_Word a0, po_log_Word a1)
 {
   po_log_pf(
     #ifndef po_log_NO_PRIORITY
@@ -27,6 +27,22 @@ static inline po_memory_HeaderType *po_memory_headerAddr(void *block)
   return (po_memory_HeaderType*)((char*)block - po_memory_HEADER_SIZE);
 }
 
+#if po_MULTI_INSTANCE
+/* Default region of the instance selected by the current thread
+ */
+po_THREAD_LOCAL po_memory_Region *po_memory_RegionDefaultP;
+#endif
+
+#if po_memory_PRIORITY_REGIONS
+/* Preferred region of the handles of each priority level. With multiple
+ * instances, each thread has its own table.
+ */
+#if po_MULTI_INSTANCE
+po_THREAD_LOCAL
+#endif
+po_memory_Region *po_memory_RegionPri[po_function_NUM_PRI_LEVELS];
+#endif
+
 #if 0
 /* Data structure for this module
  */
@@ -55,17 +71,12 @@ static inline int po_memory_index2size(int index)
   return size;
 }
 
-/*-GLOBAL-
- * A faster version of malloc. When the size of some data structure
- * is fixed and known, the caller can get and store the index corresponding
- * to this size (using po_memory_size2index). Then call this version of malloc
- * for fastest results.
+/* Allocates a block of a free list index. When the heap is full, the
+ * error is reported only if required, NULL being returned in any case.
+ * The file and line are only used with po_memory_TRACK_ALLOC >= 2.
  */
-#if po_memory_TRACK_ALLOC <= 1
-void *po_gmalloc_index(int index, po_memory_Region *region)
-#else
-void *po_gmalloc_index(int index, po_memory_Region *region, char *file, int line)
-#endif
+static inline void *po_memory_mallocindex(int index, po_memory_Region *region,
+					  int report, char *file, int line)
 {
   int protectState;
   po_memory_FreeListType *freeList;
@@ -75,11 +86,12 @@ void *po_gmalloc_index(int index, po_memory_Region *region, char *file, int line
   // If the index is too large, this block cannot be allocated in this
   // region.
   #if po_DEBUG > 1
-  if ( index >= region->nFreeLists ) {
+  if ( index >= region->nFreeLists && report ) {
     po_error(po_error_MEM_BLOCK_TOO_LARGE);
     return NULL;
   }
   #endif
+  if ( index >= region->nFreeLists && !report ) return NULL;
 
   freeList = &region->freeList[index];
 
@@ -110,15 +122,19 @@ void *po_gmalloc_index(int index, po_memory_Region *region, char *file, int line
     // Free list is empty. Get a new block from the heap buffe
     size = po_memory_index2size(index) + po_memory_HEADER_SIZE;
 
+    // The heap pointer is not moved past the end, so that smaller blocks
+    // can still be allocated (eg, by po_gmalloc_pri) when a block fails.
     protectState = po_interrupt_disable();
     block = region->heap.current;
-    heap_current = region->heap.current = (char*)block + size;
+    heap_current = (char*)block + size;
+    if ( heap_current - region->heap.end <= po_memory_HEADER_SIZE )
+      region->heap.current = heap_current;
     po_interrupt_restore(protectState);
 
     // Check if heap buffer is full
     if ( heap_current - region->heap.end > po_memory_HEADER_SIZE ) {
       // Heap full
-      po_memory_heapfull();
+      if ( report ) po_memory_heapfull();
       return NULL;
     }
 
@@ -144,6 +160,78 @@ void *po_gmalloc_index(int index, po_memory_Region *region, char *file, int line
   return block;
 }
 
+/*-GLOBAL-
+ * A faster version of malloc. When the size of some data structure
+ * is fixed and known, the caller can get and store the index corresponding
+ * to this size (using po_memory_size2index). Then call this version of malloc
+ * for fastest results.
+ */
+#if po_memory_TRACK_ALLOC <= 1
+void *po_gmalloc_index(int index, po_memory_Region *region)
+{
+  return po_memory_mallocindex(index, region, 1, NULL, 0);
+}
+#else
+void *po_gmalloc_index(int index, po_memory_Region *region, char *file, int line)
+{
+  return po_memory_mallocindex(index, region, 1, file, line);
+}
+#endif
+
+#if po_memory_PRIORITY_REGIONS
+/*-GLOBAL-
+ * Allocates a block of a free list index for a handle running at some
+ * priority level. The region of this level is tried first, then the
+ * regions of the lower levels, and finally the fallback region where the
+ * heap full error, if any, is reported as usual. Priorities above the
+ * highest level (eg, from HWI) use the highest level, and those below 0
+ * (eg, outside priority functions) go to the fallback region directly.
+ */
+#if po_memory_TRACK_ALLOC <= 1
+void *po_gmalloc_pri(int index, int priority, po_memory_Region *fallback)
+#else
+void *po_gmalloc_pri(int index, int priority, po_memory_Region *fallback,
+		     char *file, int line)
+#endif
+{
+  po_memory_Region *region, *tried = NULL;
+  void *block;
+
+  #if po_memory_TRACK_ALLOC <= 1
+  char *file = NULL;
+  int line = 0;
+  #endif
+
+  if ( priority >= po_function_NUM_PRI_LEVELS )
+    priority = po_function_NUM_PRI_LEVELS - 1;
+
+  for ( ; priority >= 0 ; priority-- ) {
+    region = po_memory_RegionPri[priority];
+    // Consecutive levels usually share a region
+    if ( !region || region == tried || region == fallback ) continue;
+    tried = region;
+    if ( (block = po_memory_mallocindex(index, region, 0, file, line)) != NULL )
+      return block;
+  }
+
+  return po_memory_mallocindex(index, fallback, 1, file, line);
+}
+
+/*-GLOBAL-
+ * Sets the preferred region of the handles of a priority level, NULL for
+ * none.
+ */
+void po_memory_setpriregion(int priority, po_memory_Region *region)
+{
+  #if po_DEBUG > 1 // DEBUG_MODE
+  if ( priority < 0 || priority >= po_function_NUM_PRI_LEVELS )
+    po_error(po_error_FUNC_BAD_PRIORITY);
+  #endif // DEBUG_MODE
+
+  po_memory_RegionPri[priority] = region;
+}
+#endif
+
 #if po_memory_VARIABLE_SIZE
 /*-GLOBAL-
  * malloc equivalent
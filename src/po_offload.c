@@ -0,0 +1,178 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_offload.h for a module description.
+ *
+ * The free list and the statistics other than the depth belong to the
+ * Portos thread: a job returns to the free list when its completion runs.
+ * The work queue is shared with the workers under a lock held for a few
+ * instructions, and the workers sleep on a condition variable.
+ */
+
+#include <po_sys.h>
+#include <po_offload.h>
+
+#if po_target_HOSTED
+
+static struct {
+  pthread_mutex_t lock;         /* protects the queue, depth and stop */
+  pthread_cond_t cond;          /* signaled when a job is queued */
+  po_offload_Job *head;         /* work queue */
+  po_offload_Job *tail;
+  int stop;
+  po_offload_Job *free;         /* free list */
+  po_inbox_Inbox *inbox;
+  int nWorkers;
+  pthread_t worker[po_offload_MAX_WORKERS];
+  po_offload_Stats stats;
+  po_offload_Job job[po_offload_NUM_JOBS];
+} po_offload_Pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+/* Completion of a job, in the Portos thread
+ */
+static void po_offload_complete(void *arg)
+{
+  po_offload_Job *job = (po_offload_Job*)arg;
+  po_offload_Stats *stats = &po_offload_Pool.stats;
+  po_offload_Done done = job->done;
+  void *jobarg = job->arg;
+  intptr_t result = job->result;
+  unsigned long wait = job->startTime - job->submitTime;
+  unsigned long latency = po_target_timestamp() - job->submitTime;
+
+  stats->nJobs++;
+  stats->waitTotal += wait;
+  if ( wait > stats->waitMax ) stats->waitMax = wait;
+  stats->latencyTotal += latency;
+  if ( latency > stats->latencyMax ) stats->latencyMax = latency;
+
+  // Freed first so that the completion can submit again
+  job->next = po_offload_Pool.free;
+  po_offload_Pool.free = job;
+
+  done(jobarg, result);
+}
+
+/* Thread of a worker
+ */
+static void *po_offload_worker(void *unused)
+{
+  po_offload_Job *job;
+
+  while ( 1 ) {
+    pthread_mutex_lock(&po_offload_Pool.lock);
+    while ( !po_offload_Pool.head && !po_offload_Pool.stop )
+      pthread_cond_wait(&po_offload_Pool.cond, &po_offload_Pool.lock);
+    job = po_offload_Pool.head;
+    if ( job ) {
+      po_offload_Pool.head = job->next;
+      po_offload_Pool.stats.depth--;
+    }
+    pthread_mutex_unlock(&po_offload_Pool.lock);
+    if ( !job ) return NULL; // Stopped and queue empty
+
+    job->startTime = po_target_timestamp();
+    job->result = job->work(job->arg);
+    po_inbox_post(po_offload_Pool.inbox, &job->post);
+  }
+}
+
+/*-GLOBAL-
+ * Starts nWorkers worker threads (at most po_offload_MAX_WORKERS) that
+ * post the completions to inbox. Returns 0, or -1 if a thread could not be
+ * created.
+ */
+int po_offload_init(int nWorkers, po_inbox_Inbox *inbox)
+{
+  int i;
+
+  if ( nWorkers < 1 || nWorkers > po_offload_MAX_WORKERS ) return -1;
+
+  po_offload_Pool.head = po_offload_Pool.tail = NULL;
+  po_offload_Pool.stop = 0;
+  po_offload_Pool.inbox = inbox;
+  memset(&po_offload_Pool.stats, 0, sizeof(po_offload_Pool.stats));
+  po_offload_Pool.free = NULL;
+  for ( i = po_offload_NUM_JOBS - 1 ; i >= 0 ; i-- ) {
+    po_offload_Pool.job[i].next = po_offload_Pool.free;
+    po_offload_Pool.free = &po_offload_Pool.job[i];
+  }
+
+  for ( i = 0 ; i < nWorkers ; i++ )
+    if ( pthread_create(&po_offload_Pool.worker[i], NULL, po_offload_worker,
+			NULL) )
+      break;
+  po_offload_Pool.nWorkers = i;
+  if ( i < nWorkers ) {
+    po_offload_stop();
+    return -1;
+  }
+  return 0;
+}
+
+/*-GLOBAL-
+ * Stops the workers once the submitted work has run. Completions still
+ * waiting in the inbox are run when it is drained.
+ */
+void po_offload_stop(void)
+{
+  int i;
+
+  pthread_mutex_lock(&po_offload_Pool.lock);
+  po_offload_Pool.stop = 1;
+  pthread_cond_broadcast(&po_offload_Pool.cond);
+  pthread_mutex_unlock(&po_offload_Pool.lock);
+
+  for ( i = 0 ; i < po_offload_Pool.nWorkers ; i++ )
+    pthread_join(po_offload_Pool.worker[i], NULL);
+  po_offload_Pool.nWorkers = 0;
+}
+
+/*-GLOBAL-
+ * Runs work(arg) on a worker, then done(arg, result) at a priority level
+ * in the Portos thread. Called from the Portos thread. Returns 0, or -1 if
+ * there is no job left.
+ */
+int po_offload(po_offload_Work work, void *arg, po_offload_Done done,
+	       int priority)
+{
+  po_offload_Job *job = po_offload_Pool.free;
+
+  if ( !job ) {
+    po_offload_Pool.stats.nRejected++;
+    return -1;
+  }
+  po_offload_Pool.free = job->next;
+
+  po_inbox_postinit(&job->post, priority, po_offload_complete, job);
+  job->next = NULL;
+  job->work = work;
+  job->done = done;
+  job->arg = arg;
+  job->submitTime = po_target_timestamp();
+
+  pthread_mutex_lock(&po_offload_Pool.lock);
+  if ( po_offload_Pool.head )
+    po_offload_Pool.tail->next = job;
+  else
+    po_offload_Pool.head = job;
+  po_offload_Pool.tail = job;
+  if ( ++po_offload_Pool.stats.depth > po_offload_Pool.stats.maxDepth )
+    po_offload_Pool.stats.maxDepth = po_offload_Pool.stats.depth;
+  pthread_cond_signal(&po_offload_Pool.cond);
+  pthread_mutex_unlock(&po_offload_Pool.lock);
+  return 0;
+}
+
+/*-GLOBAL-
+ * Copies the statistics, from the Portos thread.
+ */
+void po_offload_stats(po_offload_Stats *stats)
+{
+  pthread_mutex_lock(&po_offload_Pool.lock);
+  *stats = po_offload_Pool.stats;
+  pthread_mutex_unlock(&po_offload_Pool.lock);
+}
+
+#endif // po_target_HOSTED
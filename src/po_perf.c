@@ -0,0 +1,391 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_perf.h for a module description.
+ *
+ * The counters are one perf_event group led by the task clock, read all
+ * at once. The functions are kept in an open addressing hash table keyed
+ * by their tracked name and level; an entry of the chain of running
+ * functions (po_function_Env.trackrun) caches its table entry, so that a
+ * reading only adds up the differences since the previous one. When the
+ * table is full, the counts go to an entry per level. The readings are
+ * made with interrupts disabled, since interrupts may run priority
+ * functions.
+ */
+
+#include <po_sys.h>
+#include <po_function.h>
+#include <po_perf.h>
+
+#if po_perf_ENABLE
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/* A counted function, free if name is NULL
+ */
+typedef struct {
+  const char *name;
+  int priority;
+  po_perf_Counts counts;
+} po_perf_Func;
+
+static po_perf_Func po_perf_Table[po_perf_MAX_FUNCS];
+static po_perf_Func po_perf_None = {"[none]", -1};
+static po_perf_Func po_perf_Other[po_function_NUM_PRI_LEVELS];
+static po_perf_Stats po_perf_Data;
+
+/* Leader of the group (-1 when stopped), and its members, in the order
+ * in which a reading gives them.
+ */
+static int po_perf_Fd = -1;
+static int po_perf_Member[po_perf_NUM_COUNTERS];
+static int po_perf_Counter[po_perf_NUM_COUNTERS];
+static int po_perf_NMembers;
+
+/* Counters of the current or last run
+ */
+static unsigned po_perf_Counted;
+
+/* Previous reading, per counter
+ */
+static unsigned long long po_perf_Last[po_perf_NUM_COUNTERS];
+
+/* Opens a counter of the calling thread, in the group of leader unless
+ * it is -1
+ */
+static int po_perf_open(unsigned type, unsigned long long config, int leader)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.read_format = PERF_FORMAT_GROUP;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+/* Table entry of a function
+ */
+static po_perf_Func *po_perf_lookup(const char *name, int priority)
+{
+  unsigned long hash = (unsigned long)name * 31 + priority;
+  int i = (int)(hash % po_perf_MAX_FUNCS), n;
+
+  for ( n = 0 ; n < po_perf_MAX_FUNCS ; n++ ) {
+    po_perf_Func *func = &po_perf_Table[i];
+    if ( func->name == name && func->priority == priority ) return func;
+    if ( func->name == NULL ) {
+      func->name = name;
+      func->priority = priority;
+      po_perf_Data.nFuncs++;
+      return func;
+    }
+    if ( ++i == po_perf_MAX_FUNCS ) i = 0;
+  }
+
+  po_perf_Data.nDropped++;
+  return &po_perf_Other[priority];
+}
+
+/* Table entry of a running function
+ */
+static po_perf_Func *po_perf_func(po_function_TrackRunType *run)
+{
+  if ( !run ) return &po_perf_None;
+  if ( !run->perf )
+    run->perf = po_perf_lookup((const char*)run->funcname, run->priority);
+  return (po_perf_Func*)run->perf;
+}
+
+/* Reads the counters and gives the counts since the previous reading to
+ * the function on top
+ */
+static void po_perf_read(po_function_TrackRunType *top)
+{
+  struct {
+    unsigned long long nr;
+    unsigned long long value[po_perf_NUM_COUNTERS];
+  } reading;
+  po_perf_Func *func;
+  int i;
+
+  if ( read(po_perf_Fd, &reading, sizeof(reading)) <
+       (ssize_t)sizeof(reading.nr) )
+    return;
+
+  func = po_perf_func(top);
+  for ( i = 0 ; i < (int)reading.nr && i < po_perf_NMembers ; i++ ) {
+    int counter = po_perf_Counter[i];
+    func->counts.count[counter] += reading.value[i] - po_perf_Last[counter];
+    po_perf_Last[counter] = reading.value[i];
+  }
+  po_perf_Data.nReads++;
+}
+
+/* Entry of a priority function, before it is linked to the chain
+ */
+void po_perf_enter_(po_function_TrackRunType *run)
+{
+  int state;
+
+  run->perf = NULL;
+  if ( po_perf_Fd < 0 ) return;
+
+  state = po_interrupt_disable();
+  po_perf_read(po_function_Env.trackrun);
+  po_perf_func(run)->counts.calls++;
+  po_interrupt_restore(state);
+}
+
+/* Exit of a priority function, before it is unlinked from the chain
+ */
+void po_perf_exit_(po_function_TrackRunType *run)
+{
+  int state;
+
+  if ( po_perf_Fd < 0 ) return;
+
+  state = po_interrupt_disable();
+  po_perf_read(run);
+  po_interrupt_restore(state);
+}
+
+/*-GLOBAL-
+ * Starts counting in the calling thread, which runs the priority
+ * functions, from zero counts. Returns 0, or -1 if not even the task
+ * clock could be opened.
+ */
+int po_perf_start(void)
+{
+  static const struct {
+    int counter;
+    unsigned long long config;
+  } hardware[] = {
+    {po_perf_CYCLES, PERF_COUNT_HW_CPU_CYCLES},
+    {po_perf_INSTRUCTIONS, PERF_COUNT_HW_INSTRUCTIONS},
+    {po_perf_CACHE_MISSES, PERF_COUNT_HW_CACHE_MISSES},
+    {po_perf_BRANCH_MISSES, PERF_COUNT_HW_BRANCH_MISSES}
+  };
+  int leader, fd, i, state;
+
+  po_perf_stop();
+  leader = po_perf_open(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, -1);
+  if ( leader < 0 ) return -1;
+
+  po_perf_reset();
+  po_perf_Member[0] = leader;
+  po_perf_Counter[0] = po_perf_TIME;
+  po_perf_NMembers = 1;
+  po_perf_Data.available = 1 << po_perf_TIME;
+  for ( i = 0 ; i < (int)(sizeof(hardware)/sizeof(hardware[0])) ; i++ ) {
+    if ( (fd = po_perf_open(PERF_TYPE_HARDWARE, hardware[i].config,
+			    leader)) < 0 )
+      continue;
+    po_perf_Member[po_perf_NMembers] = fd;
+    po_perf_Counter[po_perf_NMembers++] = hardware[i].counter;
+    po_perf_Data.available |= 1 << hardware[i].counter;
+  }
+  po_perf_Counted = po_perf_Data.available;
+
+  // First reading, given to nobody
+  state = po_interrupt_disable();
+  po_perf_Fd = leader;
+  memset(po_perf_Last, 0, sizeof(po_perf_Last));
+  po_perf_read(NULL);
+  memset(&po_perf_None.counts, 0, sizeof(po_perf_None.counts));
+  po_interrupt_restore(state);
+  return 0;
+}
+
+/*-GLOBAL-
+ * Stops counting. The counts are kept.
+ */
+void po_perf_stop(void)
+{
+  int state, i;
+
+  if ( po_perf_Fd < 0 ) return;
+
+  state = po_interrupt_disable();
+  po_perf_read(po_function_Env.trackrun);
+  po_perf_Fd = -1;
+  po_interrupt_restore(state);
+
+  for ( i = po_perf_NMembers - 1 ; i >= 0 ; i-- )
+    close(po_perf_Member[i]);
+  po_perf_NMembers = 0;
+  po_perf_Data.available = 0;
+}
+
+/*-GLOBAL-
+ * Clears all counts.
+ */
+void po_perf_reset(void)
+{
+  po_function_TrackRunType *run;
+  int state, i;
+
+  state = po_interrupt_disable();
+  memset(po_perf_Table, 0, sizeof(po_perf_Table));
+  memset(&po_perf_None.counts, 0, sizeof(po_perf_None.counts));
+  for ( i = 0 ; i < po_function_NUM_PRI_LEVELS ; i++ ) {
+    memset(&po_perf_Other[i].counts, 0, sizeof(po_perf_Other[i].counts));
+    po_perf_Other[i].name = "[other]";
+    po_perf_Other[i].priority = i;
+  }
+  po_perf_Data.nReads = po_perf_Data.nDropped = 0;
+  po_perf_Data.nFuncs = 0;
+
+  // The running functions no longer have entries
+  for ( run = po_function_Env.trackrun ; run ; run = run->prev )
+    run->perf = NULL;
+  po_interrupt_restore(state);
+}
+
+/*-GLOBAL-
+ * Copies the state of the counters.
+ */
+void po_perf_getstats(po_perf_Stats *stats)
+{
+  int state = po_interrupt_disable();
+  *stats = po_perf_Data;
+  po_interrupt_restore(state);
+}
+
+/* Adds counts to others
+ */
+static void po_perf_add(po_perf_Counts *counts, const po_perf_Counts *add)
+{
+  int i;
+  counts->calls += add->calls;
+  for ( i = 0 ; i < po_perf_NUM_COUNTERS ; i++ )
+    counts->count[i] += add->count[i];
+}
+
+/*-GLOBAL-
+ * Adds up the counts of a function at all levels. Returns the number of
+ * levels it ran at.
+ */
+int po_perf_getfunc(const char *name, po_perf_Counts *counts)
+{
+  int state, i, n = 0;
+
+  memset(counts, 0, sizeof(*counts));
+  state = po_interrupt_disable();
+  for ( i = 0 ; i < po_perf_MAX_FUNCS ; i++ ) {
+    po_perf_Func *func = &po_perf_Table[i];
+    if ( func->name && !strcmp(func->name, name) ) {
+      po_perf_add(counts, &func->counts);
+      n++;
+    }
+  }
+  po_interrupt_restore(state);
+  return n;
+}
+
+/*-GLOBAL-
+ * Adds up the counts of the functions of a priority level.
+ */
+void po_perf_getlevel(int priority, po_perf_Counts *counts)
+{
+  int state, i;
+
+  memset(counts, 0, sizeof(*counts));
+  state = po_interrupt_disable();
+  for ( i = 0 ; i < po_perf_MAX_FUNCS ; i++ )
+    if ( po_perf_Table[i].name && po_perf_Table[i].priority == priority )
+      po_perf_add(counts, &po_perf_Table[i].counts);
+  po_perf_add(counts, &po_perf_Other[priority].counts);
+  po_interrupt_restore(state);
+}
+
+/* Count by which the functions are sorted: cycles, else time
+ */
+static unsigned long long po_perf_key(const po_perf_Counts *counts)
+{
+  return po_perf_Counted & (1 << po_perf_CYCLES) ?
+    counts->count[po_perf_CYCLES] : counts->count[po_perf_TIME];
+}
+
+/* Writes a line of counts
+ */
+static void po_perf_line(FILE *file, const char *label,
+			 const po_perf_Counts *counts)
+{
+  unsigned available = po_perf_Counted;
+  const unsigned long long *count = counts->count;
+  double instr = (double)count[po_perf_INSTRUCTIONS];
+  int hasinstr = available & (1 << po_perf_INSTRUCTIONS) && instr > 0;
+  int i;
+
+  fprintf(file, "%-28s %9lu %10.0f", label, counts->calls,
+	  count[po_perf_TIME] / 1000.0);
+  for ( i = po_perf_CYCLES ; i <= po_perf_INSTRUCTIONS ; i++ )
+    if ( available & (1 << i) ) fprintf(file, " %14llu", count[i]);
+    else fprintf(file, " %14s", "-");
+
+  if ( hasinstr && available & (1 << po_perf_CYCLES) && count[po_perf_CYCLES] )
+    fprintf(file, " %6.2f", instr / count[po_perf_CYCLES]);
+  else fprintf(file, " %6s", "-");
+  for ( i = po_perf_CACHE_MISSES ; i <= po_perf_BRANCH_MISSES ; i++ )
+    if ( hasinstr && available & (1 << i) )
+      fprintf(file, " %9.2f", count[i] * 1000.0 / instr);
+    else fprintf(file, " %9s", "-");
+  fprintf(file, "\n");
+}
+
+/*-GLOBAL-
+ * Writes the counts per function, the busiest first, then per level.
+ * Counts outside priority functions are given under "[none]", and those
+ * dropped under "[other]".
+ */
+void po_perf_write(FILE *file)
+{
+  static po_perf_Func *sorted[po_perf_MAX_FUNCS + po_function_NUM_PRI_LEVELS + 1];
+  po_perf_Counts level;
+  char label[64];
+  int n = 0, i, k;
+
+  // Functions, the busiest first
+  for ( i = 0 ; i < po_perf_MAX_FUNCS + po_function_NUM_PRI_LEVELS + 1 ; i++ ) {
+    po_perf_Func *func = i < po_perf_MAX_FUNCS ? &po_perf_Table[i] :
+      i < po_perf_MAX_FUNCS + po_function_NUM_PRI_LEVELS ?
+      &po_perf_Other[i - po_perf_MAX_FUNCS] : &po_perf_None;
+    if ( !func->name || (!func->counts.calls && !po_perf_key(&func->counts)) )
+      continue;
+    for ( k = n++ ; k > 0 &&
+	    po_perf_key(&sorted[k-1]->counts) < po_perf_key(&func->counts) ;
+	  k-- )
+      sorted[k] = sorted[k-1];
+    sorted[k] = func;
+  }
+
+  fprintf(file, "%-28s %9s %10s %14s %14s %6s %9s %9s\n", "function",
+	  "calls", "time us", "cycles", "instructions", "ipc", "cache/ki",
+	  "branch/ki");
+  for ( i = 0 ; i < n ; i++ ) {
+    if ( sorted[i]->priority < 0 )
+      snprintf(label, sizeof(label), "%s", sorted[i]->name);
+    else
+      snprintf(label, sizeof(label), "%.50s@%d", sorted[i]->name,
+	       sorted[i]->priority);
+    po_perf_line(file, label, &sorted[i]->counts);
+  }
+
+  // Levels
+  for ( i = po_function_NUM_PRI_LEVELS - 1 ; i >= 0 ; i-- ) {
+    po_perf_getlevel(i, &level);
+    if ( !level.calls ) continue;
+    snprintf(label, sizeof(label), "level %d", i);
+    po_perf_line(file, label, &level);
+  }
+}
+
+#endif // po_perf_ENABLE
@@ -0,0 +1,162 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_poll.h for a module description.
+ *
+ * epoll is level triggered. A readiness is registered (armed) when a call
+ * is scheduled on it, and stays registered after the calls run: once the
+ * batch has run, the readinesses that no call waits on any more are
+ * removed. A call cancelled before its readiness shows up is found out
+ * the same way, one wake up later.
+ */
+
+#include <po_sys.h>
+#include <po_poll.h>
+
+#if po_target_HOSTED && defined(__linux__)
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/* Group signal of a readiness
+ */
+#define po_poll_SIGNAL(fd, event) ((fd) * 2 + (event))
+
+/* Registers the readinesses a file descriptor is waited for
+ */
+static void po_poll_arm(po_poll_Poller *poller, int fd)
+{
+  struct epoll_event ev;
+  int armed = poller->armed[fd], waiting = poller->waiting[fd];
+  int op = !waiting ? EPOLL_CTL_DEL : armed ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+
+  ev.events = (waiting & (1 << po_poll_READ) ? EPOLLIN : 0) |
+    (waiting & (1 << po_poll_WRITE) ? EPOLLOUT : 0);
+  ev.data.fd = fd;
+  poller->armed[fd] = waiting;
+  if ( epoll_ctl(poller->epfd, op, fd, &ev) && waiting )
+    po_error(po_error_POLL_BAD_FD);
+}
+
+/*-GLOBAL-
+ * Init a poller whose calls are signals of group (initialized), and that
+ * drains inbox if not NULL. Returns 0, or -1 if epoll could not be set up.
+ */
+int po_poll_init(po_poll_Poller *poller, po_signal_Group *group,
+		 po_inbox_Inbox *inbox)
+{
+  struct epoll_event ev;
+
+  memset(poller->armed, 0, sizeof(poller->armed));
+  memset(poller->waiting, 0, sizeof(poller->waiting));
+  poller->group = group;
+  poller->inbox = inbox;
+  poller->nWakeups = poller->nEvents = 0;
+  poller->maxBatch = 0;
+
+  poller->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if ( poller->epfd < 0 ) return -1;
+  if ( inbox ) {
+    ev.events = EPOLLIN;
+    ev.data.fd = po_inbox_fd(inbox);
+    if ( epoll_ctl(poller->epfd, EPOLL_CTL_ADD, ev.data.fd, &ev) ) {
+      close(poller->epfd);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*-GLOBAL-
+ * Closes the epoll file descriptor of a poller.
+ */
+void po_poll_close(po_poll_Poller *poller)
+{
+  close(poller->epfd);
+}
+
+/*-GLOBAL-
+ * Sets the argument used to schedule a call on an event (po_poll_READ or
+ * po_poll_WRITE) of a file descriptor, with a user handle or NULL.
+ */
+po_function_ServiceHandle *po_poll_setsrv(int fd, int event,
+					  po_poll_Poller *poller,
+					  po_poll_Handle *handle)
+{
+  if ( fd < 0 || fd >= po_poll_MAX_FDS ) {
+    po_error(po_error_POLL_BAD_FD);
+  } else {
+    poller->waiting[fd] |= 1 << event;
+    if ( !(poller->armed[fd] & (1 << event)) ) po_poll_arm(poller, fd);
+  }
+
+  if ( handle )
+    return (po_function_ServiceHandle*)
+      po_signal_setsrv_h(po_poll_SIGNAL(fd, event), poller->group, handle);
+  return (po_function_ServiceHandle*)
+    po_signal_setsrv(po_poll_SIGNAL(fd, event), poller->group);
+}
+
+/*-GLOBAL-
+ * Removes a file descriptor from the poller, once the calls waiting on it
+ * are cancelled.
+ */
+void po_poll_remove(int fd, po_poll_Poller *poller)
+{
+  if ( fd < 0 || fd >= po_poll_MAX_FDS || !poller->armed[fd] ) return;
+  poller->waiting[fd] = 0;
+  po_poll_arm(poller, fd);
+}
+
+/*-GLOBAL-
+ * Waits up to timeout milliseconds (-1 for ever) for file descriptors to
+ * be ready, then runs the calls waiting on them. Called from the Portos
+ * thread outside priority functions. Returns the number of events.
+ */
+int po_poll_wait(po_poll_Poller *poller, int timeout)
+{
+  struct epoll_event ev[po_poll_MAX_EVENTS];
+  int i, n, prevpri, inbox = 0;
+
+  n = epoll_wait(poller->epfd, ev, po_poll_MAX_EVENTS, timeout);
+  if ( n <= 0 ) return 0; // Timeout or interrupted by a signal
+
+  poller->nWakeups++;
+  poller->nEvents += n;
+  if ( n > poller->maxBatch ) poller->maxBatch = n;
+
+  // Raised so that the whole batch is scheduled before any of it runs
+  prevpri = po_function_raisepri(po_priority_MAX);
+  for ( i = 0 ; i < n ; i++ ) {
+    int fd = ev[i].data.fd, ready = 0;
+
+    if ( poller->inbox && fd == po_inbox_fd(poller->inbox) ) {
+      inbox = 1;
+      continue;
+    }
+    if ( ev[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR) )
+      ready |= 1 << po_poll_READ;
+    if ( ev[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR) )
+      ready |= 1 << po_poll_WRITE;
+    ready &= poller->waiting[fd];
+    poller->waiting[fd] &= ~ready;
+
+    if ( ready & (1 << po_poll_READ) )
+      po_signal_post(po_poll_SIGNAL(fd, po_poll_READ), poller->group);
+    if ( ready & (1 << po_poll_WRITE) )
+      po_signal_post(po_poll_SIGNAL(fd, po_poll_WRITE), poller->group);
+  }
+  if ( inbox ) po_inbox_drain(poller->inbox);
+  po_function_restorepri(prevpri);
+
+  // Readinesses no call was scheduled on again
+  for ( i = 0 ; i < n ; i++ ) {
+    int fd = ev[i].data.fd;
+    if ( poller->inbox && fd == po_inbox_fd(poller->inbox) ) continue;
+    if ( poller->armed[fd] != poller->waiting[fd] ) po_poll_arm(poller, fd);
+  }
+  return n;
+}
+
+#endif // po_target_HOSTED && __linux__
@@ -0,0 +1,195 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_profile.h for a module description.
+ *
+ * The stacks are kept in an open addressing hash table, frames innermost
+ * first. A sample only reads the chain of running functions and updates
+ * one table entry, so it can be taken from a signal handler or an
+ * interrupt. Writing or resetting the table suspends sampling meanwhile.
+ */
+
+#include <po_sys.h>
+#include <po_function.h>
+#include <po_profile.h>
+
+#if po_profile_ENABLE
+
+#if po_target_HOSTED
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+/* A counted stack, free if count is 0
+ */
+typedef struct {
+  const char *name[po_profile_MAX_DEPTH];
+  int priority[po_profile_MAX_DEPTH];
+  int depth;
+  int truncated;            /* outer frames were not recorded */
+  unsigned long count;
+} po_profile_Stack;
+
+static po_profile_Stack po_profile_Table[po_profile_MAX_STACKS];
+static po_profile_Stats po_profile_Data;
+
+/* Non-zero while the table is read or cleared: samples are skipped
+ */
+static volatile int po_profile_Busy = 0;
+
+/*-GLOBAL-
+ * Takes one sample: counts the stack of running priority functions. To be
+ * called from a periodic timer interrupt, unless po_profile_start is used.
+ */
+void po_profile_sample(void)
+{
+  po_function_TrackRunType *run = po_function_Env.trackrun;
+  const char *name[po_profile_MAX_DEPTH];
+  int priority[po_profile_MAX_DEPTH];
+  int depth = 0, truncated, i, n, k;
+  unsigned long hash = 0;
+
+  if ( po_profile_Busy ) return;
+  po_profile_Data.nSamples++;
+
+  // Innermost frame first
+  for ( ; run && depth < po_profile_MAX_DEPTH ; run = run->prev ) {
+    name[depth] = (const char*)run->funcname;
+    priority[depth] = run->priority;
+    hash = hash * 31 + ((unsigned long)name[depth] ^ priority[depth]);
+    depth++;
+  }
+  truncated = run != NULL;
+
+  i = hash % po_profile_MAX_STACKS;
+  for ( n = 0 ; n < po_profile_MAX_STACKS ; n++ ) {
+    po_profile_Stack *stack = &po_profile_Table[i];
+
+    if ( stack->count == 0 ) {
+      // New stack
+      for ( k = 0 ; k < depth ; k++ ) {
+	stack->name[k] = name[k];
+	stack->priority[k] = priority[k];
+      }
+      stack->depth = depth;
+      stack->truncated = truncated;
+      stack->count = 1;
+      po_profile_Data.nStacks++;
+      return;
+    }
+
+    if ( stack->depth == depth && stack->truncated == truncated ) {
+      for ( k = 0 ; k < depth ; k++ )
+	if ( stack->name[k] != name[k] || stack->priority[k] != priority[k] )
+	  break;
+      if ( k == depth ) {
+	stack->count++;
+	return;
+      }
+    }
+
+    if ( ++i == po_profile_MAX_STACKS ) i = 0;
+  }
+
+  po_profile_Data.nDropped++;
+}
+
+/*-GLOBAL-
+ * Clears all counts.
+ */
+void po_profile_reset(void)
+{
+  int i;
+  po_profile_Busy = 1;
+  for ( i = 0 ; i < po_profile_MAX_STACKS ; i++ )
+    po_profile_Table[i].count = 0;
+  po_profile_Data.nSamples = po_profile_Data.nDropped = 0;
+  po_profile_Data.nStacks = 0;
+  po_profile_Busy = 0;
+}
+
+/*-GLOBAL-
+ * Copies the counters of the profiler.
+ */
+void po_profile_getstats(po_profile_Stats *stats)
+{
+  po_profile_Busy = 1;
+  *stats = po_profile_Data;
+  po_profile_Busy = 0;
+}
+
+/*-GLOBAL-
+ * Writes the counted stacks in collapsed format. Samples taken outside
+ * priority functions are counted under "[none]".
+ */
+void po_profile_write(FILE *file)
+{
+  int i, k;
+
+  po_profile_Busy = 1;
+  for ( i = 0 ; i < po_profile_MAX_STACKS ; i++ ) {
+    po_profile_Stack *stack = &po_profile_Table[i];
+    if ( stack->count == 0 ) continue;
+
+    if ( stack->truncated ) fprintf(file, "[...];");
+    if ( stack->depth == 0 ) fprintf(file, "[none]");
+    for ( k = stack->depth - 1 ; k >= 0 ; k-- )
+      fprintf(file, "%s@%d%s", stack->name[k], stack->priority[k],
+	      k ? ";" : "");
+    fprintf(file, " %lu\n", stack->count);
+  }
+  po_profile_Busy = 0;
+}
+
+#if po_target_HOSTED
+
+static struct sigaction po_profile_OldAction;
+
+static void po_profile_handler(int sig)
+{
+  po_profile_sample();
+}
+
+/*-GLOBAL-
+ * Starts sampling at the given rate of CPU time (SIGPROF), 1 to 1000000
+ * Hz. Returns 0, or -1 if the rate is out of range or the timer or signal
+ * handler could not be set.
+ */
+int po_profile_start(int hz)
+{
+  struct sigaction action;
+  struct itimerval timer;
+  long period;
+
+  if ( hz < 1 || hz > 1000000 ) return -1;
+  period = 1000000L / hz;
+
+  action.sa_handler = po_profile_handler;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  if ( sigaction(SIGPROF, &action, &po_profile_OldAction) ) return -1;
+
+  timer.it_interval.tv_sec = period / 1000000;
+  timer.it_interval.tv_usec = period % 1000000;
+  timer.it_value = timer.it_interval;
+  if ( setitimer(ITIMER_PROF, &timer, NULL) ) {
+    sigaction(SIGPROF, &po_profile_OldAction, NULL);
+    return -1;
+  }
+  return 0;
+}
+
+/*-GLOBAL-
+ * Stops sampling.
+ */
+void po_profile_stop(void)
+{
+  struct itimerval timer = {{0, 0}, {0, 0}};
+  setitimer(ITIMER_PROF, &timer, NULL);
+  sigaction(SIGPROF, &po_profile_OldAction, NULL);
+}
+
+#endif // po_target_HOSTED
+
+#endif // po_profile_ENABLE
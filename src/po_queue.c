@@ -71,9 +71,26 @@ po_queue_HandleInt *po_queue_setsrv(po_queue_Queue *queue)
 {
   /* Create internal queue handle */
   po_queue_HandleInt *quehandle =
-    po_rmalloc_const(sizeof(*quehandle), queue->memRegion);
+    po_rmalloc_pri(sizeof(*quehandle), po_function_getpri(), queue->memRegion);
   if ( !quehandle ) po_memory_error();
 
   po_function_setsrv(&quehandle->u.service, (po_function_Service*)queue);
   return quehandle;
 }
+
+#if po_function_OWNERS
+/*-GLOBAL-
+ * Cancel method of queues (cf. po_function_cancel): removes a call waiting
+ * for a server.
+ */
+void po_queue_cancel(po_queue_HandleInt *quehandle)
+{
+  po_function_Handle *pfhandle = quehandle->u.service.pfhandle;
+  int protectState = po_interrupt_disable();
+  po_list_pop(&quehandle->node);
+  po_interrupt_restore(protectState);
+
+  po_free(quehandle);
+  po_free(pfhandle);
+}
+#endif
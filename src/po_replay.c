@@ -0,0 +1,149 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_replay.h for a module description.
+ */
+
+#include <po_sys.h>
+#include <po_replay.h>
+
+#if po_TEST
+
+enum {
+  po_replay_OFF,
+  po_replay_RECORD,
+  po_replay_PLAY
+};
+
+/* State of the module
+ */
+typedef struct {
+  int mode;
+  FILE *file;
+  po_replay_Handler handler;
+  unsigned long point;      /* number of points passed */
+  unsigned long current;    /* current point (recording) */
+  int line;                 /* its source line */
+  int pending;              /* next recorded interrupt is valid (replaying) */
+  unsigned long nextPoint;
+  int nextLine;
+  int nextWork;
+  int mismatches;
+} po_replay_State;
+
+static po_replay_State po_replay_Data;
+
+/* Reads the next recorded interrupt
+ */
+static void po_replay_next(po_replay_State *state)
+{
+  state->pending = fscanf(state->file, "%lu %d %d", &state->nextPoint,
+			  &state->nextLine, &state->nextWork) == 3;
+}
+
+/*-GLOBAL-
+ * Emulation point: called by po_emulateirupt() with the source line.
+ */
+void po_replay_point(int line)
+{
+  po_replay_State *state = &po_replay_Data;
+  unsigned long point = state->point++;
+  unsigned long current;
+  int currentLine;
+
+  switch ( state->mode ) {
+  case po_replay_OFF:
+    po_emulateirupt_();
+    break;
+
+  case po_replay_RECORD:
+    // Interrupts nest: restore the point of the interrupted code
+    current = state->current;
+    currentLine = state->line;
+    state->current = point;
+    state->line = line;
+    po_emulateirupt_();
+    state->current = current;
+    state->line = currentLine;
+    break;
+
+  case po_replay_PLAY:
+    while ( state->pending && state->nextPoint == point ) {
+      int work = state->nextWork;
+      if ( state->nextLine != line ) state->mismatches++;
+      po_replay_next(state);
+      state->handler(work);
+    }
+    break;
+  }
+}
+
+/*-GLOBAL-
+ * Runs an emulated interrupt at the current point, and logs it while
+ * recording. Called from po_emulateirupt_, ignored while replaying.
+ */
+void po_replay_fire(int work)
+{
+  po_replay_State *state = &po_replay_Data;
+  if ( state->mode != po_replay_RECORD ) return;
+  fprintf(state->file, "%lu %d %d\n", state->current, state->line, work);
+  state->handler(work);
+}
+
+/*-GLOBAL-
+ * Starts recording in file the interrupts run by handler.
+ */
+void po_replay_record(FILE *file, po_replay_Handler handler)
+{
+  po_replay_State *state = &po_replay_Data;
+  state->file = file;
+  state->handler = handler;
+  state->point = 0;
+  state->current = 0;
+  state->line = 0;
+  state->mismatches = 0;
+  state->mode = po_replay_RECORD;
+}
+
+/*-GLOBAL-
+ * Starts replaying a run recorded in file.
+ */
+void po_replay_play(FILE *file, po_replay_Handler handler)
+{
+  po_replay_State *state = &po_replay_Data;
+  state->file = file;
+  state->handler = handler;
+  state->point = 0;
+  state->mismatches = 0;
+  po_replay_next(state);
+  state->mode = po_replay_PLAY;
+}
+
+/*-GLOBAL-
+ * Stops recording or replaying. Returns 0, or while replaying the number
+ * of mismatches with the recorded run: interrupts at points of a different
+ * source line, interrupts not replayed, different number of points.
+ */
+int po_replay_stop(void)
+{
+  po_replay_State *state = &po_replay_Data;
+  unsigned long points;
+
+  if ( state->mode == po_replay_RECORD ) {
+    fprintf(state->file, "end %lu\n", state->point);
+  } else if ( state->mode == po_replay_PLAY ) {
+    while ( state->pending ) {
+      state->mismatches++;
+      po_replay_next(state);
+    }
+    if ( fscanf(state->file, " end %lu", &points) != 1 ||
+	 points != state->point )
+      state->mismatches++;
+  }
+
+  state->mode = po_replay_OFF;
+  return state->mismatches;
+}
+
+#endif // po_TEST
@@ -0,0 +1,179 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_rt.h for a module description.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // CPU affinity
+#endif
+#include <po_sys.h>
+#include <po_lib.h>
+#include <po_log.h>
+#include <po_rt.h>
+
+#if po_target_HOSTED && defined(__linux__)
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+
+/* First isolated CPU in the calling thread's affinity, or else its last
+ * CPU. Returns -1 if the affinity cannot be read.
+ */
+static int po_rt_cpu(void)
+{
+  cpu_set_t set;
+  FILE *file;
+  int cpu = -1, isolated;
+
+  if ( sched_getaffinity(0, sizeof(set), &set) ) return -1;
+
+  // A list such as "2-3,6", empty if none
+  file = fopen("/sys/devices/system/cpu/isolated", "r");
+  if ( file ) {
+    if ( fscanf(file, "%d", &isolated) == 1 && isolated < CPU_SETSIZE )
+      cpu = isolated;
+    fclose(file);
+  }
+  // Isolated CPUs are usually left out of the default affinity
+  if ( cpu >= 0 ) return cpu;
+
+  for ( cpu = CPU_SETSIZE - 1 ; cpu >= 0 ; cpu-- )
+    if ( CPU_ISSET(cpu, &set) ) break;
+  return cpu;
+}
+
+/*-GLOBAL-
+ * Writes every page of the part of a region's heap not yet handed out, so
+ * that allocating from it causes no page fault.
+ */
+void po_rt_prefault(po_memory_Region *region)
+{
+  uintptr_t page = sysconf(_SC_PAGESIZE);
+  volatile char *p = region->heap.current;
+  char *end = region->heap.end;
+
+  if ( p >= end ) return;
+  *p = 0; // First page, partly handed out: only from current on
+
+  // Then every page from the next page boundary, the last partial one too
+  for ( p = (char*)(((uintptr_t)p | (page - 1)) + 1) ; p < end ; p += page )
+    *p = 0;
+}
+
+/*-GLOBAL-
+ * Sets up the calling thread for real time: the steps given (po_rt_PIN,
+ * po_rt_FIFO, po_rt_LOCK, po_rt_PREFAULT) on a CPU (-1 for the first
+ * isolated one, else the last one allowed) at a SCHED_FIFO priority.
+ * Returns the steps that succeeded.
+ */
+int po_rt_start(int cpu, int priority, int steps)
+{
+  int done = 0;
+
+  if ( steps & po_rt_PIN ) {
+    cpu_set_t set;
+    if ( cpu < 0 ) cpu = po_rt_cpu();
+    if ( cpu >= 0 && cpu < CPU_SETSIZE ) {
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      if ( pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 )
+	done |= po_rt_PIN;
+    }
+  }
+
+  if ( steps & po_rt_FIFO ) {
+    struct sched_param param;
+    param.sched_priority = priority;
+    if ( pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0 )
+      done |= po_rt_FIFO;
+  }
+
+  // Locking faults the current pages in; pre-faulting still gives the
+  // heap real pages when locking is not permitted
+  if ( (steps & po_rt_LOCK) && mlockall(MCL_CURRENT | MCL_FUTURE) == 0 )
+    done |= po_rt_LOCK;
+
+  if ( steps & po_rt_PREFAULT ) {
+    po_rt_prefault((po_memory_Region*)&po_memory_RegionDefault);
+    done |= po_rt_PREFAULT;
+  }
+  return done;
+}
+
+/*-GLOBAL-
+ * Measures the lateness of samples wake ups from a timer of period
+ * microseconds, in the calling thread.
+ */
+void po_rt_jitter(po_rt_Jitter *jitter, int samples, int period)
+{
+  struct timespec next, now;
+  unsigned long late;
+  int i, bucket;
+
+  memset(jitter, 0, sizeof(*jitter));
+  jitter->min = (unsigned long)-1;
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  for ( i = 0 ; i < samples ; i++ ) {
+    next.tv_nsec += period * 1000L;
+    while ( next.tv_nsec >= 1000000000L ) {
+      next.tv_nsec -= 1000000000L;
+      next.tv_sec++;
+    }
+    while ( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR )
+      ;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    late = (unsigned long)(now.tv_sec - next.tv_sec) * 1000000000UL +
+      now.tv_nsec - next.tv_nsec;
+    bucket = po_lib_msb((unsigned)(late / 1000) | 1);
+    if ( bucket >= po_rt_BUCKETS ) bucket = po_rt_BUCKETS - 1;
+    jitter->histogram[bucket]++;
+    jitter->samples++;
+    jitter->total += late;
+    if ( late < jitter->min ) jitter->min = late;
+    if ( late > jitter->max ) jitter->max = late;
+  }
+}
+
+/*-GLOBAL-
+ * Returns a bound, in microseconds, of the lateness of a share of the
+ * wake ups, in thousandths (eg, 999).
+ */
+unsigned long po_rt_quantile(po_rt_Jitter *jitter, int perMille)
+{
+  unsigned long count = 0;
+  int i;
+
+  for ( i = 0 ; i < po_rt_BUCKETS - 1 ; i++ ) {
+    count += jitter->histogram[i];
+    if ( count * 1000 >= (unsigned long)jitter->samples * perMille ) break;
+  }
+  return 2UL << i;
+}
+
+/*-GLOBAL-
+ * Logs the lateness distribution.
+ */
+void po_rt_report(po_rt_Jitter *jitter)
+{
+  int i;
+
+  if ( !jitter->samples ) return;
+  po_log("jitter: %d wake ups, min %ld ns,", jitter->samples, jitter->min);
+  po_log(" mean %ld ns, max %ld ns\n", jitter->total / jitter->samples,
+	 jitter->max);
+  for ( i = 0 ; i < po_rt_BUCKETS ; i++ )
+    if ( jitter->histogram[i] )
+      po_log("  < %ld us: %ld\n", 2L << i, jitter->histogram[i]);
+  po_log("  99%% under %ld us, 99.9%% under %ld us\n",
+	 po_rt_quantile(jitter, 990), po_rt_quantile(jitter, 999));
+}
+
+#endif // po_target_HOSTED && __linux__
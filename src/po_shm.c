@@ -0,0 +1,341 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_shm.h for a module description.
+ *
+ * The ring is a bounded multiple producer queue: each slot carries a
+ * sequence number telling the round in which it is free (position) or
+ * filled (position + 1). A poster claims a position with a compare and
+ * swap on the tail, fills the slot, then publishes it with release
+ * ordering; the receiver frees the slot for the next round once it has
+ * copied it into a priority function call.
+ *
+ * The receiver sets the waiting flag before it sleeps and looks at the
+ * ring again; a poster looks at the flag after publishing. Both sides
+ * have a full fence in between, so that either the receiver sees the
+ * message or the poster sees the flag and wakes it.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // memfd_create
+#endif
+#include <po_sys.h>
+#include <po_memory.h>
+#include <po_function.h>
+#include <po_prep.h>
+#include <po_shm.h>
+
+#if po_target_HOSTED && defined(__linux__)
+
+#include <sched.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+#define po_shm_MAGIC 0x706f73686dUL
+
+/* Call of a message, at its priority level
+ */
+static void po_shm_call(po_priority(priority), int priority, po_shm_Func func,
+			void *payload, intptr_t word)
+{
+  func(payload, word);
+}
+
+/* Region lock, shared by the processes. Interrupts are disabled so that
+ * a handler of the same thread does not wait for it.
+ */
+static int po_shm_lock(po_shm_Shared *shared)
+{
+  int protectState = po_interrupt_disable();
+  while ( __atomic_exchange_n(&shared->lock, 1, __ATOMIC_ACQUIRE) )
+    while ( __atomic_load_n(&shared->lock, __ATOMIC_RELAXED) )
+      sched_yield();
+  return protectState;
+}
+
+static void po_shm_unlock(po_shm_Shared *shared, int protectState)
+{
+  __atomic_store_n(&shared->lock, 0, __ATOMIC_RELEASE);
+  po_interrupt_restore(protectState);
+}
+
+/* Returns non-zero if the next slot to run is filled
+ */
+static inline int po_shm_ready(po_shm_Shared *shared)
+{
+  unsigned long head = shared->head;
+  return __atomic_load_n(&shared->slot[head % po_shm_NUM_SLOTS].seq,
+			 __ATOMIC_ACQUIRE) == head + 1;
+}
+
+/* Process-local part of a channel
+ */
+static void po_shm_local(po_shm_Channel *channel, po_shm_Shared *shared,
+			 int fd, int efd)
+{
+  memset(channel, 0, sizeof(*channel));
+  channel->shared = shared;
+  channel->fd = fd;
+  channel->efd = efd;
+}
+
+/*-GLOBAL-
+ * Creates a channel whose region has a heap of heapSize bytes. Returns 0,
+ * or -1 if the mapping or the eventfd could not be created.
+ */
+int po_shm_create(po_shm_Channel *channel, size_t heapSize)
+{
+  long page = sysconf(_SC_PAGESIZE);
+  size_t size = (sizeof(po_shm_Shared) + heapSize + page - 1) & ~(page - 1);
+  po_memory_Region *region;
+  po_shm_Shared *shared;
+  char *heap;
+  int fd, efd, i;
+
+  fd = memfd_create("portos-shm", MFD_CLOEXEC);
+  if ( fd < 0 ) return -1;
+  efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if ( efd < 0 || ftruncate(fd, size) ) {
+    if ( efd >= 0 ) close(efd);
+    close(fd);
+    return -1;
+  }
+  shared = (po_shm_Shared*)mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_SHARED, fd, 0);
+  if ( shared == MAP_FAILED ) {
+    close(efd);
+    close(fd);
+    return -1;
+  }
+
+  // The mapping reads as zeroes
+  shared->magic = po_shm_MAGIC;
+  shared->base = shared;
+  shared->size = size;
+  for ( i = 0 ; i < po_shm_NUM_SLOTS ; i++ )
+    shared->slot[i].seq = i;
+
+  // Same as po_memory_REGIONINIT, at run time
+  region = &shared->region.region;
+  heap = (char*)(shared + 1);
+  #if po_memory_TRACK_ALLOC >= 1
+  region->heap.start = heap;
+  #endif
+  region->heap.current = heap + (po_memory_HEADER_SIZE + po_memory_ALIGN - 1);
+  region->heap.end = (char*)shared + size;
+  region->nFreeLists = sizeof(shared->region.storage) /
+    sizeof(shared->region.storage[0]) + 1;
+  po_memory_regioninit(region);
+
+  po_shm_local(channel, shared, fd, efd);
+  return 0;
+}
+
+/*-GLOBAL-
+ * Attaches to a channel created by another process, given its memfd and
+ * eventfd. Returns 0, or -1 if it cannot be mapped at the creator's
+ * address.
+ */
+int po_shm_attach(po_shm_Channel *channel, int fd, int efd)
+{
+  po_shm_Shared head;
+  void *shared;
+
+  if ( pread(fd, &head, offsetof(po_shm_Shared, tail), 0) !=
+       (ssize_t)offsetof(po_shm_Shared, tail) || head.magic != po_shm_MAGIC )
+    return -1;
+
+  // The address is a hint: refused if the kernel maps it elsewhere
+  shared = mmap(head.base, head.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		fd, 0);
+  if ( shared == MAP_FAILED ) return -1;
+  if ( shared != head.base ) {
+    munmap(shared, head.size);
+    return -1;
+  }
+
+  po_shm_local(channel, (po_shm_Shared*)shared, fd, efd);
+  return 0;
+}
+
+/*-GLOBAL-
+ * Unmaps a channel and closes its file descriptors.
+ */
+void po_shm_close(po_shm_Channel *channel)
+{
+  munmap(channel->shared, channel->shared->size);
+  close(channel->efd);
+  close(channel->fd);
+  channel->shared = NULL;
+}
+
+/*-GLOBAL-
+ * Binds a function to a message number, in the receiving process, or
+ * unbinds it if func is NULL.
+ */
+void po_shm_bind(po_shm_Channel *channel, int number, po_shm_Func func)
+{
+  #if po_DEBUG > 1 // DEBUG_MODE
+  if ( number < 0 || number >= po_shm_NUM_FUNCS )
+    po_error(po_error_SHM_BAD_MESSAGE);
+  #endif // DEBUG_MODE
+
+  channel->func[number] = func;
+}
+
+/*-GLOBAL-
+ * Posts a message calling the function bound to number with payload and
+ * word at a priority level of the receiver, from any thread of any
+ * process. Returns 0, or -1 if the ring is full.
+ */
+int po_shm_post(po_shm_Channel *channel, int number, int priority,
+		void *payload, intptr_t word)
+{
+  po_shm_Shared *shared = channel->shared;
+  unsigned long pos = __atomic_load_n(&shared->tail, __ATOMIC_RELAXED);
+  po_shm_Slot *slot;
+  long diff;
+
+  while ( 1 ) {
+    slot = &shared->slot[pos % po_shm_NUM_SLOTS];
+    diff = (long)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+    if ( diff == 0 ) {
+      if ( __atomic_compare_exchange_n(&shared->tail, &pos, pos + 1, 1,
+				       __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+	break;
+    } else if ( diff < 0 ) {
+      // Not yet freed by the receiver
+      __atomic_fetch_add(&shared->nFull, 1, __ATOMIC_RELAXED);
+      return -1;
+    } else {
+      pos = __atomic_load_n(&shared->tail, __ATOMIC_RELAXED);
+    }
+  }
+
+  slot->number = number;
+  slot->priority = priority;
+  slot->payload = payload;
+  slot->word = word;
+  __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if ( __atomic_load_n(&shared->waiting, __ATOMIC_RELAXED) &&
+       __atomic_exchange_n(&shared->waiting, 0, __ATOMIC_RELAXED) ) {
+    uint64_t one = 1;
+    ssize_t n = write(channel->efd, &one, sizeof(one));
+    (void)n; // Already readable if it fails
+  }
+  return 0;
+}
+
+/*-GLOBAL-
+ * Schedules the waiting messages and runs those above the current level,
+ * from the receiving Portos thread. Returns the number of messages. At
+ * most one ring of messages is taken, so that posters refilling the ring
+ * meanwhile cannot make the batch, and the handles it allocates, grow
+ * without bound.
+ */
+int po_shm_drain(po_shm_Channel *channel)
+{
+  po_shm_Shared *shared = channel->shared;
+  unsigned long head = shared->head;
+  po_shm_Slot *slot;
+  po_shm_Func func;
+  int prevpri, priority, n = 0;
+
+  __atomic_store_n(&shared->waiting, 0, __ATOMIC_RELAXED);
+  if ( !po_shm_ready(shared) ) return 0;
+
+  // Raised so that the whole batch is scheduled before any of it runs
+  prevpri = po_function_raisepri(po_priority_MAX);
+  while ( n < po_shm_NUM_SLOTS ) {
+    slot = &shared->slot[head % po_shm_NUM_SLOTS];
+    if ( __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != head + 1 ) break;
+
+    priority = slot->priority;
+    func = (unsigned)slot->number < po_shm_NUM_FUNCS ?
+      channel->func[slot->number] : NULL;
+    if ( func && priority >= 0 && priority < po_function_NUM_PRI_LEVELS )
+      po_shm_call(po_priority, priority, func, slot->payload, slot->word);
+    #if po_DEBUG // DEBUG_MODE
+    else
+      po_error(po_error_SHM_BAD_MESSAGE);
+    #endif // DEBUG_MODE
+
+    __atomic_store_n(&slot->seq, head + po_shm_NUM_SLOTS, __ATOMIC_RELEASE);
+    head++;
+    n++;
+  }
+  __atomic_store_n(&shared->head, head, __ATOMIC_RELAXED);
+
+  channel->nMessages += n;
+  channel->nBatches++;
+  if ( n > channel->maxBatch ) channel->maxBatch = n;
+
+  po_function_restorepri(prevpri);
+  return n;
+}
+
+/*-GLOBAL-
+ * Tells the posters that the receiver is about to wait on po_shm_fd.
+ * Returns 0, or -1 if messages are already waiting (then drain them
+ * rather than wait).
+ */
+int po_shm_arm(po_shm_Channel *channel)
+{
+  po_shm_Shared *shared = channel->shared;
+
+  __atomic_store_n(&shared->waiting, 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if ( !po_shm_ready(shared) ) return 0;
+  __atomic_store_n(&shared->waiting, 0, __ATOMIC_RELAXED);
+  return -1;
+}
+
+/*-GLOBAL-
+ * Waits up to timeout milliseconds (-1 for ever) for messages, then
+ * drains them. Called from the receiving Portos thread outside priority
+ * functions. Returns the number of messages.
+ */
+int po_shm_wait(po_shm_Channel *channel, int timeout)
+{
+  struct pollfd pfd;
+  uint64_t count;
+
+  if ( po_shm_arm(channel) == 0 ) {
+    pfd.fd = channel->efd;
+    pfd.events = POLLIN;
+    if ( poll(&pfd, 1, timeout) <= 0 ) return po_shm_drain(channel);
+    if ( read(channel->efd, &count, sizeof(count)) > 0 )
+      channel->nWakeups++;
+  }
+  return po_shm_drain(channel);
+}
+
+/*-GLOBAL-
+ * Allocates a payload of size bytes in the channel's region, from any
+ * process. Returns NULL if the heap is full, unless that aborts (cf.
+ * po_memory_HEAP_FULL_ABORT).
+ */
+void *po_shm_malloc(po_shm_Channel *channel, int size)
+{
+  int protectState = po_shm_lock(channel->shared);
+  void *payload = po_rmalloc(size, &channel->shared->region.region);
+  po_shm_unlock(channel->shared, protectState);
+  return payload;
+}
+
+/*-GLOBAL-
+ * Frees a payload of the channel's region, from any process.
+ */
+void po_shm_free(po_shm_Channel *channel, void *payload)
+{
+  int protectState = po_shm_lock(channel->shared);
+  po_free(payload);
+  po_shm_unlock(channel->shared, protectState);
+}
+
+#endif // po_target_HOSTED && __linux__
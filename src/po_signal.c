@@ -7,8 +7,14 @@
  * that are attached to the signal modulo the table size.
  */
 
+// Internal calls of this module belong to no owner (cf. po_function_OWNERS)
+#define po_function_UNOWNED
+
 #include <portos.h>
 
+/* Dummy handles. They are shared by all instances (cf. po_MULTI_INSTANCE)
+ * since they are only ever rewritten with their own constant values.
+ */
 po_NEARFAR po_signal_DataType po_signal_Data = {
   {NULL, NULL},
 
@@ -19,6 +25,14 @@ po_NEARFAR po_signal_DataType po_signal_Data = {
   po_signal_DUMMY_USIGHANDLE
 };
 
+#if po_MULTI_INSTANCE
+/* Default signal group and default clock (po_time has no source file) of
+ * the instance selected by the current thread
+ */
+po_THREAD_LOCAL po_signal_Group *po_signal_GroupDefaultP;
+po_THREAD_LOCAL po_time_Clock *po_time_ClockDefaultP;
+#endif
+
 /* Schedule a pfunc to be called when some signal is received. The pfunc waits
  * until the signal is posted. If a user handle is supplied by the caller, the
  * handle can be used later to detach the pfunc (cancel), or to check the
@@ -116,14 +130,17 @@ void po_signal_post_(po_priority(group->groupPriority),
   }
 }
 
-/* Detach (cancel) pfunc call specified by the signal handle.
+/* Detach (cancel) pfunc call specified by the signal handle, running at
+ * group priority.
  */
-static void po_signal_detachInt(po_priority(sighandle->u.group->groupPriority),
-				po_signal_HandleInt *sighandle)
+static void po_signal_remove(po_signal_HandleInt *sighandle)
 {
   /* If function nearly called (null pfhandle), don't do anything */
   if ( sighandle->u.service.pfhandle ) {
     /* We got here before po_signal_func, so we succeeded in detaching */
+    #if po_function_OWNERS
+    po_function_untag(sighandle->u.service.pfhandle);
+    #endif
     po_free(sighandle->u.service.pfhandle);
     if ( sighandle->node.prev ) {
       /* The handle was still in database, po_signal_post not yet called */
@@ -137,6 +154,14 @@ static void po_signal_detachInt(po_priority(sighandle->u.group->groupPriority),
   }
 }
 
+/* Detach (cancel) pfunc call specified by the signal handle.
+ */
+static void po_signal_detachInt(po_priority(sighandle->u.group->groupPriority),
+				po_signal_HandleInt *sighandle)
+{
+  po_signal_remove(sighandle);
+}
+
 /*-GLOBAL-
  * Try to detach (cancel) pfunc call specified by the signal handle.
  * This function calls a pfunc which does the real job.
@@ -166,6 +191,20 @@ void po_signal_detach(po_signal_Handle *usighandle)
   }
 }
 
+#if po_function_OWNERS
+/*-GLOBAL-
+ * Cancel method of signal groups (cf. po_function_cancel): detaches the
+ * call right away, the caller running at or above the group priority.
+ */
+void po_signal_cancel(po_signal_HandleInt *sighandle)
+{
+  /* Disconnect from user handle if any, as po_signal_detach does */
+  sighandle->usighandle->sighandle = po_signal_DUMMY_SIGHANDLE;
+  sighandle->usighandle = po_signal_DUMMY_USIGHANDLE;
+  po_signal_remove(sighandle);
+}
+#endif
+
 /*-GLOBAL-
  * Sets the argument used to carry the signal info to a priority function.
  */
@@ -179,11 +218,13 @@ po_signal_HandleInt *po_signal_setsrv(int signal, po_signal_Group *group)
   #endif // DEBUG_MODE
 
   /* Create internal signal handle */
-  sighandle = po_rmalloc_const(sizeof(*sighandle), group->memRegion);
+  sighandle = po_rmalloc_pri(sizeof(*sighandle), group->groupPriority,
+			     group->memRegion);
   if ( !sighandle ) po_memory_error();
 
   sighandle->signal = signal;
   sighandle->usighandle = po_signal_DUMMY_USIGHANDLE;
+  sighandle->node.prev = NULL;  /* not attached yet */
   po_function_setsrv(&sighandle->u.service, (po_function_Service*)group);
   return sighandle;
 }
@@ -0,0 +1,228 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_task.h for a module description.
+ *
+ * The mailboxes and the inbox are rings read by one thread. The writer
+ * publishes a slot by moving its index with release ordering, the reader
+ * frees it the same way, and a semaphore counts the messages so that the
+ * reader can sleep. Posting a semaphore with no sleeper is one atomic
+ * operation.
+ */
+
+#include <po_sys.h>
+#include <po_task.h>
+
+#if po_target_HOSTED
+
+#include <errno.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Inbox of the scheduler thread
+ */
+static struct {
+  int initialized;
+  pthread_mutex_t lock;     /* serializes the tasks' posts */
+  sem_t sem;                /* counts messages */
+  po_task_Ring ring;
+  po_task_Message storage[po_task_INBOX_SIZE];
+} po_task_Inbox = {0, PTHREAD_MUTEX_INITIALIZER};
+
+static void po_task_ringinit(po_task_Ring *ring, po_task_Message *storage, unsigned size)
+{
+  ring->rd = ring->wr = 0;
+  ring->slot = storage;
+  ring->mask = size - 1;
+}
+
+/* Writes a message, returns -1 if the ring is full
+ */
+static int po_task_push(po_task_Ring *ring, po_task_Function func, intptr_t word)
+{
+  unsigned wr = ring->wr;
+  if ( wr - __atomic_load_n(&ring->rd, __ATOMIC_ACQUIRE) > ring->mask ) return -1;
+  ring->slot[wr & ring->mask].func = func;
+  ring->slot[wr & ring->mask].word = word;
+  __atomic_store_n(&ring->wr, wr + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/* Reads a message, returns -1 if the ring is empty
+ */
+static int po_task_pop(po_task_Ring *ring, po_task_Message *message)
+{
+  unsigned rd = ring->rd;
+  if ( rd == __atomic_load_n(&ring->wr, __ATOMIC_ACQUIRE) ) return -1;
+  *message = ring->slot[rd & ring->mask];
+  __atomic_store_n(&ring->rd, rd + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/* Init of the inbox, by the scheduler thread before any task exists
+ */
+static void po_task_inboxinit(void)
+{
+  if ( po_task_Inbox.initialized ) return;
+  sem_init(&po_task_Inbox.sem, 0, 0);
+  po_task_ringinit(&po_task_Inbox.ring, po_task_Inbox.storage, po_task_INBOX_SIZE);
+  po_task_Inbox.initialized = 1;
+}
+
+/* Thread of a task: lowers its OS priority below the scheduler thread's
+ * (cf. po_task.h), then runs its function.
+ */
+static void *po_task_thread(void *arg)
+{
+  po_task_Task *task = (po_task_Task*)arg;
+
+  #ifdef SYS_gettid
+  setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), task->nice);
+  #endif
+
+  task->func(task, task->arg);
+  return NULL;
+}
+
+/*-GLOBAL-
+ * Creates a task running func(task, arg) at a task level, 0 being the
+ * lowest, on a stack of stackSize bytes (0 for the default size). Returns
+ * 0, or -1 if the thread could not be created.
+ */
+int po_task_create(po_task_Task *task, void (*func)(po_task_Task *task, void *arg),
+		   void *arg, int level, size_t stackSize)
+{
+  pthread_attr_t attr;
+  struct sched_param param;
+  int error, nice = 0;
+
+  if ( level < 0 || level >= po_task_NUM_LEVELS ) return -1;
+  po_task_inboxinit();
+
+  // Relative to the scheduler thread, which creates the tasks
+  #ifdef SYS_gettid
+  errno = 0;
+  nice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+  if ( nice == -1 && errno ) nice = 0;
+  #endif
+  nice += po_task_NICE_OFFSET + po_task_NUM_LEVELS - 1 - level;
+
+  task->func = func;
+  task->arg = arg;
+  task->level = level;
+  task->nice = nice < 19 ? nice : 19;
+  task->stop = 0;
+  po_task_ringinit(&task->mailbox, task->storage, po_task_MAILBOX_SIZE);
+  if ( sem_init(&task->sem, 0, 0) ) return -1;
+
+  // Time sharing even if the scheduler thread is real time
+  pthread_attr_init(&attr);
+  param.sched_priority = 0;
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+  pthread_attr_setschedparam(&attr, &param);
+  if ( stackSize ) pthread_attr_setstacksize(&attr, stackSize);
+  error = pthread_create(&task->thread, &attr, po_task_thread, task);
+  pthread_attr_destroy(&attr);
+
+  if ( error ) {
+    sem_destroy(&task->sem);
+    return -1;
+  }
+  return 0;
+}
+
+/*-GLOBAL-
+ * Asks a task to stop and waits for it: po_task_receive returns -1 once
+ * the mailbox is empty.
+ */
+void po_task_stop(po_task_Task *task)
+{
+  task->stop = 1;
+  sem_post(&task->sem);
+  pthread_join(task->thread, NULL);
+  sem_destroy(&task->sem);
+}
+
+/*-GLOBAL-
+ * Sends a message to a task, from the scheduler thread. Returns 0, or -1
+ * if the mailbox is full.
+ */
+int po_task_send(po_task_Task *task, po_task_Function func, intptr_t word)
+{
+  if ( po_task_push(&task->mailbox, func, word) ) return -1;
+  sem_post(&task->sem);
+  return 0;
+}
+
+/*-GLOBAL-
+ * Waits for the next message of the calling task. Returns 0, or -1 if the
+ * task is stopped.
+ */
+int po_task_receive(po_task_Task *task, po_task_Message *message)
+{
+  while ( 1 ) {
+    while ( sem_wait(&task->sem) )
+      ; // Interrupted by a signal
+    if ( po_task_pop(&task->mailbox, message) == 0 ) return 0;
+    // Woken by po_task_stop
+    if ( task->stop ) return -1;
+  }
+}
+
+/*-GLOBAL-
+ * Main function of a task that runs the messages it receives until it is
+ * stopped.
+ */
+void po_task_serve(po_task_Task *task, void *unused)
+{
+  po_task_Message message;
+  while ( po_task_receive(task, &message) == 0 )
+    message.func(message.word);
+}
+
+/*-GLOBAL-
+ * Posts a message to the scheduler thread, from a task. Returns 0, or -1
+ * if the inbox is full.
+ */
+int po_task_post(po_task_Function func, intptr_t word)
+{
+  int error;
+  pthread_mutex_lock(&po_task_Inbox.lock);
+  error = po_task_push(&po_task_Inbox.ring, func, word);
+  pthread_mutex_unlock(&po_task_Inbox.lock);
+  if ( !error ) sem_post(&po_task_Inbox.sem);
+  return error;
+}
+
+/*-GLOBAL-
+ * Runs the messages posted by tasks, from the scheduler thread while no
+ * priority function runs. If wait is non-zero and there are none, waits
+ * for one. Returns the number of messages run.
+ */
+int po_task_dispatch(int wait)
+{
+  po_task_Message message;
+  int n = 0;
+
+  po_task_inboxinit();
+  if ( wait ) {
+    while ( sem_wait(&po_task_Inbox.sem) )
+      ; // Interrupted by a signal
+  } else if ( sem_trywait(&po_task_Inbox.sem) ) {
+    return 0;
+  }
+
+  // One message per count of the semaphore
+  do {
+    if ( po_task_pop(&po_task_Inbox.ring, &message) ) break;
+    message.func(message.word);
+    n++;
+  } while ( sem_trywait(&po_task_Inbox.sem) == 0 );
+  return n;
+}
+
+#endif // po_target_HOSTED
@@ -37,6 +37,13 @@ void po_target_error(int error)
   po_abort();
 }
 
+/*-GLOBAL-
+ * Compiler barrier (an opaque call)
+ */
+void po_target_barrier(void)
+{
+}
+
 /* SWI start function
  */
 static void po_target_dspbios_swi(void)
@@ -0,0 +1,200 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Cf. po_target_linux.h for a module description.
+ *
+ * The interrupt state is only changed by the Portos thread and by the
+ * signal handlers that interrupt it, so the bits are set and cleared with
+ * atomic instructions but need no lock. A handler about to run the handler
+ * of a signal checks the pending bit again after clearing its running bit:
+ * the same signal arriving in between either sees the running bit and
+ * leaves itself pending, or runs its handler itself.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // gettid
+#endif
+#include <po_sys.h>
+#include <po_function.h>
+
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+/* Interrupt state of the Portos thread
+ */
+po_THREAD_LOCAL po_target_IrqState po_target_Irq;
+
+/* Bound handlers, Portos thread and periodic timers
+ */
+static struct {
+  void (*handler[po_target_NUM_SIGNALS])(int signo);
+  pthread_t thread;
+  pid_t tid;
+  timer_t timer[po_target_NUM_SIGNALS];
+  unsigned char timerSet[po_target_NUM_SIGNALS];
+  unsigned long freq;
+} po_target_Data;
+
+/* Runs the handler of a signal unless interrupts are disabled or it is
+ * already running, in which case it is left pending
+ */
+static void po_target_irqrun(int signo)
+{
+  uint64_t bit = (uint64_t)1 << signo;
+
+  while ( 1 ) {
+    if ( po_target_Irq.disabled || (po_target_Irq.running & bit) ) {
+      __atomic_fetch_or(&po_target_Irq.pending, bit, __ATOMIC_RELAXED);
+      return;
+    }
+    __atomic_fetch_or(&po_target_Irq.running, bit, __ATOMIC_RELAXED);
+    __atomic_fetch_and(&po_target_Irq.pending, ~bit, __ATOMIC_RELAXED);
+    po_target_barrier();
+
+    po_interrupt_enter();
+    po_target_Data.handler[signo](signo);
+    po_interrupt_exit();
+
+    po_target_barrier();
+    __atomic_fetch_and(&po_target_Irq.running, ~bit, __ATOMIC_RELAXED);
+    if ( !(po_target_Irq.pending & bit) ) return;
+  }
+}
+
+/* Signal handler of the bound signals
+ */
+static void po_target_signal(int signo)
+{
+  int savedErrno = errno;
+  po_target_irqrun(signo);
+  errno = savedErrno;
+}
+
+/* Runs the handlers of the pending signals
+ */
+void po_target_irqreplay(void)
+{
+  uint64_t ready;
+
+  while ( !po_target_Irq.disabled &&
+	  (ready = po_target_Irq.pending & ~po_target_Irq.running) != 0 )
+    po_target_irqrun(__builtin_ctzll(ready));
+}
+
+/*-GLOBAL-
+ * Target init, by the Portos thread
+ */
+void po_target_init(void)
+{
+  po_target_Data.thread = pthread_self();
+  po_target_Data.tid = (pid_t)syscall(SYS_gettid);
+}
+
+/*-GLOBAL-
+ * Binds a signal to an interrupt handler of the Portos thread, or unbinds
+ * it if handler is NULL. Returns 0, or -1 if the signal cannot be bound.
+ */
+int po_target_bind(int signo, void (*handler)(int signo))
+{
+  struct sigaction action;
+
+  if ( signo <= 0 || signo >= po_target_NUM_SIGNALS ) return -1;
+
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  if ( handler ) {
+    // Not deferred by the kernel: po_target_irqrun defers it
+    action.sa_handler = po_target_signal;
+    action.sa_flags = SA_RESTART | SA_NODEFER;
+  } else {
+    action.sa_handler = SIG_DFL;
+  }
+  po_target_Data.handler[signo] = handler;
+  return sigaction(signo, &action, NULL) ? -1 : 0;
+}
+
+/*-GLOBAL-
+ * Sends a bound signal to the Portos thread, from any thread. Returns 0,
+ * or -1 on failure.
+ */
+int po_target_raise(int signo)
+{
+  return pthread_kill(po_target_Data.thread, signo) ? -1 : 0;
+}
+
+/*-GLOBAL-
+ * Starts a timer sending a bound signal to the Portos thread every period
+ * nanoseconds. Returns 0, or -1 on failure.
+ */
+int po_target_timerstart(int signo, long period)
+{
+  struct sigevent event;
+  struct itimerspec spec;
+
+  if ( signo <= 0 || signo >= po_target_NUM_SIGNALS ||
+       po_target_Data.timerSet[signo] )
+    return -1;
+
+  memset(&event, 0, sizeof(event));
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = signo;
+  event.sigev_notify_thread_id = po_target_Data.tid;
+  if ( timer_create(CLOCK_MONOTONIC, &event, &po_target_Data.timer[signo]) )
+    return -1;
+
+  spec.it_interval.tv_sec = spec.it_value.tv_sec = period / 1000000000L;
+  spec.it_interval.tv_nsec = spec.it_value.tv_nsec = period % 1000000000L;
+  if ( timer_settime(po_target_Data.timer[signo], 0, &spec, NULL) ) {
+    timer_delete(po_target_Data.timer[signo]);
+    return -1;
+  }
+  po_target_Data.timerSet[signo] = 1;
+  return 0;
+}
+
+/*-GLOBAL-
+ * Stops the timer of a signal.
+ */
+void po_target_timerstop(int signo)
+{
+  if ( signo <= 0 || signo >= po_target_NUM_SIGNALS ||
+       !po_target_Data.timerSet[signo] )
+    return;
+  timer_delete(po_target_Data.timer[signo]);
+  po_target_Data.timerSet[signo] = 0;
+}
+
+/*-GLOBAL-
+ * Frequency of po_target_timestamp, in units per second. Measured at the
+ * first call, which takes about 10 ms.
+ */
+unsigned long po_target_timestampfreq(void)
+{
+  #if defined(__x86_64__) || defined(__i386__)
+  if ( !po_target_Data.freq ) {
+    struct timespec t0, t1, delay = {0, 10000000};
+    unsigned long c0, c1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    c0 = po_target_timestamp();
+    nanosleep(&delay, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    c1 = po_target_timestamp();
+    po_target_Data.freq = (unsigned long)
+      ((double)(c1 - c0) * 1e9 /
+       ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)));
+  }
+  #elif defined(__aarch64__)
+  if ( !po_target_Data.freq )
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(po_target_Data.freq));
+  #else
+  po_target_Data.freq = 1000000000UL;
+  #endif
+  return po_target_Data.freq;
+}
@@ -0,0 +1,110 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_checkpoint module.
+ */
+
+#include <portos.h>
+
+#if po_target_HOSTED
+
+int po_init_checkpoint(void);
+
+/* Data pointing into itself, past its end and into the image
+ */
+typedef struct _CheckData {
+  struct _CheckData *self;
+  char *inside;
+  char *past;
+  void (*func)(void);
+  int value;
+  char text[12];
+} CheckData;
+
+static CheckData CheckA, CheckB;
+static int CheckSum = 0;
+static int CheckRunning = 0;
+
+static void checkfunc(void)
+{
+}
+
+static void checktimer(po_priority(3), int k)
+{
+  CheckSum += k;
+}
+
+static void checkinside(po_priority(2), int unused)
+{
+  CheckRunning = po_checkpoint_save(stdout);
+}
+
+/* Test checkpoint and restore
+ */
+int test_checkpoint(void)
+{
+  FILE *file = tmpfile();
+  int i, time, errors = 0;
+
+  po_log("\nTESTING checkpoint and restore\n", 0, 0);
+
+  // Restore into another range
+  CheckA.self = &CheckA;
+  CheckA.inside = &CheckA.text[3];
+  CheckA.past = (char*)(&CheckA + 1);
+  CheckA.func = checkfunc;
+  CheckA.value = 1234;
+  strcpy(CheckA.text, "relocated");
+
+  po_checkpoint_reset();
+  po_checkpoint_add(&CheckA, sizeof(CheckA));
+  errors += po_checkpoint_save(file) != 0;
+  po_checkpoint_reset();
+  po_checkpoint_add(&CheckB, sizeof(CheckB));
+  rewind(file);
+  errors += po_checkpoint_restore(file) != 0;
+  errors += CheckB.self != &CheckB || CheckB.inside != &CheckB.text[3];
+  errors += CheckB.past != (char*)(&CheckB + 1) || CheckB.func != checkfunc;
+  errors += CheckB.value != 1234 || strcmp(CheckB.text, "relocated");
+
+  // Sizes must match
+  po_checkpoint_reset();
+  po_checkpoint_add(&CheckB, sizeof(CheckB) - sizeof(int));
+  rewind(file);
+  errors += po_checkpoint_restore(file) != -1;
+  fclose(file);
+
+  // Not while a priority function runs
+  checkinside(po_priority, 0);
+  errors += CheckRunning != -1;
+
+  // Timers armed before the checkpoint run again after restore
+  file = tmpfile();
+  errors += po_init_checkpoint() != 0;
+  time = po_time_get(&po_time_ClockDefault);
+  for ( i = 1 ; i <= 5 ; i++ )
+    checktimer(po_time(time + i), i);
+  errors += po_checkpoint_save(file) != 0;
+
+  for ( i = 0 ; i < 5 ; i++ ) po_time_tick(&po_time_ClockDefault);
+  errors += CheckSum != 15;
+
+  rewind(file);
+  errors += po_checkpoint_restore(file) != 0;
+  errors += po_time_get(&po_time_ClockDefault) != time;
+  for ( i = 0 ; i < 5 ; i++ ) po_time_tick(&po_time_ClockDefault);
+  errors += CheckSum != 30;
+  fclose(file);
+  po_checkpoint_reset();
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: checkpoint, %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: checkpoint\n", 0, 0);
+    return 0;
+  }
+}
+
+#endif // po_target_HOSTED
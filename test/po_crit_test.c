@@ -0,0 +1,95 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_crit module.
+ */
+
+#include <portos.h>
+
+#if po_crit_STATS
+
+enum {
+  CRIT_LONG = 1000000,  // timestamp units of the long window
+  CRIT_SHORT = 100      // short windows
+};
+
+/* Spins for a number of timestamp units
+ */
+static void critspin(unsigned long units)
+{
+  unsigned long start = po_target_timestamp();
+  while ( po_target_timestamp() - start < units )
+    ;
+}
+
+/* Test critical section lengths
+ */
+int test_crit(void)
+{
+  static po_crit_Site sites[po_crit_MAX_SITES];
+  static char text[4096];
+  po_crit_Stats stats;
+  char label[32];
+  FILE *file;
+  size_t n;
+  int longLine, innerLine, shortLine, i, nSites, memory = 0, errors = 0;
+  int s1, s2;
+
+  po_log("\nTESTING critical section lengths\n", 0, 0);
+
+  po_crit_reset();
+
+  // A long window, with a nested pair that is part of it
+  longLine = __LINE__; s1 = po_interrupt_disable();
+  innerLine = __LINE__; s2 = po_interrupt_disable();
+  po_interrupt_restore(s2);
+  critspin(CRIT_LONG);
+  po_interrupt_restore(s1);
+
+  // Short windows at one site
+  for ( i = 0 ; i < CRIT_SHORT ; i++ ) {
+    shortLine = __LINE__; s1 = po_interrupt_disable();
+    po_interrupt_restore(s1);
+  }
+
+  // Windows of the library
+  po_free(po_malloc(16));
+
+  po_crit_getstats(&stats);
+  errors += stats.nWindows < CRIT_SHORT + 2 || stats.max < CRIT_LONG;
+  errors += stats.nDropped != 0;
+
+  nSites = po_crit_top(sites, po_crit_MAX_SITES);
+  errors += nSites != stats.nSites;
+  errors += nSites < 3 || sites[0].line != longLine || sites[0].count != 1 ||
+    sites[0].max < CRIT_LONG || !strstr(sites[0].file, "po_crit_test");
+  for ( i = 0 ; i < nSites ; i++ ) {
+    if ( i > 0 && sites[i].max > sites[i-1].max ) errors++;
+    if ( sites[i].line == innerLine ) errors++;
+    if ( sites[i].line == shortLine )
+      errors += sites[i].count != CRIT_SHORT || sites[i].max >= CRIT_LONG;
+    if ( strstr(sites[i].file, "po_memory") ) memory++;
+  }
+  errors += memory == 0;
+
+  file = tmpfile();
+  po_crit_write(file, 8);
+  rewind(file);
+  n = fread(text, 1, sizeof(text) - 1, file);
+  text[n] = 0;
+  fclose(file);
+  sprintf(label, "\npo_crit_test.c:%d ", longLine);
+  errors += strstr(text, label) == NULL;
+  po_log("%s", (po_log_Word)text, 0);
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: critical section lengths, %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: %lu windows at %d sites\n", stats.nWindows, stats.nSites);
+    return 0;
+  }
+}
+
+#endif // po_crit_STATS
@@ -0,0 +1,177 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_dma module.
+ */
+
+#include <time.h>
+#include <portos.h>
+
+#if po_target_HOSTED
+
+enum {
+  DMA_CHAINED = 1000,         // transfers submitted by completions
+  DMA_BIG = 1 << 20,          // bytes of the timed transfer
+  DMA_BANDWIDTH = 200000000,  // bytes per second of the timed engine
+  DMA_LATENCY = 100000        // nanoseconds
+};
+
+static po_inbox_Inbox DmaInbox;
+static po_dma_Engine DmaEngine;
+static po_dma_Channel DmaIn, DmaOut;
+static char DmaSrc[4096], DmaDst[4096];
+static char DmaBig[2][DMA_BIG];
+static int DmaErrors, DmaDone, DmaLast = -1, DmaLevel;
+static size_t DmaBytes;
+
+static unsigned long long dmanow(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (unsigned long long)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/* Runs the completions until count of them are done
+ */
+static void dmawait(int count)
+{
+  int i;
+  for ( i = 0 ; DmaDone < count && i < 10000 ; i++ )
+    po_inbox_wait(&DmaInbox, 1000);
+}
+
+static void dmadone(void *arg, size_t bytes)
+{
+  DmaLevel = po_function_getpri();
+  DmaBytes = bytes;
+  DmaDone++;
+}
+
+/* In order within a channel
+ */
+static void dmaorder(void *arg, size_t bytes)
+{
+  int seq = (int)(intptr_t)arg;
+  if ( seq != DmaLast + 1 ) DmaErrors++;
+  DmaLast = seq;
+  DmaDone++;
+}
+
+/* Submits the next transfer from the completion of the previous one
+ */
+static void dmachain(void *arg, size_t bytes)
+{
+  int seq = (int)(intptr_t)arg;
+  if ( DmaDst[seq % sizeof(DmaDst)] != DmaSrc[seq % sizeof(DmaSrc)] )
+    DmaErrors++;
+  DmaDone++;
+  if ( seq + 1 < DMA_CHAINED &&
+       po_dma_copy(&DmaOut, &DmaDst[(seq + 1) % sizeof(DmaDst)],
+		   &DmaSrc[(seq + 1) % sizeof(DmaSrc)], 1, dmachain,
+		   (void*)(intptr_t)(seq + 1), 4) )
+    DmaErrors++;
+}
+
+/* Test emulated DMA
+ */
+int test_dma(void)
+{
+  unsigned long long start, elapsed, expected, queued;
+  int i, errors = 0;
+
+  po_log("\nTESTING emulated DMA\n", 0, 0);
+
+  for ( i = 0 ; i < (int)sizeof(DmaSrc) ; i++ )
+    DmaSrc[i] = (char)(i * 7 + 1);
+  errors += po_inbox_init(&DmaInbox) != 0;
+  errors += po_dma_init(&DmaEngine, &DmaInbox, 0, 0) != 0;
+  po_dma_chinit(&DmaIn, &DmaEngine);
+  po_dma_chinit(&DmaOut, &DmaEngine);
+
+  // Gather three pieces, completing at level 3
+  errors += po_dma_submit(&DmaIn, dmadone, NULL, 3) != -1;
+  po_dma_add(&DmaIn, DmaDst, DmaSrc + 100, 10);
+  po_dma_add(&DmaIn, DmaDst + 10, DmaSrc + 1000, 20);
+  po_dma_add(&DmaIn, DmaDst + 30, DmaSrc, 5);
+  errors += po_dma_submit(&DmaIn, dmadone, NULL, 3) != 0;
+  dmawait(1);
+  errors += DmaDone != 1 || DmaLevel != 3 || DmaBytes != 35;
+  errors += memcmp(DmaDst, DmaSrc + 100, 10) != 0 ||
+    memcmp(DmaDst + 10, DmaSrc + 1000, 20) != 0 ||
+    memcmp(DmaDst + 30, DmaSrc, 5) != 0;
+
+  // Ring full, then dropped
+  for ( i = 0 ; i < po_dma_RING_SIZE ; i++ )
+    errors += po_dma_add(&DmaIn, DmaDst, DmaSrc, 1) != 0;
+  errors += po_dma_add(&DmaIn, DmaDst, DmaSrc, 1) != -1;
+  po_dma_abort(&DmaIn);
+  errors += po_dma_submit(&DmaIn, dmadone, NULL, 3) != -1;
+
+  // In order, with the ring wrapping around
+  DmaDone = 0;
+  for ( i = 0 ; i < 3 * po_dma_RING_SIZE ; i++ ) {
+    while ( po_dma_copy(&DmaIn, DmaDst + i, DmaSrc + i, 1, dmaorder,
+			(void*)(intptr_t)i, 2) )
+      po_inbox_wait(&DmaInbox, 1000); // Ring full
+  }
+  dmawait(3 * po_dma_RING_SIZE);
+  errors += DmaLast != 3 * po_dma_RING_SIZE - 1;
+
+  // Completions submitting the next transfer
+  DmaDone = 0;
+  memset(DmaDst, 0, sizeof(DmaDst));
+  errors += po_dma_copy(&DmaOut, DmaDst, DmaSrc, 1, dmachain, (void*)0, 4);
+  dmawait(DMA_CHAINED);
+  errors += DmaDone != DMA_CHAINED;
+  po_dma_stop(&DmaEngine);
+
+  // Bandwidth and latency
+  errors += po_dma_init(&DmaEngine, &DmaInbox, DMA_BANDWIDTH, DMA_LATENCY);
+  po_dma_chinit(&DmaIn, &DmaEngine);
+  DmaDone = 0;
+  memset(DmaBig[0], 0x5a, DMA_BIG);
+  start = dmanow();
+  po_dma_copy(&DmaIn, DmaBig[1], DmaBig[0], DMA_BIG, dmadone, NULL, 1);
+  dmawait(1);
+  elapsed = dmanow() - start;
+  po_dma_stop(&DmaEngine);
+  expected = DMA_LATENCY + (unsigned long long)DMA_BIG * 1000000000ULL /
+    DMA_BANDWIDTH;
+  errors += elapsed < expected || DmaEngine.busy != expected;
+  errors += memcmp(DmaBig[0], DmaBig[1], DMA_BIG) != 0;
+
+  // Back to back, the engine sleeping too long is paid back
+  errors += po_dma_init(&DmaEngine, &DmaInbox, DMA_BANDWIDTH, DMA_LATENCY);
+  po_dma_chinit(&DmaIn, &DmaEngine);
+  DmaDone = 0;
+  start = dmanow();
+  for ( i = 0 ; i < po_dma_RING_SIZE ; i++ )
+    po_dma_copy(&DmaIn, DmaBig[1] + i * (DMA_BIG / po_dma_RING_SIZE),
+		DmaBig[0] + i * (DMA_BIG / po_dma_RING_SIZE),
+		DMA_BIG / po_dma_RING_SIZE, dmadone, NULL, 1);
+  dmawait(po_dma_RING_SIZE);
+  queued = dmanow() - start;
+  po_dma_stop(&DmaEngine);
+  errors += DmaDone != po_dma_RING_SIZE || DmaEngine.busy !=
+    po_dma_RING_SIZE * (DMA_LATENCY + (unsigned long long)DMA_BIG /
+			po_dma_RING_SIZE * 1000000000ULL / DMA_BANDWIDTH);
+  errors += queued < DmaEngine.busy;
+
+  errors += DmaErrors;
+  po_inbox_close(&DmaInbox);
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: emulated DMA, %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: %ld us for %d bytes", (long)(elapsed / 1000), DMA_BIG);
+    po_log(" (%ld us expected)\n", (long)(expected / 1000), 0);
+    po_log("         %ld us for %d transfers back to back",
+	   (long)(queued / 1000), po_dma_RING_SIZE);
+    po_log(" (%ld us expected)\n", (long)(DmaEngine.busy / 1000), 0);
+    return 0;
+  }
+}
+
+#endif // po_target_HOSTED
@@ -0,0 +1,92 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_fiber module.
+ */
+
+#include <string.h>
+#include <portos.h>
+
+#if po_target_HOSTED
+
+enum { FIBER_STACK = 8192 };
+
+static char FibOrder[64];
+static int FibCount = 0;
+static po_fiber_Fiber *FibSelf[3];
+static po_queue_Queue FibQueue;
+
+static void fibmark(char id, char step)
+{
+  if ( FibCount < (int)sizeof(FibOrder) - 2 ) {
+    FibOrder[FibCount++] = id;
+    FibOrder[FibCount++] = step;
+  }
+}
+
+/* Uses some of the fiber's stack
+ */
+static int fibdeep(int depth)
+{
+  volatile char frame[1024];
+  memset((char*)frame, depth, sizeof(frame));
+  return depth ? frame[depth] + fibdeep(depth - 1) : 0;
+}
+
+/* Legacy style code: blocks at the same level, on a queue with one server
+ * (held across a timer) and on a timer.
+ */
+static void fibbody(void *arg)
+{
+  char id = *(char*)arg;
+  FibSelf[id - 'a'] = po_fiber_self();
+
+  fibmark(id, '0');
+  po_fiber_wait(po_priority);
+  fibmark(id, '1');
+  po_fiber_wait(po_queue(&FibQueue));
+  fibmark(id, '2');
+  po_fiber_wait(po_time(po_time_get(&po_time_ClockDefault) + 1));
+  fibmark(id, fibdeep(4) == 10 ? '3' : 'x');
+  po_queue_next(&FibQueue);
+}
+
+static void fibstart(po_priority(3), const char *ids)
+{
+  for ( ; *ids ; ids++ )
+    po_fiber_start(fibbody, (void*)ids, FIBER_STACK, &po_memory_RegionDefault);
+}
+
+/* Test fibers
+ */
+int test_fiber(void)
+{
+  int errors = 0;
+
+  po_log("\nTESTING fibers\n", 0, 0);
+
+  po_queue_init(&FibQueue, 1, &po_memory_RegionDefault);
+
+  fibstart(po_priority, "ab");
+  po_time_tick(&po_time_ClockDefault);
+  po_time_tick(&po_time_ClockDefault);
+  FibOrder[FibCount] = 0;
+  errors += strcmp(FibOrder, "a0b0a1b1a2a3b2b3") != 0;
+  errors += po_fiber_self() != NULL;
+
+  // The stack of the last fiber that ended is reused
+  fibstart(po_priority, "c");
+  po_time_tick(&po_time_ClockDefault);
+  errors += FibSelf[2] != FibSelf[1];
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: fibers ran %s\n", (po_log_Word)FibOrder, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: fibers ran %s\n", (po_log_Word)FibOrder, 0);
+    return 0;
+  }
+}
+
+#endif // po_target_HOSTED
@@ -5,10 +5,13 @@
  * Test for po_function module.
  */
 
+#include <string.h>
 #include <po_sys.h>
 #include <po_memory.h>
 #include <po_function.h>
 #include <po_prep.h>
+#include <po_irq.h>
+#include <po_replay.h>
 #include <po_display.h>
 #include <miscLib.h>
 
@@ -30,6 +33,7 @@ static int TotalCalls = 20000;
 static int NCalls = 0;
 static int Done = 0;
 static int EnableHwi = 0;
+static int ReplayHwi = 0;
 
 /* Total number of errors encountered
  */
@@ -99,7 +103,7 @@ static void scheduledDisplay(char last, int id)
     }
   }
   po_log(" %c%c", id + 'a', last);
-  po_log("0x%x\n", (int)po_function_Env.bitmap, 0);
+  po_log("0x%lx\n", (po_log_Word)po_function_Env.bitmap, 0);
   po_interrupt_restore(protectState);
   #endif
 }
@@ -121,12 +125,14 @@ static void myfunc(po_priority(desiredpri),
 		   int callerpri, int desiredpri, int label, int id_caller, int line);
 
 void generateHWI(int prob);
+static void replaydecide(void);
 
 /* Emulate HWI from po_function module
  */
 void po_emulateirupt_(void)
 {
-  generateHWI(1);
+  if ( ReplayHwi ) replaydecide();
+  else generateHWI(1);
 }
 
 /* Interrupt handler
@@ -351,3 +357,367 @@ int test_randomPfunc(void)
     return 0;
   }
 }
+
+#if po_function_FAIR_SOURCES
+
+/* Order in which the sources of a fair level were served
+ */
+static char FairOrder[32];
+static int FairCount = 0;
+static po_function_Fair FairLevel;
+
+static void fairfunc(po_priority(1), int source)
+{
+  FairOrder[FairCount++] = '0' + source;
+}
+
+/* Floods the fair level from 3 sources, source 0 being the chattiest.
+ */
+static void fairburst(po_priority(2), int unused)
+{
+  int i, prevsource;
+
+  prevsource = po_function_setsource(0);
+  for ( i = 0 ; i < 6 ; i++ ) fairfunc(po_priority, 0);
+  po_function_setsource(1);
+  for ( i = 0 ; i < 6 ; i++ ) fairfunc(po_priority, 1);
+  po_function_setsource(2);
+  for ( i = 0 ; i < 3 ; i++ ) fairfunc(po_priority, 2);
+  po_function_setsource(prevsource);
+}
+
+/* Test deficit round robin on a fair level: source 1 has weight 2.
+ */
+int test_fairPfunc(void)
+{
+  const char *expected = "011201120112000";
+  int i, errors = 0;
+
+  po_log("\nTESTING fair priority level\n", 0, 0);
+
+  po_function_fairinit(1, &FairLevel);
+  po_function_fairweight(1, 1, 2);
+  fairburst(po_priority, 0);
+  po_function_fairinit(1, NULL);
+
+  FairOrder[FairCount] = 0;
+  for ( i = 0 ; i <= FairCount ; i++ ) errors += (FairOrder[i] != expected[i]);
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: fair level served %s\n", (po_log_Word)FairOrder, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: fair level served %s\n", (po_log_Word)FairOrder, 0);
+    return 0;
+  }
+}
+
+#endif // po_function_FAIR_SOURCES
+
+#if po_function_LEVEL_LIMITS
+
+/* Order in which the calls of a limited level were run
+ */
+static char LimitOrder[16];
+static int LimitCount = 0;
+
+static void limitfunc(po_priority(1), int id)
+{
+  LimitOrder[LimitCount++] = '0' + id;
+}
+
+static void limitfunc2(po_priority(1), int id)
+{
+  LimitOrder[LimitCount++] = '0' + id;
+}
+
+/* Posts 5 calls to a level limited to 3 waiting calls. In merge mode,
+ * the calls alternate between 2 functions.
+ */
+static void limitburst(po_priority(2), int policy)
+{
+  int i;
+  for ( i = 0 ; i < 5 ; i++ ) {
+    if ( policy == po_function_LIMIT_MERGE && (i & 1) )
+      limitfunc2(po_priority, i);
+    else
+      limitfunc(po_priority, i);
+  }
+}
+
+/* Calls discarded, as told to the overflow hook
+ */
+static int LimitRejected, LimitDiscarded, LimitHookErrors;
+
+static void limithook(int priority, po_function_Handle *pfhandle, int rejected)
+{
+  if ( priority != 1 || !pfhandle ) LimitHookErrors++;
+  #if po_function_TRACK_NAME
+  if ( strncmp((const char*)pfhandle->name, "limitfunc", 9) ) LimitHookErrors++;
+  #endif
+  if ( rejected ) LimitRejected++;
+  else LimitDiscarded++;
+}
+
+/* Runs a burst with a policy and checks the calls that ran, the counters
+ * and the calls told to the overflow hook.
+ */
+static int limitcheck(int policy, const char *expected, int discarded)
+{
+  po_function_Limit before, after;
+  po_function_OverflowHook prev;
+  int i, errors = 0;
+
+  LimitCount = LimitRejected = LimitDiscarded = LimitHookErrors = 0;
+  prev = po_function_setoverflowhook(limithook);
+  po_function_setlimit(1, 3, policy);
+  po_function_getlimit(1, &before); // Also resets the peak depth
+  limitburst(po_priority, policy);
+  po_function_getlimit(1, &after);
+  po_function_setlimit(1, 0, po_function_LIMIT_REJECT);
+  errors += po_function_setoverflowhook(prev) != limithook || prev != NULL;
+
+  LimitOrder[LimitCount] = 0;
+  for ( i = 0 ; i <= LimitCount ; i++ ) errors += (LimitOrder[i] != expected[i]);
+  errors += after.peakPending != 3;
+  errors += after.nRejected - before.nRejected + after.nDropped - before.nDropped
+    + after.nMerged - before.nMerged != (unsigned long)discarded;
+  errors += LimitRejected != (int)(after.nRejected - before.nRejected);
+  errors += LimitRejected + LimitDiscarded != discarded || LimitHookErrors;
+  if ( policy == po_function_LIMIT_REJECT ) errors += LimitRejected != 2;
+  if ( errors > 0 )
+    po_log("ERROR: policy %d ran %s\n", policy, (po_log_Word)LimitOrder);
+  return errors;
+}
+
+/* Test the overflow policies of a limited level.
+ */
+int test_levelLimits(void)
+{
+  int errors = 0;
+
+  po_log("\nTESTING priority level limits\n", 0, 0);
+
+  errors += limitcheck(po_function_LIMIT_REJECT, "012", 2);
+  errors += limitcheck(po_function_LIMIT_DROP_OLDEST, "234", 2);
+  errors += limitcheck(po_function_LIMIT_MERGE, "432", 2);
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: there were %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: level limits\n", 0, 0);
+    return 0;
+  }
+}
+
+#endif // po_function_LEVEL_LIMITS
+
+#if po_irq_NUM_SOURCES
+
+/* Number of calls per interrupt source, and the level they ran at
+ */
+static int IrqCalls[2];
+static int IrqPriority[2];
+
+static void irqfunc(void *arg)
+{
+  int *id = arg;
+  IrqCalls[*id]++;
+  IrqPriority[*id] = po_function_getpri();
+}
+
+/* Raises the sources from an emulated interrupt handler, one of them twice,
+ * while a higher level runs.
+ */
+static void irqburst(po_priority(10), int unused)
+{
+  po_interrupt_enter();
+  po_irq_raise(3);
+  po_irq_raise(1);
+  po_irq_raise(3);
+  po_interrupt_exit();
+}
+
+/* Test the dispatch of interrupt sources bound to functions.
+ */
+int test_irqDispatch(void)
+{
+  static int ids[2] = {0, 1};
+  int errors = 0;
+
+  po_log("\nTESTING interrupt source dispatch\n", 0, 0);
+
+  po_irq_bind(3, 5, irqfunc, &ids[0]);
+  po_irq_bind(1, 12, irqfunc, &ids[1]);
+  irqburst(po_priority, 0);
+  po_irq_unbind(3);
+  po_irq_unbind(1);
+
+  errors += IrqCalls[0] != 1 || IrqPriority[0] != 5;
+  errors += IrqCalls[1] != 1 || IrqPriority[1] != 12;
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: sources called %d and %d times\n", IrqCalls[0], IrqCalls[1]);
+    return -1;
+  } else {
+    po_log("SUCCESS: interrupt sources dispatched\n", 0, 0);
+    return 0;
+  }
+}
+
+#endif // po_irq_NUM_SOURCES
+
+#if po_function_CHAIN
+
+enum { eCHAIN_CALLS = 4 };
+
+/* Order of the calls, handle of each call of chainfunc, and whether a
+ * call posted by it at its level would be chained
+ */
+static char ChainOrder[16];
+static int ChainCount = 0;
+static po_function_Handle *ChainHandle[eCHAIN_CALLS];
+static int ChainTail[eCHAIN_CALLS];
+
+static void chainother(po_priority(4), int unused)
+{
+  ChainOrder[ChainCount++] = 'x';
+}
+
+/* Posts itself at its level, and the first call also another function
+ * after it
+ */
+static void chainfunc(po_priority(4), int n)
+{
+  ChainOrder[ChainCount++] = 'a' + n;
+  ChainHandle[n] = po_function_Env.list[4].tail;
+  ChainTail[n] = po_function_chaintail(4) != NULL;
+  if ( n + 1 < eCHAIN_CALLS ) chainfunc(po_priority, n + 1);
+  if ( n == 0 ) chainother(po_priority, 0);
+}
+
+static void chainstart(po_priority(5), int unused)
+{
+  chainfunc(po_priority, 0);
+}
+
+/* Test chaining of the calls posted at their own level: a is the last of
+ * its batch and chains b in its own block, then x waits in the list. b
+ * cannot chain c ahead of x, so c runs after x in a new block and chains d.
+ */
+int test_chain(void)
+{
+  int blocks = po_memory_display(&po_memory_RegionSystem), errors = 0;
+
+  po_log("\nTESTING chaining of same level calls\n", 0, 0);
+
+  chainstart(po_priority, 0);
+  ChainOrder[ChainCount] = 0;
+
+  errors += strcmp(ChainOrder, "abxcd") != 0;
+  errors += !ChainTail[0] || ChainTail[1] || !ChainTail[2] || !ChainTail[3];
+  errors += ChainHandle[1] != ChainHandle[0] || ChainHandle[3] != ChainHandle[2];
+  errors += ChainHandle[2] == ChainHandle[1];
+  errors += po_memory_display(&po_memory_RegionSystem) != blocks;
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: chained calls %s, %d errors\n", (po_log_Word)ChainOrder,
+	   errors);
+    return -1;
+  } else {
+    po_log("SUCCESS: chained calls %s\n", (po_log_Word)ChainOrder, 0);
+    return 0;
+  }
+}
+
+#endif // po_function_CHAIN
+
+/* Order in which the calls of the replay test were run: lower case for
+ * priority functions, upper case for interrupts
+ */
+static char ReplayOrder[1024];
+static int ReplayCount = 0;
+static int ReplayInterrupts = 0;
+static unsigned ReplaySeed;
+
+static void replayfunc(po_priority(priority), int priority, int depth)
+{
+  if ( ReplayCount < (int)sizeof(ReplayOrder) - 1 )
+    ReplayOrder[ReplayCount++] = 'a' + priority;
+  if ( depth > 0 ) {
+    replayfunc(po_priority, (priority * 7 + 3) % 10, depth - 1);
+    replayfunc(po_priority, (priority * 3 + 1) % 10, depth - 1);
+  }
+}
+
+/* Emulated interrupt handler
+ */
+static void replayhwi(int work)
+{
+  po_interrupt_enter();
+  ReplayInterrupts++;
+  if ( ReplayCount < (int)sizeof(ReplayOrder) - 1 )
+    ReplayOrder[ReplayCount++] = 'A' + work;
+  replayfunc(po_priority, work, 1);
+  po_interrupt_exit();
+}
+
+/* Decides at random whether an interrupt occurs at an emulation point,
+ * with a generator of its own (the source of nondeterminism). The number
+ * of interrupts is bounded since each one adds calls, hence points.
+ */
+static void replaydecide(void)
+{
+  ReplaySeed = ReplaySeed * 69069 + 1;
+  if ( (ReplaySeed >> 16) % 8 == 0 && ReplayInterrupts < 40 ) po_replay_fire((ReplaySeed >> 8) % 10);
+}
+
+/* Runs the replay workload, returns the number of interrupts
+ */
+static int replayrun(unsigned seed)
+{
+  ReplaySeed = seed;
+  ReplayCount = 0;
+  ReplayInterrupts = 0;
+  ReplayHwi = 1;
+  replayfunc(po_priority, 5, 6);
+  ReplayHwi = 0;
+  ReplayOrder[ReplayCount] = 0;
+  return ReplayInterrupts;
+}
+
+/* Test record and replay of emulated interrupts: a run replayed with
+ * other interrupt decisions must reproduce the recorded run.
+ */
+int test_replay(void)
+{
+  static char recorded[sizeof(ReplayOrder)];
+  FILE *file = tmpfile();
+  int i, interrupts, mismatches, errors = 0;
+
+  po_log("\nTESTING record and replay of emulated interrupts\n", 0, 0);
+
+  po_replay_record(file, replayhwi);
+  interrupts = replayrun(1);
+  po_replay_stop();
+  for ( i = 0 ; i <= ReplayCount ; i++ ) recorded[i] = ReplayOrder[i];
+
+  rewind(file);
+  po_replay_play(file, replayhwi);
+  replayrun(12345);
+  mismatches = po_replay_stop();
+  fclose(file);
+
+  for ( i = 0 ; i <= ReplayCount ; i++ ) errors += (ReplayOrder[i] != recorded[i]);
+  errors += mismatches + (interrupts == 0);
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: replayed %s\n", (po_log_Word)ReplayOrder, 0);
+    po_log("         recorded %s\n", (po_log_Word)recorded, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: %d calls, %d interrupts replayed\n", ReplayCount, interrupts);
+    return 0;
+  }
+}
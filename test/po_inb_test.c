@@ -0,0 +1,99 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_inbox module.
+ */
+
+#include <sched.h>
+#include <portos.h>
+
+#if po_target_HOSTED
+
+enum {
+  INBOX_THREADS = 4,
+  INBOX_POSTS = 8,       // posts of each thread
+  INBOX_ROUNDS = 2000    // times each thread posts each of its posts
+};
+
+typedef struct {
+  pthread_t thread;
+  int id;
+  po_inbox_Post post[INBOX_POSTS];
+} InboxThread;
+
+static po_inbox_Inbox Inbox;
+static InboxThread InboxThreads[INBOX_THREADS];
+static pthread_t InboxPortos;
+static long InboxRun[INBOX_THREADS];
+static long InboxCollected = 0;
+static int InboxErrors = 0;
+
+static void inboxcollect(po_priority(1), int id)
+{
+  InboxCollected++;
+}
+
+/* Runs in the Portos thread at the priority level of the post
+ */
+static void inboxfunc(void *arg)
+{
+  InboxThread *thread = (InboxThread*)arg;
+  if ( !pthread_equal(pthread_self(), InboxPortos) ) InboxErrors++;
+  InboxRun[thread->id]++;
+  inboxcollect(po_priority, thread->id);
+}
+
+/* Foreign thread posting its posts again as soon as they have started
+ */
+static void *inboxthread(void *arg)
+{
+  InboxThread *thread = (InboxThread*)arg;
+  int i, k;
+  for ( k = 0 ; k < INBOX_ROUNDS ; k++ )
+    for ( i = 0 ; i < INBOX_POSTS ; i++ )
+      while ( po_inbox_post(&Inbox, &thread->post[i]) )
+	sched_yield(); // Still pending
+  return NULL;
+}
+
+/* Test posting from other threads
+ */
+int test_inbox(void)
+{
+  long total = (long)INBOX_THREADS * INBOX_POSTS * INBOX_ROUNDS, run = 0;
+  int i, k, errors = 0;
+
+  po_log("\nTESTING inbox of posts from other threads\n", 0, 0);
+
+  InboxPortos = pthread_self();
+  errors += po_inbox_init(&Inbox) != 0;
+  for ( i = 0 ; i < INBOX_THREADS ; i++ ) {
+    InboxThreads[i].id = i;
+    for ( k = 0 ; k < INBOX_POSTS ; k++ )
+      po_inbox_postinit(&InboxThreads[i].post[k], 2 + k % 3, inboxfunc,
+			&InboxThreads[i]);
+    pthread_create(&InboxThreads[i].thread, NULL, inboxthread, &InboxThreads[i]);
+  }
+
+  while ( run < total )
+    run += po_inbox_wait(&Inbox, 1000);
+
+  for ( i = 0 ; i < INBOX_THREADS ; i++ ) {
+    pthread_join(InboxThreads[i].thread, NULL);
+    errors += InboxRun[i] != (long)INBOX_POSTS * INBOX_ROUNDS;
+  }
+  errors += po_inbox_drain(&Inbox) != 0;
+  errors += InboxErrors + (InboxCollected != total) + (Inbox.nPosts != total);
+  po_inbox_close(&Inbox);
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: inbox, %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: %ld posts in %lu batches\n", total, Inbox.nBatches);
+    return 0;
+  }
+}
+
+#endif // po_target_HOSTED
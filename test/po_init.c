@@ -36,25 +36,110 @@ po_signal_Group(po_signal_GroupDefault, po_priority_MAX, 8, &po_memory_RegionDef
 po_signal_Group(Group, po_priority_MAX, SIGNALS, /* non-power of 2 */
 		&po_memory_RegionDefault);
 
+#if po_target_HOSTED && defined(__linux__)
+// Signal group of the po_poll test (power of 2)
+po_signal_Group(PollGroup, po_priority_MAX, 64, &po_memory_RegionDefault);
+#endif
+
 // Zero or more clocks can be defined
 po_time_Clock(po_time_ClockDefault, po_priority_MAX, 16, &po_memory_RegionDefault);
 
 // This one does not need to be in this file
-static int LogBuffer[1024];
+static po_log_Word LogBuffer[1024];
 po_log_Handle po_log_HandleDefault =
-  po_log_INIT(LogBuffer, sizeof(LogBuffer)/sizeof(int), po_priority_MAX);
+  po_log_INIT(LogBuffer, sizeof(LogBuffer)/sizeof(po_log_Word), po_priority_MAX);
+
+#if po_MULTI_INSTANCE
+// Two more instances, each run by a thread of the instance test
+static char InstHeap[2][heapSize];
+po_memory_Region(InstRegion0, InstHeap[0], heapSize, 10000);
+po_memory_Region(InstRegion1, InstHeap[1], heapSize, 10000);
+po_signal_Group(InstGroup0, po_priority_MAX, 8, &InstRegion0);
+po_signal_Group(InstGroup1, po_priority_MAX, 8, &InstRegion1);
+po_time_Clock(InstClock0, po_priority_MAX, 16, &InstRegion0);
+po_time_Clock(InstClock1, po_priority_MAX, 16, &InstRegion1);
+static po_log_Word InstLogBuffer[2][64];
+static po_log_Handle InstLog[2] = {
+  po_log_INIT(InstLogBuffer[0], 64, po_priority_MAX),
+  po_log_INIT(InstLogBuffer[1], 64, po_priority_MAX)
+};
+static po_function_Environ InstEnv[2];
+#if po_irq_NUM_SOURCES
+static po_irq_Source InstIrq[2][po_irq_NUM_SOURCES];
+#endif
+po_Instance InstanceTest[2];
+
+// Init the objects of an instance. Its environment is initialized by the
+// thread that runs it.
+static void po_init_instance(po_Instance *instance, po_function_Environ *env,
+			     po_memory_Region *region, po_signal_Group *group,
+			     po_time_Clock *clock, po_log_Handle *log)
+{
+  po_memory_regioninit(region);
+  po_signal_groupinit(group);
+  po_time_clockinit(clock);
+  instance->env = env;
+  instance->regionDefault = region;
+  instance->groupDefault = group;
+  instance->clockDefault = clock;
+  instance->logDefault = log;
+}
+#endif
 
 // One time initialization function that should be called from main()
 // or elsewhere.
 void po_init(void)
 {
+  #if po_MULTI_INSTANCE
+  // Default objects of the instance running in the main thread
+  po_memory_RegionDefaultP = (po_memory_Region*)&po_memory_RegionDefault;
+  po_signal_GroupDefaultP = (po_signal_Group*)&po_signal_GroupDefault;
+  po_time_ClockDefaultP = (po_time_Clock*)&po_time_ClockDefault;
+  po_log_HandleDefaultP = &po_log_HandleDefault;
+  #endif
+
   po_memory_regioninit((po_memory_Region*)&po_memory_RegionDefault);
   po_memory_regioninit((po_memory_Region*)&Region1);
   po_memory_regioninit((po_memory_Region*)&Region2);
   po_signal_groupinit((po_signal_Group*)&po_signal_GroupDefault);
   po_signal_groupinit((po_signal_Group*)&Group);
+  #if po_target_HOSTED && defined(__linux__)
+  po_signal_groupinit((po_signal_Group*)&PollGroup);
+  #endif
   po_time_clockinit((po_time_Clock*)&po_time_ClockDefault);
 
+  #if po_MULTI_INSTANCE
+  po_init_instance(&InstanceTest[0], &InstEnv[0],
+		   (po_memory_Region*)&InstRegion0, (po_signal_Group*)&InstGroup0,
+		   (po_time_Clock*)&InstClock0, &InstLog[0]);
+  po_init_instance(&InstanceTest[1], &InstEnv[1],
+		   (po_memory_Region*)&InstRegion1, (po_signal_Group*)&InstGroup1,
+		   (po_time_Clock*)&InstClock1, &InstLog[1]);
+  #if po_irq_NUM_SOURCES
+  InstanceTest[0].irqTable = InstIrq[0];
+  InstanceTest[1].irqTable = InstIrq[1];
+  #endif
+  #endif
+
   // Call this function at the end
   po_init_();
 }
+
+#if po_target_HOSTED
+// Registers the state defined in this file for po_checkpoint, after the
+// system state.
+int po_init_checkpoint(void)
+{
+  int error;
+  po_checkpoint_reset();
+  error = po_checkpoint_addsystem();
+  error |= po_checkpoint_addregion((po_memory_Region*)&po_memory_RegionDefault,
+				   Heap[0], heapSize);
+  error |= po_checkpoint_addregion((po_memory_Region*)&Region1, Heap[1], heapSize);
+  error |= po_checkpoint_addregion((po_memory_Region*)&Region2, Heap[2], heapSize);
+  error |= po_checkpoint_addgroup((po_signal_Group*)&po_signal_GroupDefault);
+  error |= po_checkpoint_addgroup((po_signal_Group*)&Group);
+  error |= po_checkpoint_addclock((po_time_Clock*)&po_time_ClockDefault);
+  return error;
+}
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for multiple instances (cf. po_MULTI_INSTANCE).
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <portos.h>
+#include <po_display.h>
+
+#if po_MULTI_INSTANCE && po_target_HOSTED
+
+enum {
+  INST_CALLS = 20000,         // calls per instance
+  INST_SIGNALS = 8,           // signals of the default group used
+  INST_SOURCE = 1,            // interrupt source bound by both instances
+  INST_IRQ_LEVEL = 3
+};
+
+// Instances run by the threads (cf. po_init.c)
+extern po_Instance InstanceTest[2];
+
+/* Load of an instance
+ */
+typedef struct {
+  pthread_t thread;
+  unsigned seed;
+  long nIssued, nCalled, nAttached, nRaised, nIrq;
+  int blocks;                 // blocks still allocated in its region
+  int errors;
+} InstLoad;
+
+static InstLoad InstLoads[2];
+static po_THREAD_LOCAL InstLoad *InstSelf;  // load of the calling thread
+static pthread_barrier_t InstStart;
+
+#if po_irq_NUM_SOURCES
+static void instirq(void *arg)
+{
+  InstLoad *load = arg;
+  if ( load != InstSelf || po_function_getpri() != INST_IRQ_LEVEL )
+    load->errors++;
+  load->nIrq++;
+}
+#endif
+
+/* Calls more functions at random levels, some of them attached to signals
+ */
+static void instfunc(po_priority(level), InstLoad *load, int level,
+		     int attached)
+{
+  int count;
+
+  load->nCalled++;
+  if ( po_function_getpri() != level ) load->errors++;
+  if ( attached ) load->nAttached--;
+
+  for ( count = rand_r(&load->seed) % 3 ;
+	count > 0 && load->nIssued < INST_CALLS ; count-- ) {
+    int child = rand_r(&load->seed) % po_priority_MAX;
+    load->nIssued++;
+    if ( rand_r(&load->seed) % 4 == 0 ) {
+      load->nAttached++;
+      instfunc(po_signal_p(rand_r(&load->seed) % INST_SIGNALS,
+			   &po_signal_GroupDefault), load, child, 1);
+    } else
+      instfunc(po_priority, load, child, 0);
+  }
+
+  po_signal_post(rand_r(&load->seed) % INST_SIGNALS, &po_signal_GroupDefault);
+
+  #if po_irq_NUM_SOURCES
+  if ( rand_r(&load->seed) % 8 == 0 ) {
+    load->nRaised++;
+    po_interrupt_enter();
+    po_irq_raise(INST_SOURCE);
+    po_interrupt_exit();
+  }
+  #endif
+}
+
+/* Thread running an instance
+ */
+static void *instthread(void *arg)
+{
+  InstLoad *load = arg;
+  po_Instance *instance = &InstanceTest[load - InstLoads];
+  int signal, blocks;
+
+  InstSelf = load;
+  po_instance_init(instance);
+  blocks = po_memory_display(&po_memory_RegionDefault);
+  #if po_irq_NUM_SOURCES
+  po_irq_bind(INST_SOURCE, INST_IRQ_LEVEL, instirq, load);
+  #endif
+  pthread_barrier_wait(&InstStart);
+
+  while ( load->nIssued < INST_CALLS ) {
+    load->nIssued++;
+    instfunc(po_priority, load, rand_r(&load->seed) % po_priority_MAX, 0);
+  }
+  for ( signal = 0 ; signal < INST_SIGNALS ; signal++ )
+    po_signal_post(signal, &po_signal_GroupDefault);
+
+  #if po_irq_NUM_SOURCES
+  po_irq_unbind(INST_SOURCE);
+  #endif
+  load->blocks = po_memory_display(&po_memory_RegionDefault) - blocks;
+  po_log("Instance %d: %ld calls\n", (int)(load - InstLoads), load->nCalled);
+  return NULL;
+}
+
+/* Test two instances running the same load in two threads
+ */
+int test_instance(void)
+{
+  int wrptr = po_log_HandleDefault.wrptr, i, errors = 0;
+
+  po_log("\nTESTING two instances in two threads\n", 0, 0);
+  wrptr += 4;
+
+  pthread_barrier_init(&InstStart, NULL, 2);
+  for ( i = 0 ; i < 2 ; i++ ) {
+    InstLoads[i].seed = i + 1;
+    if ( pthread_create(&InstLoads[i].thread, NULL, instthread,
+			&InstLoads[i]) ) {
+      po_log("FAILURE: cannot create thread\n", 0, 0);
+      return -1;
+    }
+  }
+  for ( i = 0 ; i < 2 ; i++ )
+    pthread_join(InstLoads[i].thread, NULL);
+  pthread_barrier_destroy(&InstStart);
+
+  // Each instance ran its own calls and logged in its own buffer
+  for ( i = 0 ; i < 2 ; i++ ) {
+    InstLoad *load = &InstLoads[i];
+    errors += load->errors;
+    errors += load->nIssued != INST_CALLS || load->nCalled != INST_CALLS;
+    errors += load->nAttached != 0 || load->blocks != 0;
+    errors += InstanceTest[i].env->currpri != -1;
+    errors += InstanceTest[i].logDefault->wrptr != 4;
+    #if po_irq_NUM_SOURCES
+    errors += load->nRaised == 0 || load->nIrq == 0 ||
+      load->nIrq > load->nRaised;
+    #endif
+  }
+  errors += po_log_HandleDefault.wrptr != wrptr;
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: two instances, %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: %ld and %ld calls", InstLoads[0].nCalled,
+	   InstLoads[1].nCalled);
+    po_log(", %ld and %ld interrupts\n", InstLoads[0].nIrq,
+	   InstLoads[1].nIrq);
+    return 0;
+  }
+}
+
+#endif // po_MULTI_INSTANCE && po_target_HOSTED
@@ -0,0 +1,141 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_io module.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <portos.h>
+
+#if po_target_HOSTED && defined(__linux__)
+
+enum {
+  IO_BLOCKS = 8,         // registered blocks
+  IO_BLOCK = 4096,
+  IO_REQUESTS = IO_BLOCKS + 2 // one more on a plain buffer, one failing
+};
+
+extern po_signal_Group PollGroup;
+static po_poll_Poller IoPoller;
+static po_inbox_Inbox IoInbox;
+static po_io_Context Io;
+static int IoFd;
+static char IoBlocks[IO_BLOCKS][IO_BLOCK];
+static char IoPlain[IO_BLOCK];
+static int IoDone;
+static int IoErrors;
+
+/* Completion at level 3, arg being the expected result
+ */
+static void iodone(void *arg, intptr_t result)
+{
+  if ( po_function_getpri() != 3 ) IoErrors++;
+  if ( result != (intptr_t)arg ) IoErrors++;
+  IoDone++;
+}
+
+static int iorequest(int write, int fd, void *buf, off_t offset, intptr_t result)
+{
+  if ( write )
+    return po_io_write(&Io, fd, buf, IO_BLOCK, offset, iodone, (void*)result, 3);
+  return po_io_read(&Io, fd, buf, IO_BLOCK, offset, iodone, (void*)result, 3);
+}
+
+/* A burst of requests, submitted together once this level has run
+ */
+static void ioburst(po_priority(5), int write)
+{
+  int i;
+  for ( i = 0 ; i < IO_BLOCKS ; i++ )
+    IoErrors += iorequest(write, IoFd, IoBlocks[i], (off_t)i * IO_BLOCK,
+			  IO_BLOCK) != 0;
+  IoErrors += iorequest(write, IoFd, IoPlain, (off_t)IO_BLOCKS * IO_BLOCK,
+			IO_BLOCK) != 0;
+  IoErrors += iorequest(write, -1, IoPlain, 0, -EBADF) != 0;
+  if ( Io.nSubmits != 0 && write ) IoErrors++; // Not before this level ran
+}
+
+static void iowait(void)
+{
+  while ( IoDone < IO_REQUESTS && po_poll_wait(&IoPoller, 1000) > 0 )
+    ;
+}
+
+/* Writes then reads back blocks in a mode
+ */
+static int iotest(int mode)
+{
+  struct iovec iov = {IoBlocks, sizeof(IoBlocks)};
+  int i, k, errors = 0;
+
+  errors += po_io_init(&Io, &IoPoller, po_priority_MAX, mode) != 0;
+  errors += po_io_register(&Io, &iov, 1) != 0;
+  IoErrors = 0;
+
+  for ( i = 0 ; i < IO_BLOCKS ; i++ ) memset(IoBlocks[i], 'a' + i, IO_BLOCK);
+  memset(IoPlain, 'z', IO_BLOCK);
+  IoDone = 0;
+  ioburst(po_priority, 1);
+  iowait();
+  errors += IoDone != IO_REQUESTS;
+
+  memset(IoBlocks, 0, sizeof(IoBlocks));
+  memset(IoPlain, 0, IO_BLOCK);
+  IoDone = 0;
+  ioburst(po_priority, 0);
+  iowait();
+  errors += IoDone != IO_REQUESTS;
+
+  for ( i = 0 ; i < IO_BLOCKS ; i++ )
+    for ( k = 0 ; k < IO_BLOCK ; k++ )
+      errors += IoBlocks[i][k] != 'a' + i;
+  for ( k = 0 ; k < IO_BLOCK ; k++ )
+    errors += IoPlain[k] != 'z';
+
+  if ( po_io_isring(&Io) )
+    errors += Io.nSubmits != 2 || Io.maxBatch != IO_REQUESTS;
+  errors += Io.nRequests != 2 * IO_REQUESTS;
+  po_io_close(&Io);
+  return errors + IoErrors;
+}
+
+/* Test asynchronous file I/O with and without io_uring
+ */
+int test_io(void)
+{
+  char name[] = "/tmp/po_io_XXXXXX";
+  int errors = 0, ring;
+
+  po_log("\nTESTING asynchronous file I/O\n", 0, 0);
+
+  IoFd = mkstemp(name);
+  if ( IoFd >= 0 ) unlink(name);
+  errors += IoFd < 0;
+  errors += po_inbox_init(&IoInbox) != 0;
+  errors += po_poll_init(&IoPoller, &PollGroup, &IoInbox) != 0;
+
+  errors += iotest(po_io_AUTO);
+  ring = Io.nSubmits != 0;
+
+  errors += po_offload_init(2, &IoInbox) != 0;
+  errors += iotest(po_io_OFFLOAD);
+  po_offload_stop();
+
+  po_poll_close(&IoPoller);
+  po_inbox_close(&IoInbox);
+  close(IoFd);
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: I/O, %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: I/O through %s and offloaded\n",
+	   (po_log_Word)(ring ? "io_uring" : "offload only"), 0);
+    return 0;
+  }
+}
+
+#endif // po_target_HOSTED && __linux__
@@ -32,6 +32,17 @@ int test_lib()
     }
   }
 
+  // Scheduler bitmap, possibly wider than an int
+  if ( po_lib_msbmap(0) != -1 ) error = -1;
+  for ( i = 0 ; i < po_function_NUM_PRI_LEVELS ; i++ ) {
+    po_lib_Bitmap x = 0;
+    po_lib_BITMAP_SET(x, i);
+    if ( po_lib_msbmap(x) != (int)i || po_lib_msbmap(x | 1) != (int)i ) {
+      error = -1;
+      break;
+    }
+  }
+
   if ( error ) {
     po_log("There are ERRORS\n", 0, 0);
     return -1;
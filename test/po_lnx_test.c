@@ -0,0 +1,182 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for the Linux target: signals as interrupts.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // CPU affinity
+#endif
+#include <sched.h>
+#include <signal.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <portos.h>
+
+#if po_target_LINUX
+
+enum {
+  LINUX_ROUNDS = 200,
+  LINUX_TICKS = 20
+};
+
+static volatile int LinuxArmed;      // round of the running low level, or 0
+static volatile int LinuxPreempted;  // the high level ran inside it
+static volatile int LinuxStop;
+static volatile unsigned long LinuxRaised;
+static volatile int LinuxHwis;
+static volatile int LinuxTicks;
+static unsigned long LinuxMin = (unsigned long)-1, LinuxMax, LinuxTotal;
+static int LinuxErrors, LinuxRound;
+static sem_t LinuxGo;                // a round is armed
+static sem_t LinuxDone;              // the high level ran
+static int LinuxRaiserCpu = -1;      // CPU of the raiser, -1 if shared
+
+static void linuxhigh(po_priority(20))
+{
+  unsigned long latency = po_target_timestamp() - LinuxRaised;
+  if ( !LinuxArmed ) LinuxErrors++;
+  if ( latency < LinuxMin ) LinuxMin = latency;
+  if ( latency > LinuxMax ) LinuxMax = latency;
+  LinuxTotal += latency;
+  LinuxPreempted = 1;
+  sem_post(&LinuxDone);
+}
+
+/* Interrupt handler
+ */
+static void linuxhwi(int signo)
+{
+  LinuxHwis++;
+  if ( LinuxArmed ) linuxhigh(po_priority);
+}
+
+/* Runs until preempted
+ */
+static void linuxlow(po_priority(2))
+{
+  unsigned long start = po_target_timestamp();
+  unsigned long limit = po_target_timestampfreq();
+  LinuxPreempted = 0;
+  LinuxArmed = ++LinuxRound;
+  sem_post(&LinuxGo);
+  while ( !LinuxPreempted && po_target_timestamp() - start < limit )
+    ;
+  LinuxArmed = 0;
+  if ( !LinuxPreempted ) LinuxErrors++;
+}
+
+/* Other thread raising the interrupt once per round of the low level,
+ * then blocking until the high level ran, so that the Portos thread gets
+ * its CPU back when they share one.
+ */
+static void *linuxraiser(void *unused)
+{
+  cpu_set_t set;
+
+  if ( LinuxRaiserCpu >= 0 ) {
+    CPU_ZERO(&set);
+    CPU_SET(LinuxRaiserCpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+
+  while ( 1 ) {
+    while ( sem_wait(&LinuxGo) )
+      ;
+    if ( LinuxStop ) break;
+    LinuxRaised = po_target_timestamp();
+    po_target_raise(SIGUSR1);
+    while ( sem_wait(&LinuxDone) )
+      ;
+  }
+  return NULL;
+}
+
+static void linuxtick(int signo)
+{
+  LinuxTicks++;
+}
+
+/* Test signals as interrupts
+ */
+int test_linux(void)
+{
+  struct timespec delay = {0, 1000000};
+  pthread_t raiser;
+  pthread_attr_t attr;
+  cpu_set_t saved, set;
+  unsigned long freq = po_target_timestampfreq();
+  int i, state, cpu, errors = 0;
+
+  po_log("\nTESTING signals as interrupts\n", 0, 0);
+
+  errors += po_target_bind(SIGUSR1, linuxhwi) != 0;
+
+  // Deferred while interrupts are disabled
+  state = po_interrupt_disable();
+  po_target_raise(SIGUSR1);
+  errors += LinuxHwis != 0 || po_target_Irq.pending == 0;
+  po_interrupt_restore(state);
+  errors += LinuxHwis != 1 || po_target_Irq.pending != 0;
+
+  // Preemption of a running level from another thread. The latency is
+  // measured with the two threads on CPUs of their own: on one CPU, it is
+  // that of the OS scheduler switching from the raiser.
+  sem_init(&LinuxGo, 0, 0);
+  sem_init(&LinuxDone, 0, 0);
+  pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved);
+  if ( sysconf(_SC_NPROCESSORS_ONLN) > 1 && (cpu = sched_getcpu()) >= 0 ) {
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    for ( i = 0 ; i < sysconf(_SC_NPROCESSORS_ONLN) && i < CPU_SETSIZE ; i++ )
+      if ( i != cpu ) {
+	LinuxRaiserCpu = i;
+	break;
+      }
+  }
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_create(&raiser, &attr, linuxraiser, NULL);
+  pthread_attr_destroy(&attr);
+  for ( i = 0 ; i < LINUX_ROUNDS ; i++ )
+    linuxlow(po_priority);
+  LinuxStop = 1;
+  sem_post(&LinuxGo);
+  pthread_join(raiser, NULL);
+  pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+  sem_destroy(&LinuxGo);
+  sem_destroy(&LinuxDone);
+  errors += LinuxHwis != 1 + LINUX_ROUNDS;
+
+  // Periodic timer
+  errors += po_target_bind(SIGALRM, linuxtick) != 0;
+  errors += po_target_timerstart(SIGALRM, 1000000) != 0;
+  for ( i = 0 ; i < 1000 && LinuxTicks < LINUX_TICKS ; i++ )
+    nanosleep(&delay, NULL);
+  po_target_timerstop(SIGALRM);
+  errors += LinuxTicks < LINUX_TICKS;
+
+  po_target_bind(SIGALRM, NULL);
+  po_target_bind(SIGUSR1, NULL);
+  errors += LinuxErrors;
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: signals as interrupts, %d errors\n", errors, 0);
+    return -1;
+  } else if ( LinuxRaiserCpu < 0 ) {
+    po_log("SUCCESS: %d preemptions, latency not measured on one CPU\n",
+	   LINUX_ROUNDS, 0);
+    return 0;
+  } else {
+    po_log("SUCCESS: preemption latency min %ld ns,",
+	   (long)(LinuxMin * 1e9 / freq), 0);
+    po_log(" mean %ld ns, max %ld ns\n",
+	   (long)(LinuxTotal * 1e9 / freq / LINUX_ROUNDS),
+	   (long)(LinuxMax * 1e9 / freq));
+    return 0;
+  }
+}
+
+#endif // po_target_LINUX
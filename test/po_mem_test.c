@@ -54,7 +54,7 @@ int test_size2index(void)
     po_log("%9X%6d   ", size-1, index[0]);
     po_log("%9X%6d   ", size, index[1]);
     po_log("%9X%6d   ", size+1, index[2]);
-    po_log("%s\n", (int)str[result], 0);
+    po_log("%s\n", (po_log_Word)str[result], 0);
 
     size = (1<<power) + ADD;
     power++;
@@ -175,3 +175,61 @@ int test_randomMalloc(void)
     return 0;
   }
 }
+
+#if po_memory_PRIORITY_REGIONS
+
+/* Small region standing for scarce internal RAM
+ */
+static char SmallHeap[512];
+static po_memory_Region(SmallRegion, SmallHeap, sizeof(SmallHeap), 64);
+
+/* Test 3:
+ * We check that handles are placed by priority level, with fallback on
+ * the regions of lower levels when a region is full
+ */
+int test_priorityRegions(void)
+{
+  po_memory_Region *small = (po_memory_Region*)&SmallRegion;
+  int index = po_memory_size2index(32);
+  void *blocks[64], *block;
+  int n, nSmall = 0, error = 0;
+
+  po_log("\n3) TESTING handle placement by priority level\n", 0, 0);
+
+  po_memory_regioninit(small);
+  po_memory_setpriregion(10, small);
+  po_memory_setpriregion(4, RegionVector[1]);
+
+  // Level 12 gets the region of level 10 until it is full, then the one
+  // of level 4
+  for ( n = 0 ; n < 64 ; n++ ) {
+    blocks[n] = po_rmalloc_pri(32, 12, RegionVector[0]);
+    if ( po_memory_isindex(blocks[n], index, small) ) nSmall++;
+    else if ( !po_memory_isindex(blocks[n], index, RegionVector[1]) ) error++;
+  }
+  if ( nSmall == 0 || nSmall == 64 ) error++;
+
+  // Levels below 4 get the fallback region
+  block = po_rmalloc_pri(32, 3, RegionVector[2]);
+  if ( !po_memory_isindex(block, index, RegionVector[2]) ) error++;
+  po_free(block);
+
+  // Freed blocks of the small region are reused first
+  po_free(blocks[0]);
+  blocks[0] = po_rmalloc_pri(32, 12, RegionVector[0]);
+  if ( !po_memory_isindex(blocks[0], index, small) ) error++;
+
+  for ( n = 0 ; n < 64 ; n++ ) po_free(blocks[n]);
+  po_memory_setpriregion(10, NULL);
+  po_memory_setpriregion(4, NULL);
+
+  if ( error ) {
+    po_log("FAILURE: there are %d ERRORS\n", error, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: %d of 64 blocks in the small region\n", nSmall, 0);
+    return 0;
+  }
+}
+
+#endif // po_memory_PRIORITY_REGIONS
@@ -0,0 +1,72 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_mutex module.
+ */
+
+#include <portos.h>
+
+static po_mutex_Mutex MutexA = po_mutex_INIT(5);
+static po_mutex_Mutex MutexB = po_mutex_INIT(7);
+
+/* Order in which the calls were run
+ */
+static char MutexOrder[16];
+static int MutexCount = 0;
+
+static void mutexfunc(po_priority(priority), int priority, int id)
+{
+  MutexOrder[MutexCount++] = '0' + id;
+}
+
+/* Locks A then B at level 1, posting calls above 1 and below, between
+ * and above the ceilings. Only the call above both ceilings runs before
+ * the unlocks.
+ */
+static void mutexuser(po_priority(1), int unused)
+{
+  po_mutex_lock(&MutexA);
+  mutexfunc(po_priority, 3, 1);  // Below A
+  po_mutex_lock(&MutexB);
+  mutexfunc(po_priority, 6, 2);  // Above A, below B
+  mutexfunc(po_priority, 9, 3);  // Above both
+  MutexOrder[MutexCount++] = 'B';
+  po_mutex_unlock(&MutexB);
+  MutexOrder[MutexCount++] = 'A';
+  po_mutex_unlock(&MutexA);
+  MutexOrder[MutexCount++] = 'u';
+}
+
+/* Test mutex
+ */
+int test_mutex(void)
+{
+  const char *expected = "3B2A1u";
+  int i, errors = 0;
+
+  po_log("\nTESTING mutexes\n", 0, 0);
+
+  mutexuser(po_priority, 0);
+
+  MutexOrder[MutexCount] = 0;
+  for ( i = 0 ; i <= MutexCount ; i++ ) errors += (MutexOrder[i] != expected[i]);
+
+  #if po_mutex_STATS
+  {
+    po_mutex_Stats stats;
+    po_mutex_getstats(&MutexA, &stats);
+    errors += (stats.nLocks != 1 || stats.holdMax > stats.holdTotal);
+    po_mutex_getstats(&MutexA, &stats);
+    errors += (stats.holdMax != 0);
+  }
+  #endif
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: mutex order %s\n", (po_log_Word)MutexOrder, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: mutex order %s\n", (po_log_Word)MutexOrder, 0);
+    return 0;
+  }
+}
@@ -0,0 +1,114 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_offload module.
+ */
+
+#include <unistd.h>
+#include <portos.h>
+
+#if po_target_HOSTED
+
+enum {
+  OFFLOAD_WORKERS = 4,
+  OFFLOAD_BURST = po_offload_NUM_JOBS + 36, // more than there are jobs
+  OFFLOAD_CHAINED = 500  // jobs submitted again from their completion
+};
+
+static po_inbox_Inbox OffloadInbox;
+static pthread_t OffloadPortos;
+static long OffloadSum = 0;
+static int OffloadDone = 0;
+static int OffloadChained = 0;
+static int OffloadErrors = 0;
+
+/* Blocking work, on a worker
+ */
+static intptr_t offloadwork(void *arg)
+{
+  if ( pthread_equal(pthread_self(), OffloadPortos) ) OffloadErrors++;
+  usleep(100);
+  return 2 * (intptr_t)arg;
+}
+
+static void offloadcollect(po_priority(1), intptr_t result)
+{
+  OffloadSum += result;
+  OffloadDone++;
+}
+
+/* Completion, in the Portos thread at level 3
+ */
+static void offloaddone(void *arg, intptr_t result)
+{
+  if ( !pthread_equal(pthread_self(), OffloadPortos) ) OffloadErrors++;
+  if ( po_function_getpri() != 3 ) OffloadErrors++;
+  if ( result != 2 * (intptr_t)arg ) OffloadErrors++;
+  offloadcollect(po_priority, result);
+}
+
+/* Completion submitting the next job
+ */
+static void offloadchain(void *arg, intptr_t result)
+{
+  offloaddone(arg, result);
+  if ( ++OffloadChained < OFFLOAD_CHAINED )
+    OffloadErrors += po_offload(offloadwork, (void*)(intptr_t)OffloadChained,
+				offloadchain, 3) != 0;
+}
+
+static void offloadburst(po_priority(5))
+{
+  int i, accepted = 0;
+  for ( i = 0 ; i < OFFLOAD_BURST ; i++ )
+    accepted += po_offload(offloadwork, (void*)(intptr_t)i, offloaddone, 3) == 0;
+  // No completion can free a job before the inbox is drained
+  if ( accepted != po_offload_NUM_JOBS ) OffloadErrors++;
+}
+
+/* Test offloading blocking work to the worker pool
+ */
+int test_offload(void)
+{
+  po_offload_Stats stats;
+  long sum = 0;
+  int i, errors = 0;
+
+  po_log("\nTESTING offload of blocking work\n", 0, 0);
+
+  OffloadPortos = pthread_self();
+  errors += po_inbox_init(&OffloadInbox) != 0;
+  errors += po_offload_init(OFFLOAD_WORKERS, &OffloadInbox) != 0;
+
+  offloadburst(po_priority);
+  while ( OffloadDone < po_offload_NUM_JOBS )
+    po_inbox_wait(&OffloadInbox, 1000);
+  for ( i = 0 ; i < po_offload_NUM_JOBS ; i++ ) sum += 2 * i;
+  errors += OffloadSum != sum;
+
+  errors += po_offload(offloadwork, 0, offloadchain, 3) != 0;
+  while ( OffloadDone < po_offload_NUM_JOBS + OFFLOAD_CHAINED )
+    po_inbox_wait(&OffloadInbox, 1000);
+
+  po_offload_stop();
+  errors += po_inbox_drain(&OffloadInbox) != 0;
+  po_inbox_close(&OffloadInbox);
+
+  po_offload_stats(&stats);
+  errors += stats.nJobs != po_offload_NUM_JOBS + OFFLOAD_CHAINED;
+  errors += stats.nRejected != OFFLOAD_BURST - po_offload_NUM_JOBS;
+  errors += stats.depth != 0 || stats.maxDepth < OFFLOAD_WORKERS;
+  errors += stats.latencyMax < stats.waitMax;
+  errors += OffloadErrors;
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: offload, %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: %lu jobs, maximum depth %d\n", stats.nJobs, stats.maxDepth);
+    return 0;
+  }
+}
+
+#endif // po_target_HOSTED
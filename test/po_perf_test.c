@@ -0,0 +1,118 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_perf module.
+ */
+
+#include <time.h>
+#include <portos.h>
+
+#if po_perf_ENABLE
+
+enum {
+  PERF_MS = 1000000ULL  // nanoseconds
+};
+
+/* Spins for ms milliseconds of CPU time of the thread
+ */
+static void perfspin(int ms)
+{
+  struct timespec start, now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+  do
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  while ( (now.tv_sec - start.tv_sec) * 1000000000LL +
+	  (now.tv_nsec - start.tv_nsec) < ms * PERF_MS );
+}
+
+static void perflight(po_priority(4), int unused)
+{
+}
+
+static void perflow(po_priority(1), int unused)
+{
+  perfspin(2);
+}
+
+static void perfbusy(po_priority(3), int unused)
+{
+  perfspin(20);
+}
+
+/* Calls a function immediately and schedules another one
+ */
+static void perfouter(po_priority(2), int unused)
+{
+  perfspin(10);
+  perfbusy(po_priority, 0);
+  perflow(po_priority, 0);
+}
+
+/* Test event counters
+ */
+int test_perf(void)
+{
+  static char text[4096];
+  po_perf_Counts outer, busy, light, low, level;
+  po_perf_Stats stats;
+  FILE *file;
+  size_t n;
+  int i, errors = 0;
+
+  po_log("\nTESTING event counters\n", 0, 0);
+
+  if ( po_perf_start() ) {
+    po_log("FAILURE: event counters, cannot open\n", 0, 0);
+    return -1;
+  }
+  perfouter(po_priority, 0);
+  for ( i = 0 ; i < 100 ; i++ )
+    perflight(po_priority, 0);
+  po_perf_getstats(&stats);
+  po_perf_stop();
+  perflight(po_priority, 0); // Not counted
+
+  errors += po_perf_getfunc("perfouter", &outer) != 1;
+  errors += po_perf_getfunc("perfbusy", &busy) != 1;
+  errors += po_perf_getfunc("perflight", &light) != 1;
+  errors += po_perf_getfunc("perflow", &low) != 1;
+  errors += outer.calls != 1 || busy.calls != 1 || light.calls != 100 ||
+    low.calls != 1;
+
+  // The time of a function excludes that of the functions it calls. The
+  // task clock leaves out kernel time, which the spin counts: 90% of the
+  // spin at least
+  errors += busy.count[po_perf_TIME] < 20 * PERF_MS * 9 / 10;
+  errors += outer.count[po_perf_TIME] < 10 * PERF_MS * 9 / 10 ||
+    outer.count[po_perf_TIME] >= 20 * PERF_MS;
+  errors += low.count[po_perf_TIME] < 2 * PERF_MS * 9 / 10;
+  po_perf_getlevel(1, &level);
+  errors += level.calls != 1 || level.count[po_perf_TIME] != low.count[po_perf_TIME];
+
+  errors += !(stats.available & (1 << po_perf_TIME)) || stats.nReads == 0;
+  errors += stats.nFuncs != 4 || stats.nDropped != 0;
+  if ( stats.available & (1 << po_perf_INSTRUCTIONS) )
+    errors += busy.count[po_perf_INSTRUCTIONS] == 0;
+
+  file = tmpfile();
+  po_perf_write(file);
+  rewind(file);
+  n = fread(text, 1, sizeof(text) - 1, file);
+  text[n] = 0;
+  fclose(file);
+  errors += strstr(text, "\nperfbusy@3 ") == NULL;
+  errors += strstr(text, "\nlevel 4 ") == NULL;
+  po_log("%s", (po_log_Word)text, 0);
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: event counters, %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: event counters 0x%x, %lu readings\n", stats.available,
+	   stats.nReads);
+    return 0;
+  }
+}
+
+#endif // po_perf_ENABLE
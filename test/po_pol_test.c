@@ -0,0 +1,134 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_poll module.
+ */
+
+#include <unistd.h>
+#include <portos.h>
+
+#if po_target_HOSTED && defined(__linux__)
+
+enum {
+  POLL_PIPES = 3,
+  POLL_ROUNDS = 100
+};
+
+typedef struct {
+  int fd[2];
+  int priority;
+  int count;
+} PollPipe;
+
+extern po_signal_Group PollGroup;
+static po_poll_Poller Poller;
+static po_inbox_Inbox PollInbox;
+static PollPipe PollPipes[POLL_PIPES];
+static char PollOrder[POLL_PIPES + 1];
+static int PollOrderLen;
+static int PollWritten = 0;
+static int PollCancelled = 0;
+static int PollPosted = 0;
+
+/* Reads one byte and waits for the next one
+ */
+static void pollread(po_priority(pipe->priority), PollPipe *pipe)
+{
+  char c;
+  if ( read(pipe->fd[0], &c, 1) == 1 ) PollOrder[PollOrderLen++] = c;
+  if ( ++pipe->count < POLL_ROUNDS )
+    pollread(po_poll_read_p(pipe->fd[0], &Poller), pipe);
+}
+
+static void pollwrite(po_priority(1), int fd)
+{
+  PollWritten++;
+}
+
+static void pollcancelled(po_priority(1), int fd)
+{
+  PollCancelled++;
+}
+
+static void pollpost(void *arg)
+{
+  PollPosted++;
+}
+
+/* Test scheduling on file descriptor readiness
+ */
+int test_poll(void)
+{
+  po_poll_Handle handle = po_poll_INIT;
+  po_inbox_Post post;
+  int i, k, errors = 0;
+  char c = 'x';
+
+  po_log("\nTESTING file descriptor readiness\n", 0, 0);
+
+  errors += po_inbox_init(&PollInbox) != 0;
+  errors += po_poll_init(&Poller, &PollGroup, &PollInbox) != 0;
+
+  for ( i = 0 ; i < POLL_PIPES ; i++ ) {
+    PollPipe *p = &PollPipes[i];
+    errors += pipe(p->fd) != 0;
+    p->priority = 2 + i;
+    p->count = 0;
+    pollread(po_poll_read_p(p->fd[0], &Poller), p);
+  }
+
+  // All the pipes are ready at once, and read in priority order
+  for ( k = 0 ; k < POLL_ROUNDS ; k++ ) {
+    PollOrderLen = 0;
+    for ( i = 0 ; i < POLL_PIPES ; i++ ) {
+      c = '0' + i;
+      errors += write(PollPipes[i].fd[1], &c, 1) != 1;
+    }
+    errors += po_poll_wait(&Poller, 1000) != POLL_PIPES;
+    PollOrder[PollOrderLen] = 0;
+    errors += strcmp(PollOrder, "210") != 0;
+  }
+  for ( i = 0 ; i < POLL_PIPES ; i++ )
+    errors += PollPipes[i].count != POLL_ROUNDS ||
+      Poller.armed[PollPipes[i].fd[0]] != 0;
+  errors += Poller.nWakeups != POLL_ROUNDS;
+
+  // Writable
+  pollwrite(po_poll_write_p(PollPipes[0].fd[1], &Poller), 0);
+  errors += po_poll_wait(&Poller, 1000) != 1 || PollWritten != 1;
+
+  // Cancelled before the readiness, then removed from epoll
+  pollcancelled(po_poll_read_ph(PollPipes[0].fd[0], &Poller, &handle), 0);
+  errors += !po_poll_isactive(&handle);
+  po_poll_cancel(&handle);
+  errors += po_poll_isactive(&handle);
+  errors += write(PollPipes[0].fd[1], &c, 1) != 1;
+  errors += po_poll_wait(&Poller, 1000) != 1 || PollCancelled != 0;
+  errors += Poller.armed[PollPipes[0].fd[0]] != 0;
+  errors += po_poll_wait(&Poller, 0) != 0;
+
+  // Inbox drained by the poller
+  po_inbox_postinit(&post, 3, pollpost, NULL);
+  errors += po_inbox_post(&PollInbox, &post) != 0;
+  errors += po_poll_wait(&Poller, 1000) != 1 || PollPosted != 1;
+
+  for ( i = 0 ; i < POLL_PIPES ; i++ ) {
+    po_poll_remove(PollPipes[i].fd[0], &Poller);
+    close(PollPipes[i].fd[0]);
+    close(PollPipes[i].fd[1]);
+  }
+  po_poll_close(&Poller);
+  po_inbox_close(&PollInbox);
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: poll, %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: %lu events in %lu wake ups\n", Poller.nEvents,
+	   Poller.nWakeups);
+    return 0;
+  }
+}
+
+#endif // po_target_HOSTED && __linux__
@@ -0,0 +1,98 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_profile module.
+ */
+
+#include <time.h>
+#include <portos.h>
+
+#if po_profile_ENABLE
+
+/* Returns non-zero if line is one of the lines of text
+ */
+static int hasline(const char *text, const char *line)
+{
+  const char *t, *l;
+  while ( *text ) {
+    for ( t = text, l = line ; *l && *t == *l ; t++, l++ )
+      ;
+    if ( !*l && (*t == '\n' || !*t) ) return 1;
+    while ( *text && *text++ != '\n' )
+      ;
+  }
+  return 0;
+}
+
+static void profinner(po_priority(5), int unused)
+{
+  po_profile_sample();
+  po_profile_sample();
+}
+
+static void profouter(po_priority(2), int unused)
+{
+  po_profile_sample();
+  profinner(po_priority, 0);
+}
+
+/* Spins for a tenth of a second of CPU time
+ */
+static void profbusy(po_priority(3), int unused)
+{
+  clock_t start = clock();
+  while ( clock() - start < CLOCKS_PER_SEC / 10 )
+    ;
+}
+
+/* Test profiler
+ */
+int test_profile(void)
+{
+  static char text[4096];
+  po_profile_Stats stats;
+  FILE *file;
+  size_t n;
+  int errors = 0;
+
+  po_log("\nTESTING profiler\n", 0, 0);
+
+  // Samples taken by hand
+  po_profile_reset();
+  profouter(po_priority, 0);
+  po_profile_sample();
+
+  file = tmpfile();
+  po_profile_write(file);
+  rewind(file);
+  n = fread(text, 1, sizeof(text) - 1, file);
+  text[n] = 0;
+  fclose(file);
+
+  po_profile_getstats(&stats);
+  errors += (stats.nSamples != 4 || stats.nStacks != 3 || stats.nDropped != 0);
+  errors += !hasline(text, "profouter@2 1");
+  errors += !hasline(text, "profouter@2;profinner@5 2");
+  errors += !hasline(text, "[none] 1");
+  po_log("%s", (po_log_Word)text, 0);
+
+  // Samples taken by the profiling timer
+  po_profile_reset();
+  errors += (po_profile_start(0) != -1 || po_profile_start(2000000) != -1);
+  if ( po_profile_start(1000) ) errors++;
+  profbusy(po_priority, 0);
+  po_profile_stop();
+  po_profile_getstats(&stats);
+  errors += (stats.nSamples == 0);
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: profiler\n", 0, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: profiler, %d timer samples\n", stats.nSamples, 0);
+    return 0;
+  }
+}
+
+#endif // po_profile_ENABLE
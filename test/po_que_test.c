@@ -11,7 +11,11 @@
 #include <target.h>
 
 static int Errors = 0;
+#if po_MULTI_INSTANCE
+po_queue_Queue MyQueue;  // Default region is only known at run time
+#else
 po_queue_Queue MyQueue = po_queue_INIT(&MyQueue, 1, &po_memory_RegionDefault);
+#endif
 
 #define MAX_IDs 20
 static int IDs[MAX_IDs];
@@ -43,6 +47,10 @@ int test_queue(void)
   int i;
 
   po_log("\nTESTING priority functions inserted in queues\n", 0, 0);
+
+  #if po_MULTI_INSTANCE
+  po_queue_init(&MyQueue, 1, &po_memory_RegionDefault);
+  #endif
   
   myfunc(po_queue(&MyQueue), 1, 0);
   po_log("\n", 0, 0);
@@ -0,0 +1,73 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_rt module.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // CPU affinity
+#endif
+#include <pthread.h>
+#include <sched.h>
+#include <portos.h>
+
+#if po_target_HOSTED && defined(__linux__)
+
+enum {
+  RT_SAMPLES = 500,
+  RT_PERIOD = 100        // microseconds
+};
+
+extern po_memory_Region Region1;
+static po_rt_Jitter RtJitter;
+static int RtSteps;
+static int RtErrors;
+
+/* Thread set up for real time, leaving the test thread as it is
+ */
+static void *rtthread(void *unused)
+{
+  cpu_set_t set;
+
+  RtSteps = po_rt_start(-1, 10, po_rt_PIN | po_rt_FIFO);
+  if ( RtSteps & po_rt_PIN ) {
+    pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+    if ( CPU_COUNT(&set) != 1 ) RtErrors++;
+  }
+  po_rt_jitter(&RtJitter, RT_SAMPLES, RT_PERIOD);
+  return NULL;
+}
+
+/* Test the real time set up and the jitter measure
+ */
+int test_rt(void)
+{
+  pthread_t thread;
+  unsigned long count = 0;
+  int i, errors = 0;
+
+  po_log("\nTESTING real time set up\n", 0, 0);
+
+  po_rt_prefault(&Region1);
+  errors += pthread_create(&thread, NULL, rtthread, NULL) != 0;
+  pthread_join(thread, NULL);
+
+  for ( i = 0 ; i < po_rt_BUCKETS ; i++ ) count += RtJitter.histogram[i];
+  errors += RtJitter.samples != RT_SAMPLES || count != RT_SAMPLES;
+  errors += RtJitter.min > RtJitter.max;
+  errors += po_rt_quantile(&RtJitter, 990) > po_rt_quantile(&RtJitter, 999);
+  errors += RtErrors;
+  po_rt_report(&RtJitter);
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: real time, %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: pinned %d, SCHED_FIFO %d\n", !!(RtSteps & po_rt_PIN),
+	   !!(RtSteps & po_rt_FIFO));
+    return 0;
+  }
+}
+
+#endif // po_target_HOSTED && __linux__
@@ -0,0 +1,132 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_shm module.
+ */
+
+#include <sched.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <portos.h>
+
+#if po_target_HOSTED && defined(__linux__)
+
+enum {
+  SHM_MESSAGES = 20000,  // messages of the other process
+  SHM_WORDS = 8          // words of a payload
+};
+
+typedef struct {
+  long seq;
+  long word[SHM_WORDS];
+} ShmPayload;
+
+static po_shm_Channel Shm;
+static int ShmOrder[3], ShmNOrder;
+static long ShmReceived, ShmErrors;
+
+static void shmorder(void *payload, intptr_t word)
+{
+  if ( ShmNOrder < 3 ) ShmOrder[ShmNOrder] = (int)word;
+  ShmNOrder++;
+}
+
+static void shmnothing(void *payload, intptr_t word)
+{
+}
+
+/* Receives a payload of the other process and frees it
+ */
+static void shmreceive(void *payload, intptr_t word)
+{
+  ShmPayload *p = (ShmPayload*)payload;
+  int i;
+
+  if ( p->seq != word ) ShmErrors++;
+  for ( i = 0 ; i < SHM_WORDS ; i++ )
+    if ( p->word[i] != p->seq * SHM_WORDS + i ) ShmErrors++;
+  ShmReceived++;
+  po_shm_free(&Shm, payload);
+}
+
+/* Other process, posting payloads allocated in the channel
+ */
+static int shmchild(void)
+{
+  ShmPayload *p;
+  long seq;
+  int i;
+
+  for ( seq = 0 ; seq < SHM_MESSAGES ; seq++ ) {
+    // The ring bounds the payloads in flight
+    if ( (p = (ShmPayload*)po_shm_malloc(&Shm, sizeof(*p))) == NULL )
+      return 1;
+    p->seq = seq;
+    for ( i = 0 ; i < SHM_WORDS ; i++ )
+      p->word[i] = seq * SHM_WORDS + i;
+    while ( po_shm_post(&Shm, 2, 2 + seq % 3, p, seq) )
+      sched_yield(); // Ring full
+  }
+  return 0;
+}
+
+/* Test channel between processes
+ */
+int test_shm(void)
+{
+  pid_t child;
+  int i, status, errors = 0;
+
+  po_log("\nTESTING channel between processes\n", 0, 0);
+
+  if ( po_shm_create(&Shm, 64 * 1024) ) {
+    po_log("FAILURE: channel, cannot create\n", 0, 0);
+    return -1;
+  }
+
+  // Batch run in priority order
+  po_shm_bind(&Shm, 1, shmorder);
+  po_shm_post(&Shm, 1, 1, NULL, 1);
+  po_shm_post(&Shm, 1, 5, NULL, 5);
+  po_shm_post(&Shm, 1, 3, NULL, 3);
+  errors += po_shm_drain(&Shm) != 3;
+  errors += ShmNOrder != 3 || ShmOrder[0] != 5 || ShmOrder[1] != 3 ||
+    ShmOrder[2] != 1;
+
+  // Ring full
+  po_shm_bind(&Shm, 1, shmnothing);
+  for ( i = 0 ; i < po_shm_NUM_SLOTS ; i++ )
+    errors += po_shm_post(&Shm, 1, 1, NULL, i) != 0;
+  errors += po_shm_post(&Shm, 1, 1, NULL, i) != -1;
+  errors += po_shm_drain(&Shm) != po_shm_NUM_SLOTS;
+  errors += po_shm_drain(&Shm) != 0;
+
+  // Payloads of another process, freed by this one
+  po_shm_bind(&Shm, 2, shmreceive);
+  child = fork();
+  if ( child == 0 ) _exit(shmchild());
+  errors += child < 0;
+  for ( i = 0 ; child > 0 && ShmReceived < SHM_MESSAGES && i < 10000 ; i++ )
+    po_shm_wait(&Shm, 1000);
+  if ( child > 0 ) {
+    errors += waitpid(child, &status, 0) != child;
+    errors += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+  }
+  errors += ShmReceived != SHM_MESSAGES || ShmErrors != 0;
+  errors += Shm.shared->nFull == 0; // The ring above was full
+
+  po_shm_close(&Shm);
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: channel, %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: %lu messages in %lu batches,", Shm.nMessages,
+	   Shm.nBatches);
+    po_log(" %lu wake ups\n", Shm.nWakeups, 0);
+    return 0;
+  }
+}
+
+#endif // po_target_HOSTED && __linux__
@@ -146,6 +146,7 @@ static void myfunc(po_priority(msg->priority), Message *msg)
       int protectState = po_interrupt_disable();
       po_list_Node *node = tail ?
 	po_list_poptail(&List.list) : po_list_pophead(&List.list);
+      po_interrupt_restore(protectState);
       if ( node ) {
 	Message *message = (Message*)node;
 	if ( message->h.state > 0 ) {
@@ -217,3 +218,87 @@ int test_randomSignals(void)
     return 0;
   }
 }
+
+#if po_function_OWNERS
+
+/* Pending work of an owner
+ */
+static po_function_Owner Owner;
+static po_queue_Queue OwnerQueue;
+static po_signal_Handle OwnerHandle;
+static int OwnerCalls = 0;
+
+static void ownerfunc(po_priority(1), int id)
+{
+  OwnerCalls++;
+}
+
+/* Leaves calls of an owner in the scheduler, in signal groups (not yet
+ * attached since the group runs at this same level), in a clock and in
+ * a queue, plus one call without owner. Then cancels the owner's calls
+ * and posts the signals.
+ */
+static void ownerburst(po_priority(po_priority_MAX), int unused)
+{
+  po_function_Owner *prevowner = po_function_setowner(&Owner);
+  int i;
+
+  for ( i = 0 ; i < 3 ; i++ ) ownerfunc(po_priority, i);
+  ownerfunc(po_signal_p(5, &Group), 3);
+  ownerfunc(po_signal_ph(6, &Group, &OwnerHandle), 4);
+  ownerfunc(po_time(po_time_get(&po_time_ClockDefault) + 1), 5);
+  ownerfunc(po_queue(&OwnerQueue), 6);
+
+  po_function_setowner(NULL);
+  ownerfunc(po_priority, 7);
+  po_function_setowner(prevowner);
+
+  if ( po_function_cancel(&Owner) != 7 ) {
+    po_log("ERROR: bad number of cancelled calls\n", 0, 0);
+    Errors++;
+  }
+  if ( po_signal_isactive(&OwnerHandle) ) {
+    po_log("ERROR: cancelled signal handle still active\n", 0, 0);
+    Errors++;
+  }
+
+  po_signal_post(5, &Group);
+  po_signal_post(6, &Group);
+  po_time_tick(&po_time_ClockDefault);
+}
+
+/* Test cancelling all pending calls of an owner
+ */
+int test_ownerCancel(void)
+{
+  po_log("\nTESTING cancelling pending calls by owner\n", 0, 0);
+
+  Errors = 0;
+  po_function_ownerinit(&Owner);
+  po_queue_init(&OwnerQueue, 0, &po_memory_RegionDefault); // No server
+  po_signal_init(&OwnerHandle);
+
+  ownerburst(po_priority, 0);
+
+  if ( OwnerCalls != 1 ) {
+    po_log("ERROR: %d calls ran instead of 1\n", OwnerCalls, 0);
+    Errors++;
+  }
+  if ( !po_list_isempty(&Owner.list) || !po_list_isempty(&OwnerQueue.list) ) {
+    po_log("ERROR: cancelled calls still linked\n", 0, 0);
+    Errors++;
+  }
+
+  // Still allocated memory
+  po_memory_display(&po_memory_RegionDefault);
+
+  if ( Errors > 0 ) {
+    po_log("FAILURE: there were %d errors\n", Errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: owner calls cancelled\n", 0, 0);
+    return 0;
+  }
+}
+
+#endif // po_function_OWNERS
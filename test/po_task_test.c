@@ -0,0 +1,115 @@
+/*
+ * Portos v1.7.0
+ * Copyright (c) 2003-2014 by Rabih Chrabieh. All rights reserved.
+ *
+ * Test for po_task module.
+ */
+
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <portos.h>
+
+#if po_target_HOSTED
+
+enum { TASK_MESSAGES = 200 };
+
+static po_task_Task TaskA, TaskB;
+static pthread_t TaskScheduler;
+static int TaskCount = 0;
+static long TaskSum = 0;
+static int TaskErrors = 0;
+static int TaskNice = -100, TaskPolicy = -1;
+
+/* Collects a result, in the scheduler thread
+ */
+static void taskcollect(po_priority(4), int value)
+{
+  if ( !pthread_equal(pthread_self(), TaskScheduler) ) TaskErrors++;
+  TaskSum += value;
+  TaskCount++;
+}
+
+static void taskdone(intptr_t word)
+{
+  taskcollect(po_priority, (int)word);
+}
+
+/* Blocking work, in a task
+ */
+static void taskwork(intptr_t word)
+{
+  struct timespec delay = {0, 10000};
+  if ( pthread_equal(pthread_self(), TaskScheduler) ) TaskErrors++;
+  nanosleep(&delay, NULL);
+  while ( po_task_post(taskdone, word * 2) )
+    sched_yield(); // Inbox full
+}
+
+/* Task with its own receive loop
+ */
+static void taskloop(po_task_Task *task, void *arg)
+{
+  po_task_Message message;
+  struct sched_param param;
+
+  TaskNice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+  pthread_getschedparam(pthread_self(), &TaskPolicy, &param);
+  while ( po_task_receive(task, &message) == 0 )
+    message.func(message.word + *(int*)arg);
+}
+
+/* Sends the work from a priority function
+ */
+static void taskburst(po_priority(5), int unused)
+{
+  int i;
+  for ( i = 0 ; i < TASK_MESSAGES ; i++ )
+    while ( po_task_send(i & 1 ? &TaskB : &TaskA, taskwork, i) )
+      sched_yield(); // Mailbox full: let the task progress
+}
+
+/* Test blocking tasks
+ */
+int test_task(void)
+{
+  static int offset = 1000;
+  int errors = 0, nice;
+
+  po_log("\nTESTING blocking tasks\n", 0, 0);
+
+  TaskScheduler = pthread_self();
+  errors += po_task_create(&TaskA, po_task_serve, NULL, 0, 0) != 0;
+  errors += po_task_create(&TaskB, taskloop, &offset, 3, 64*1024) != 0;
+  errors += po_task_create(&TaskB, taskloop, NULL, po_task_NUM_LEVELS, 0) != -1;
+
+  taskburst(po_priority, 0);
+  while ( TaskCount < TASK_MESSAGES )
+    po_task_dispatch(1);
+
+  po_task_stop(&TaskA);
+  po_task_stop(&TaskB);
+
+  // Sum of 2*i, plus 2*offset for the odd ones
+  errors += TaskErrors;
+
+  // Below the scheduler thread, time sharing
+  nice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid)) +
+    po_task_NICE_OFFSET + po_task_NUM_LEVELS - 1 - 3;
+  errors += TaskB.nice != (nice < 19 ? nice : 19) || TaskNice != TaskB.nice;
+  errors += TaskPolicy != SCHED_OTHER;
+  errors += TaskSum != (long)TASK_MESSAGES * (TASK_MESSAGES - 1) +
+    TASK_MESSAGES * offset;
+
+  if ( errors > 0 ) {
+    po_log("FAILURE: tasks, %d errors\n", errors, 0);
+    return -1;
+  } else {
+    po_log("SUCCESS: %d messages through tasks\n", TaskCount, 0);
+    return 0;
+  }
+}
+
+#endif // po_target_HOSTED
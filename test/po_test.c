@@ -15,10 +15,33 @@
 int test_lib(void);
 int test_size2index(void);
 int test_randomMalloc(void);
+int test_priorityRegions(void);
 int test_randomPfunc(void);
+int test_fairPfunc(void);
+int test_levelLimits(void);
+int test_irqDispatch(void);
+int test_chain(void);
+int test_replay(void);
 int test_randomHash(void);
 int test_randomSignals(void);
+int test_ownerCancel(void);
 int test_queue(void);
+int test_mutex(void);
+int test_profile(void);
+int test_perf(void);
+int test_crit(void);
+int test_checkpoint(void);
+int test_task(void);
+int test_fiber(void);
+int test_inbox(void);
+int test_offload(void);
+int test_dma(void);
+int test_poll(void);
+int test_io(void);
+int test_rt(void);
+int test_shm(void);
+int test_instance(void);
+int test_linux(void);
 
 // Called in task context on real systems
 void mainfunc(void)
@@ -30,14 +53,79 @@ void mainfunc(void)
   // po_memory_test
   failure |= test_size2index();
   failure |= test_randomMalloc();
+  #if po_memory_PRIORITY_REGIONS
+  failure |= test_priorityRegions();
+  #endif
   // po_function_test
   failure |= test_randomPfunc();
+  #if po_function_FAIR_SOURCES
+  failure |= test_fairPfunc();
+  #endif
+  #if po_function_LEVEL_LIMITS
+  failure |= test_levelLimits();
+  #endif
+  #if po_irq_NUM_SOURCES
+  failure |= test_irqDispatch();
+  #endif
+  #if po_function_CHAIN
+  failure |= test_chain();
+  #endif
+  failure |= test_replay();
   // po_hash_test
   failure |= test_randomHash();
   // po_signal_test
   failure |= test_randomSignals();
+  #if po_function_OWNERS
+  failure |= test_ownerCancel();
+  #endif
   //po_queue test
   failure |= test_queue();
+  // po_mutex test
+  failure |= test_mutex();
+  #if po_profile_ENABLE
+  // po_profile test
+  failure |= test_profile();
+  #endif
+  #if po_perf_ENABLE
+  // po_perf test
+  failure |= test_perf();
+  #endif
+  #if po_crit_STATS
+  // po_crit test
+  failure |= test_crit();
+  #endif
+  #if po_target_HOSTED
+  // po_checkpoint test
+  failure |= test_checkpoint();
+  // po_task test
+  failure |= test_task();
+  // po_fiber test
+  failure |= test_fiber();
+  // po_inbox test
+  failure |= test_inbox();
+  // po_offload test
+  failure |= test_offload();
+  // po_dma test
+  failure |= test_dma();
+  #if po_MULTI_INSTANCE
+  // Multiple instances test
+  failure |= test_instance();
+  #endif
+  #ifdef __linux__
+  // po_poll test
+  failure |= test_poll();
+  // po_io test
+  failure |= test_io();
+  // po_rt test
+  failure |= test_rt();
+  // po_shm test
+  failure |= test_shm();
+  #endif
+  #endif
+  #if po_target_LINUX
+  // Linux target test
+  failure |= test_linux();
+  #endif
 
   if ( failure )
     po_log("\nFAILURE: some tests have failed\n", 0, 0);
@@ -47,9 +135,10 @@ void mainfunc(void)
 
 extern po_memory_Region Region1, Region2;
 
-// Define a vector for accessing regions
+// Define a vector for accessing regions (the default region is set in
+// main() since it is only known at run time with multiple instances)
 po_memory_Region *RegionVector[3] =
-  {&po_memory_RegionDefault, &Region1, &Region2};
+  {NULL, &Region1, &Region2};
 
 int main()
 {